@@ -417,6 +417,92 @@ inline void kadane2D (
 	free(local_start);
 }
 
+/**
+ * @brief Kadane of arr and -arr along the rows, the columns are the lanes,
+ * the state of each 8 columns is kept in registers over all the rows.
+ * same outputs as kadane<float> on each column of arr (_p) and -arr (_n)
+ *
+ * @param nrow
+ * @param ncol: number of columns, must be multiple of 8
+ * @param ld: row stride of arr, must be multiple of 8
+ */
+inline void kadane2D_pn (
+	aligned_float * const maxSum_p,
+	aligned_int * const start_p,
+	aligned_int * const end_p,
+	aligned_float * const maxSum_n,
+	aligned_int * const start_n,
+	aligned_int * const end_n,
+	const aligned_float * const arr,
+	size_t nrow,
+	size_t ncol,
+	size_t ld
+)
+{
+	__m256 avx_zero = _mm256_setzero_ps();
+	__m256 avx_ninf = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+	__m256i avx_zeroi = _mm256_setzero_si256();
+	__m256i avx_one = _mm256_set1_epi32(1);
+	__m256i avx_negone = _mm256_set1_epi32(-1);
+
+	for (size_t j=0; j<ncol/8; j++)
+	{
+		__m256 avx_sum_p = avx_zero, avx_sum_n = avx_zero;
+		__m256 avx_maxSum_p = avx_ninf, avx_maxSum_n = avx_ninf;
+		__m256i avx_local_start_p = avx_zeroi, avx_local_start_n = avx_zeroi;
+		__m256i avx_start_p = avx_zeroi, avx_start_n = avx_zeroi;
+		__m256i avx_end_p = avx_negone, avx_end_n = avx_negone;
+
+		__m256i avx_i = avx_zeroi;
+		for (size_t i=0; i<nrow; i++)
+		{
+			__m256i avx_i1 = _mm256_add_epi32(avx_i, avx_one);
+
+			__m256 avx_arr = _mm256_load_ps(arr + i * ld + j * 8);
+
+			avx_sum_p = _mm256_add_ps(avx_sum_p, avx_arr);
+			avx_sum_n = _mm256_sub_ps(avx_sum_n, avx_arr);
+
+			__m256 avx_reset_p = _mm256_cmp_ps(avx_sum_p, avx_zero, 1);
+			__m256 avx_reset_n = _mm256_cmp_ps(avx_sum_n, avx_zero, 1);
+			__m256 avx_update_p = _mm256_andnot_ps(avx_reset_p, _mm256_cmp_ps(avx_sum_p, avx_maxSum_p, 14));
+			__m256 avx_update_n = _mm256_andnot_ps(avx_reset_n, _mm256_cmp_ps(avx_sum_n, avx_maxSum_n, 14));
+
+			avx_sum_p = _mm256_blendv_ps(avx_sum_p, avx_zero, avx_reset_p);
+			avx_sum_n = _mm256_blendv_ps(avx_sum_n, avx_zero, avx_reset_n);
+			avx_local_start_p = _mm256_blendv_epi8(avx_local_start_p, avx_i1, _mm256_castps_si256(avx_reset_p));
+			avx_local_start_n = _mm256_blendv_epi8(avx_local_start_n, avx_i1, _mm256_castps_si256(avx_reset_n));
+
+			avx_maxSum_p = _mm256_blendv_ps(avx_maxSum_p, avx_sum_p, avx_update_p);
+			avx_maxSum_n = _mm256_blendv_ps(avx_maxSum_n, avx_sum_n, avx_update_n);
+			avx_start_p = _mm256_blendv_epi8(avx_start_p, avx_local_start_p, _mm256_castps_si256(avx_update_p));
+			avx_start_n = _mm256_blendv_epi8(avx_start_n, avx_local_start_n, _mm256_castps_si256(avx_update_n));
+			avx_end_p = _mm256_blendv_epi8(avx_end_p, avx_i, _mm256_castps_si256(avx_update_p));
+			avx_end_n = _mm256_blendv_epi8(avx_end_n, avx_i, _mm256_castps_si256(avx_update_n));
+
+			avx_i = avx_i1;
+		}
+
+		// no positive sum, same as kadane<float>: maxSum = arr[0], start = end = 0
+		__m256 avx_arr0 = _mm256_load_ps(arr + j * 8);
+		__m256i avx_mask_p = _mm256_cmpeq_epi32(avx_end_p, avx_negone);
+		__m256i avx_mask_n = _mm256_cmpeq_epi32(avx_end_n, avx_negone);
+		avx_maxSum_p = _mm256_blendv_ps(avx_maxSum_p, avx_arr0, _mm256_castsi256_ps(avx_mask_p));
+		avx_maxSum_n = _mm256_blendv_ps(avx_maxSum_n, _mm256_sub_ps(avx_zero, avx_arr0), _mm256_castsi256_ps(avx_mask_n));
+		avx_start_p = _mm256_blendv_epi8(avx_start_p, avx_zeroi, avx_mask_p);
+		avx_start_n = _mm256_blendv_epi8(avx_start_n, avx_zeroi, avx_mask_n);
+		avx_end_p = _mm256_blendv_epi8(avx_end_p, avx_zeroi, avx_mask_p);
+		avx_end_n = _mm256_blendv_epi8(avx_end_n, avx_zeroi, avx_mask_n);
+
+		_mm256_store_ps(maxSum_p + j * 8, avx_maxSum_p);
+		_mm256_store_ps(maxSum_n + j * 8, avx_maxSum_n);
+		_mm256_store_si256((__m256i *)(start_p + j * 8), avx_start_p);
+		_mm256_store_si256((__m256i *)(start_n + j * 8), avx_start_n);
+		_mm256_store_si256((__m256i *)(end_p + j * 8), avx_end_p);
+		_mm256_store_si256((__m256i *)(end_n + j * 8), avx_end_n);
+	}
+}
+
 inline void scale(
 	aligned_uchar * const data_out,
 	const aligned_float * const data_in,
@@ -496,6 +582,143 @@ inline void scale(
 	}
 }
 
+/**
+ * @brief boxcar of width w from the prefix sum a: best[i] = max(best[i], (a[i]-a[i-w])*scl),
+ * bestw[i] is the width of the maximum, a[-w..-1] must be valid
+ */
+inline void boxcar_max(
+	float * const best,
+	int * const bestw,
+	const float * const a,
+	size_t size,
+	int w,
+	float scl
+)
+{
+	__m256 avx_scl = _mm256_set1_ps(scl);
+	__m256i avx_w = _mm256_set1_epi32(w);
+
+	size_t i = 0;
+	for (; i+8<=size; i+=8)
+	{
+		__m256 avx_box = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(a + i - w)), avx_scl);
+		__m256 avx_best = _mm256_loadu_ps(best + i);
+		__m256 mask = _mm256_cmp_ps(avx_box, avx_best, 14);
+		_mm256_storeu_ps(best + i, _mm256_blendv_ps(avx_best, avx_box, mask));
+		__m256i avx_bestw = _mm256_loadu_si256((__m256i *)(bestw + i));
+		_mm256_storeu_si256((__m256i *)(bestw + i), _mm256_blendv_epi8(avx_bestw, avx_w, _mm256_castps_si256(mask)));
+	}
+
+	for (; i<size; i++)
+	{
+		float box = (a[i] - a[(long int)i - w]) * scl;
+		if (box > best[i])
+		{
+			best[i] = box;
+			bestw[i] = w;
+		}
+	}
+}
+
+/**
+ * @brief incoherent sum of nh harmonics, sum[k] = power[k/nh] + power[2k/nh] + ... + power[k], nh is a power of 2
+ */
+inline void harmonic_sum(
+	float * const sum,
+	const float * const power,
+	size_t size,
+	int nh
+)
+{
+	int sh = 0;
+	while ((1 << sh) < nh) sh++;
+
+	__m256i avx_half = _mm256_set1_epi32(nh / 2);
+	__m256i avx_lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	size_t k = 0;
+	for (; k+8<=size; k+=8)
+	{
+		__m256i avx_k = _mm256_add_epi32(_mm256_set1_epi32(k), avx_lane);
+		__m256 avx_sum = _mm256_setzero_ps();
+		for (int m=1; m<=nh; m++)
+		{
+			__m256i avx_idx = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(avx_k, _mm256_set1_epi32(m)), avx_half), sh);
+			avx_sum = _mm256_add_ps(avx_sum, _mm256_i32gather_ps(power, avx_idx, 4));
+		}
+		_mm256_storeu_ps(sum + k, avx_sum);
+	}
+
+	for (; k<size; k++)
+	{
+		float s = 0.;
+		for (int m=1; m<=nh; m++)
+		{
+			s += power[(m * k + nh / 2) >> sh];
+		}
+		sum[k] = s;
+	}
+}
+
+/**
+ * @brief phase bins of a linear phase segment, bins[i] = floor(frac(phi0 + i * dphi) * nbin)
+ */
+inline void phase_bins(
+	int * const bins,
+	double phi0,
+	double dphi,
+	size_t size,
+	int nbin
+)
+{
+	__m256d avx_phi0 = _mm256_set1_pd(phi0);
+	__m256d avx_dphi = _mm256_set1_pd(dphi);
+	__m256d avx_nbin = _mm256_set1_pd(nbin);
+	__m256d avx_four = _mm256_set1_pd(4.);
+	__m256d avx_i = _mm256_setr_pd(0., 1., 2., 3.);
+	__m128i avx_max = _mm_set1_epi32(nbin - 1);
+
+	size_t i = 0;
+	for (; i+4<=size; i+=4)
+	{
+		__m256d avx_phi = _mm256_fmadd_pd(avx_i, avx_dphi, avx_phi0);
+		avx_phi = _mm256_sub_pd(avx_phi, _mm256_floor_pd(avx_phi));
+		__m128i avx_bin = _mm256_cvttpd_epi32(_mm256_mul_pd(avx_phi, avx_nbin));
+		_mm_storeu_si128((__m128i *)(bins + i), _mm_min_epi32(avx_bin, avx_max));
+		avx_i = _mm256_add_pd(avx_i, avx_four);
+	}
+
+	for (; i<size; i++)
+	{
+		double phi = phi0 + i * dphi;
+		int bin = (phi - std::floor(phi)) * nbin;
+		bins[i] = bin < nbin ? bin : nbin - 1;
+	}
+}
+
+/**
+ * @brief out[i] = in[idx[i]]
+ */
+inline void gather(
+	float * const out,
+	const float * const in,
+	const int * const idx,
+	size_t size
+)
+{
+	size_t i = 0;
+	for (; i+8<=size; i+=8)
+	{
+		__m256i avx_idx = _mm256_loadu_si256((__m256i *)(idx + i));
+		_mm256_storeu_ps(out + i, _mm256_i32gather_ps(in, avx_idx, 4));
+	}
+
+	for (; i<size; i++)
+	{
+		out[i] = in[idx[i]];
+	}
+}
+
 }
 
 
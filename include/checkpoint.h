@@ -0,0 +1,109 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 22:41:26
+ * @modify date 2026-10-19 22:41:26
+ * @desc [checkpoint of the streaming state]
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+
+/**
+ * @brief Named binary records of the streaming state of the modules (counters, overlap
+ * buffers, running statistics) and the reader position. Each module writes its records
+ * with save_state(checkpoint, prefix) after a block and reads them back with
+ * load_state(checkpoint, prefix) after prepare, so the shapes are checked against the
+ * current configuration, a module whose load_state fails is to be prepared again. Only
+ * trivially copyable values and vectors of them are stored.
+ *
+ * file: "XCHKPNT1", uint64 nrecords, then records of
+ *   uint32 keysize, key, uint64 size, size bytes
+ */
+class Checkpoint
+{
+public:
+	/**
+	 * @brief write the records to fname.tmp and rename it to fname, so that a job killed
+	 * while writing leaves the previous checkpoint intact
+	 */
+	bool save(const std::string &fname) const;
+	/**
+	 * @return false if the file can not be read or is not a checkpoint
+	 */
+	bool load(const std::string &fname);
+	void clear(){records.clear();}
+	bool has(const std::string &key) const {return records.find(key) != records.end();}
+
+	template <typename T>
+	void put(const std::string &key, const T *data, size_t n)
+	{
+		records[key].assign((const char *)data, sizeof(T) * n);
+	}
+
+	template <typename T>
+	void put(const std::string &key, const T &value)
+	{
+		put(key, &value, 1);
+	}
+
+	template <typename T, typename Allocator>
+	void put(const std::string &key, const std::vector<T, Allocator> &values)
+	{
+		put(key, values.data(), values.size());
+	}
+
+	void put(const std::string &key, const std::vector<bool> &values)
+	{
+		std::vector<unsigned char> temp(values.begin(), values.end());
+		put(key, temp);
+	}
+
+	/**
+	 * @brief read exactly n values
+	 * @return false if the record is missing or has another size, data is unchanged then
+	 */
+	template <typename T>
+	bool get(const std::string &key, T *data, size_t n) const
+	{
+		std::map<std::string, std::string>::const_iterator r = records.find(key);
+		if (r == records.end() || r->second.size() != sizeof(T) * n) return false;
+		if (n != 0) memcpy((char *)data, r->second.data(), sizeof(T) * n);
+		return true;
+	}
+
+	template <typename T>
+	bool get(const std::string &key, T &value) const
+	{
+		return get(key, &value, 1);
+	}
+
+	/* values is resized to the record */
+	template <typename T, typename Allocator>
+	bool get(const std::string &key, std::vector<T, Allocator> &values) const
+	{
+		std::map<std::string, std::string>::const_iterator r = records.find(key);
+		if (r == records.end() || r->second.size() % sizeof(T) != 0) return false;
+		values.resize(r->second.size() / sizeof(T));
+		return get(key, values.data(), values.size());
+	}
+
+	bool get(const std::string &key, std::vector<bool> &values) const
+	{
+		std::vector<unsigned char> temp;
+		if (!get(key, temp)) return false;
+		values.assign(temp.begin(), temp.end());
+		return true;
+	}
+
+private:
+	std::map<std::string, std::string> records;
+};
+
+#endif /* CHECKPOINT_H */
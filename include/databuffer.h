@@ -16,9 +16,9 @@
 #include <complex>
 #include "json.hpp"
 
-#ifdef __AVX2__
-#include <boost/align/aligned_allocator.hpp>
-#endif
+#include "simd.h"
+#include "dataview.h"
+#include "checkpoint.h"
 
 using namespace std;
 
@@ -44,6 +44,27 @@ public:
 	void resize(long int ns, int nc);
 	void get_mean_rms(vector<T> &mean, vector<T> &var);
 	void get_mean_rms();
+	/* views of the buffer, nothing is copied, invalidated by close and resize */
+	DataView<T> view(){return DataView<T>(buffer.data(), nsamples, nchans);}
+	DataView<const T> view() const {return DataView<const T>(buffer.data(), nsamples, nchans);}
+	DataView<T> view(long int isamp, long int ns, int ichan, int nc){return view().slice(isamp, ns).sub(ichan, nc);}
+	/**
+	 * @brief handle of the current block which stays valid when the buffer is reused, the
+	 * storage is moved into the handle if the buffer is closable (the buffer is empty until
+	 * the next open) and copied otherwise
+	 */
+	DataHandle<T> share();
+	/**
+	 * @brief make the buffer hold the samples of databuffer, the storage of a closable
+	 * databuffer is released after the stage anyway, so it is swapped in instead of copied
+	 */
+	void take(DataBuffer<T> &databuffer);
+	/**
+	 * @brief streaming state of the stage (counter and channel statistics), see checkpoint.h,
+	 * load_state is called after prepare and returns false if the state does not match
+	 */
+	virtual void save_state(Checkpoint &checkpoint, const string &prefix) const;
+	virtual bool load_state(const Checkpoint &checkpoint, const string &prefix);
 public:
 	bool equalized;
 	bool mean_var_ready;
@@ -57,11 +78,10 @@ public:
 	vector<double> means;
 	vector<double> vars;
 	vector<double> weights;
-#ifdef __AVX2__
-	vector<T, boost::alignment::aligned_allocator<T, 32>> buffer;
-#else
-	vector<T> buffer;
-#endif
+	/* 1 for flagged channel, whose data is dropped by dedispersion, empty if no channel is flagged */
+	vector<unsigned char> chmask;
+	/* same layout whatever the build flags, aligned for the vector kernels */
+	aligned_vector<T> buffer;
 };
 
 #endif /* DATABUFFER_H_ */
\ No newline at end of file
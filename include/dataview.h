@@ -0,0 +1,124 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 21:48:12
+ * @modify date 2026-10-19 21:48:12
+ * @desc [non-owning views and shared handles of the (nsamples, nchans) blocks]
+ */
+
+#ifndef DATAVIEW_H
+#define DATAVIEW_H
+
+#include <stddef.h>
+#include <memory>
+#include <algorithm>
+#include <utility>
+
+#include "numautils.h"
+
+/**
+ * @brief non-owning (nsamples, nchans) view, sample i starts at data + i * ld. Sub-views of
+ * sample or channel ranges and strided views share the memory of the parent, nothing is copied.
+ * The view is only valid as long as the memory it points to.
+ */
+template <typename T>
+class DataView
+{
+public:
+	DataView() : data(NULL), nsamples(0), nchans(0), ld(0) {}
+	DataView(T *d, long int ns, int nc, long int l) : data(d), nsamples(ns), nchans(nc), ld(l) {}
+	DataView(T *d, long int ns, int nc) : data(d), nsamples(ns), nchans(nc), ld(nc) {}
+	/* read-only view of a writable view */
+	template <typename U>
+	DataView(const DataView<U> &view) : data(view.data), nsamples(view.nsamples), nchans(view.nchans), ld(view.ld) {}
+
+	/* samples isamp to isamp+ns */
+	DataView<T> slice(long int isamp, long int ns) const
+	{
+		return DataView<T>(data + isamp * ld, ns, nchans, ld);
+	}
+
+	/* channels ichan to ichan+nc, rows keep the stride of the parent */
+	DataView<T> sub(int ichan, int nc) const
+	{
+		return DataView<T>(data + ichan, nsamples, nc, ld);
+	}
+
+	/* every step-th sample */
+	DataView<T> stride(long int step) const
+	{
+		return DataView<T>(data, (nsamples + step - 1) / step, nchans, ld * step);
+	}
+
+	T * row(long int i) const {return data + i * ld;}
+	T & operator()(long int i, int j) const {return data[i * ld + j];}
+
+	bool empty() const {return data == NULL || nsamples == 0 || nchans == 0;}
+	bool contiguous() const {return ld == nchans;}
+
+	/* pack into out of nsamples * nchans, the only copy of a view and only when asked */
+	template <typename U>
+	void copy_to(U *out) const
+	{
+		for (long int i=0; i<nsamples; i++)
+		{
+			std::copy(row(i), row(i) + nchans, out + i * nchans);
+		}
+	}
+
+public:
+	T *data;
+	long int nsamples;
+	int nchans;
+	long int ld;
+};
+
+/**
+ * @brief reference counted handle of a block, the storage is released with the last handle.
+ * A stage that keeps a block after its producer reuses its buffer holds a handle instead of
+ * a copy, the handles of one block share the same storage.
+ */
+template <typename T>
+class DataHandle
+{
+public:
+	DataHandle() : nsamples(0), nchans(0) {}
+	/* take over the storage of buffer, buffer is left empty */
+	DataHandle(aligned_vector<T> &buffer, long int ns, int nc) : storage(std::make_shared<aligned_vector<T>>()), nsamples(ns), nchans(nc)
+	{
+		storage->swap(buffer);
+	}
+
+	DataView<const T> view() const
+	{
+		return storage ? DataView<const T>(storage->data(), nsamples, nchans) : DataView<const T>();
+	}
+
+	bool empty() const {return !storage;}
+	long int use_count() const {return storage.use_count();}
+	void reset()
+	{
+		storage.reset();
+		nsamples = 0;
+		nchans = 0;
+	}
+
+	/**
+	 * @brief give the storage back to buffer if this is the last handle, so that the memory
+	 * is reused for the next block, otherwise the handle is only dropped
+	 */
+	bool release(aligned_vector<T> &buffer)
+	{
+		bool unique = storage && storage.use_count() == 1;
+		if (unique) buffer.swap(*storage);
+		reset();
+		return unique;
+	}
+
+private:
+	std::shared_ptr<aligned_vector<T>> storage;
+	long int nsamples;
+	int nchans;
+};
+
+#endif /* DATAVIEW_H */
@@ -17,9 +17,32 @@
 #include "utils.h"
 #include "logging.h"
 #include "constants.h"
+#include "execcontext.h"
 
+/* default thread count, the modules use XLIBS::get_num_threads() of the current execution context */
 extern unsigned int num_threads;
 
+/**
+ * @brief Track the flagged channels (see DataBuffer::chmask), ndead[j] counts the consecutive blocks
+ * in which channel j is flagged. The channel is dead if it is flagged in all the nblock blocks held
+ * in the dedispersion buffer, so the buffer only contains zeros for it and it can be skipped.
+ * Channels from nchans_real on (padding) are always dead
+ */
+inline void update_dead_channels(std::vector<int> &ndead, std::vector<bool> &dead, const std::vector<unsigned char> &chmask, size_t nchans_real, int nblock)
+{
+	dead.resize(ndead.size());
+	for (size_t j=0; j<ndead.size(); j++)
+	{
+		bool flagged = j >= nchans_real or (!chmask.empty() and chmask[j]);
+		if (!flagged)
+			ndead[j] = 0;
+		else if (ndead[j] < nblock)
+			ndead[j]++;
+
+		dead[j] = ndead[j] >= nblock;
+	}
+}
+
 #define HAVE_YMW16 1
 
 #endif /* DEDISPERSE_H_ */
@@ -29,6 +29,8 @@ private:
 	std::vector<float> buf;
 	size_t buf_size;
 	std::vector<int> delayn;
+	std::vector<int> ndead;
+	std::vector<bool> dead;
 
 public:
 	static double dmdelay(double dm, double fh, double fl)
@@ -37,4 +39,53 @@ public:
 	}
 };
 
+/**
+ * @brief Brute force dedispersion of many dms at once, the channels are summed into nsubband subbands.
+ * The block is processed in tiles of (dm, time), and each tile walks over channel tiles,
+ * so that the input of a channel tile stays in cache while all dms of the tile accumulate it.
+ */
+class BatchDedispersion
+{
+public:
+	BatchDedispersion();
+	~BatchDedispersion();
+	void prepare(DataBuffer<float> &databuffer);
+	void run(DataBuffer<float> &databuffer);
+	/**
+	 * @brief get the nsamples x nsubband data of the idm-th dm
+	 */
+	void get_subdata(size_t idm, DataBuffer<float> &subdata);
+
+public:
+	std::vector<double> vdm;
+	/* 0 for nsubband = nchans */
+	size_t nsubband;
+	size_t tile_ndm;
+	size_t tile_nsamples;
+	size_t tile_nchans;
+
+public:
+	long int counter;
+	size_t offset;
+
+private:
+	size_t nsamples;
+	size_t nchans;
+	double tsamp;
+	std::vector<double> frequencies_sub;
+	std::vector<size_t> submap;
+	size_t buf_size;
+	/* the new block, (nsamples, nchans) and transposed */
+	std::vector<float> buf;
+	std::vector<float> blockT;
+	/* (nchans, buf_size), the last buf_size samples of each channel */
+	std::vector<float> bufT;
+	/* (ndm, nsubband, nsamples) */
+	std::vector<float> dedata;
+	/* (ndm, nchans) */
+	std::vector<int> delayn;
+	std::vector<int> ndead;
+	std::vector<bool> dead;
+};
+
 #endif /* DEDISPERSION_H */
@@ -17,8 +17,9 @@
 #include "dedisperse.h"
 #include "constants.h"
 
+#include "simd.h"
+
 #ifdef __AVX2__
-#include <boost/align/aligned_allocator.hpp>
 typedef __attribute__(( aligned(32))) float aligned_float;
 #endif
 
@@ -58,7 +59,17 @@ namespace Pulsar
 		}
 		void close();
 		void prepare(DataBuffer<float> &databuffer);
+		/**
+		 * @brief counter, statistics, dead channels and the overlap rows of the own buffer, see checkpoint.h
+		 */
+		void save_state(Checkpoint &checkpoint, const std::string &prefix) const;
+		bool load_state(const Checkpoint &checkpoint, const std::string &prefix);
 		void update_hit(const std::vector<double> &vdm);
+		/**
+		 * @brief update the dead channels and subtrees from the channel mask of the new block,
+		 * the subtrees of dead channels are skipped in transform
+		 */
+		void update_chmask(const std::vector<unsigned char> &chmask);
 		void run(DataBuffer<float> &databuffer);
 		void run();
 		void get_subdata(double dm, DataBuffer<float> &subdata, bool dedisperse=false);
@@ -93,8 +104,8 @@ namespace Pulsar
 		}
 		void resize_cache()
 		{
-			cache0.resize(num_threads * nsamples, 0.);
-			cache1.resize(num_threads * nsamples, 0.);
+			cache0.resize(XLIBS::get_num_threads() * nsamples, 0.);
+			cache1.resize(XLIBS::get_num_threads() * nsamples, 0.);
 		}
 
 	public:
@@ -102,7 +113,7 @@ namespace Pulsar
 		size_t get_nchans(){return nchans;}
 		size_t get_offset(){return offset;}
 		double get_tsamp(){return tsamp;}
-		size_t get_ndump(){return ndump;}
+		size_t get_ndump() const {return ndump;}
 		size_t get_nsamples(){return nsamples;}
 		size_t get_counter(){return counter;}
 
@@ -151,6 +162,7 @@ namespace Pulsar
 		void update_delay_rec(std::vector<size_t> &vdmid, double &freq, size_t depth, size_t ichan);
 		void update_map();
 		void transform(size_t depth, size_t ichan);
+		void transform_ragged(size_t depth, size_t ichan, bool alive0);
 
 	public:
 		size_t nsubband;
@@ -161,25 +173,17 @@ namespace Pulsar
 		bool if_alloc_bufferT;
 		bool if_alloc_dedata;
 
-		std::vector<float> *ptr_dedata;
-		std::vector<float> *ptr_buffer;
-#ifndef __AVX2__
-		std::vector<float> *ptr_bufferT;
-#else
-		std::vector<float, boost::alignment::aligned_allocator<float, 32>> *ptr_bufferT;
-#endif
+		aligned_vector<float> *ptr_dedata;
+		aligned_vector<float> *ptr_buffer;
+		aligned_vector<float> *ptr_bufferT;
 		std::vector<double> means;
 		std::vector<double> vars;
 		bool mean_var_ready;
 	
 	private:
-		std::vector<float> dedata;
-		std::vector<float> buffer;
-#ifndef __AVX2__
-		std::vector<float> bufferT;
-#else
-		std::vector<float, boost::alignment::aligned_allocator<float, 32>> bufferT;
-#endif
+		aligned_vector<float> dedata;
+		aligned_vector<float> buffer;
+		aligned_vector<float> bufferT;
 
 	private:
 		bool ready;
@@ -201,13 +205,11 @@ namespace Pulsar
 		std::vector<size_t> mapsub;
 		std::vector<int> delayn;
 		std::vector<bool> hit;
-#ifndef __AVX2__
-		std::vector<float> cache0;
-		std::vector<float> cache1;
-#else
-		std::vector<float, boost::alignment::aligned_allocator<float, 32>> cache0;
-		std::vector<float, boost::alignment::aligned_allocator<float, 32>> cache1;
-#endif
+		std::vector<int> ndead;
+		std::vector<bool> dead;
+		std::vector<bool> alive;
+		aligned_vector<float> cache0;
+		aligned_vector<float> cache1;
 
 	public:
 		static double dmdelay(double dm, double fh, double fl)
@@ -224,6 +226,11 @@ namespace Pulsar
 		void prepare(DataBuffer<float> &databuffer);
 		void prerun(DataBuffer<float> &databuffer);
 		void postrun(DataBuffer<float> &databuffer);
+		/**
+		 * @brief state of the segments and the overlap rows of the shared buffers, see checkpoint.h
+		 */
+		void save_state(Checkpoint &checkpoint, const std::string &prefix) const;
+		bool load_state(const Checkpoint &checkpoint, const std::string &prefix);
 		void run(DataBuffer<float> &databuffer);
 		void run(size_t k);
 		void alloc(size_t k)
@@ -435,13 +442,9 @@ namespace Pulsar
 		size_t nsamples0;
 		std::vector<TreeDedispersion> treededispersions;
 		std::vector<Downsample> downsamples;
-		std::vector<std::vector<float>> buffers;
-#ifndef __AVX2__
-		std::vector<std::vector<float>> bufferTs;
-#else
-		std::vector<std::vector<float, boost::alignment::aligned_allocator<float, 32>>> bufferTs;
-#endif
-		std::vector<std::vector<float>> dedatas;
+		std::vector<aligned_vector<float>> buffers;
+		std::vector<aligned_vector<float>> bufferTs;
+		std::vector<aligned_vector<float>> dedatas;
 		std::vector<bool> hit;
 
 	public:
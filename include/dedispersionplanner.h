@@ -0,0 +1,81 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 15:02:41
+ * @modify date 2026-10-19 15:02:41
+ * @desc [choose the dedispersion backend by benchmarking]
+ */
+
+#ifndef DEDISPERSIONPLANNER_H
+#define DEDISPERSIONPLANNER_H
+
+#include <string>
+#include <vector>
+#include "databuffer.h"
+
+namespace Pulsar
+{
+	struct DedispersionPlan
+	{
+		/* "brute", "subband", "tree" or "fdmt" */
+		std::string backend;
+		size_t nsubband;
+		size_t ndump;
+		unsigned int nthreads;
+		/* estimated memory in bytes */
+		double memory;
+		/* estimated rms smearing from the rounding of the delays and the dm grid in samples */
+		double smearing;
+		/* seconds of computation per second of data */
+		double cost;
+	};
+
+	/**
+	 * @brief Pick the fastest dedispersion backend and its nsubband, ndump and number of threads,
+	 * by running each candidate on synthetic data of the given header.
+	 * Candidates exceeding the memory budget or the smearing tolerance are skipped.
+	 * The decision is cached in a json file, keyed by the host and the search parameters.
+	 */
+	class DedispersionPlanner
+	{
+	public:
+		DedispersionPlanner();
+		~DedispersionPlanner();
+		/**
+		 * @brief find the best plan for the data header (nchans, tsamp, frequencies) of databuffer
+		 *
+		 * @param databuffer
+		 * @return false if no candidate fits the budget
+		 */
+		bool plan(const DataBuffer<float> &databuffer);
+
+	private:
+		void make_candidates(std::vector<DedispersionPlan> &candidates, const DataBuffer<float> &databuffer);
+		double benchmark(const DedispersionPlan &candidate, const DataBuffer<float> &databuffer);
+		std::string get_key(const DataBuffer<float> &databuffer);
+		bool load_cache(const std::string &key);
+		void save_cache(const std::string &key);
+
+	public:
+		double dms;
+		double dme;
+		/* dm step of the brute force and subband backends, 0 for the step of one sample smearing */
+		double ddm;
+		/* bytes, 0 for no limit */
+		double memory_budget;
+		/* samples */
+		double smearing_tolerance;
+		std::vector<size_t> ndumps;
+		std::vector<size_t> nsubbands;
+		std::vector<unsigned int> nthreads;
+		std::vector<std::string> backends;
+		int nrepeat;
+		std::string cachefile;
+
+	public:
+		DedispersionPlan best;
+		std::vector<DedispersionPlan> tried;
+	};
+}
+
+#endif /* DEDISPERSIONPLANNER_H */
@@ -0,0 +1,79 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 21:02:44
+ * @modify date 2026-10-19 21:02:44
+ * @desc [threads and cores of a pipeline]
+ */
+
+#ifndef EXECCONTEXT_H
+#define EXECCONTEXT_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace XLIBS
+{
+	/**
+	 * @brief thread count and cores of one pipeline. The thread pool is the OpenMP team of the
+	 * thread that installs the context, the parallel loops of the modules run with
+	 * get_num_threads() threads pinned to the cpus of the context. Two pipelines running in two
+	 * threads with disjoint contexts (see partition) do not share cores. The default context
+	 * follows the global num_threads and the affinity policy of the memory policy.
+	 */
+	class ExecutionContext
+	{
+	public:
+		ExecutionContext();
+		/**
+		 * @param nthreads: 0 follows the global num_threads
+		 * @param cpus: cpu of thread i is cpus[i % cpus.size()], no pinning if empty
+		 */
+		ExecutionContext(unsigned int nthreads, const std::vector<int> &cpus=std::vector<int>());
+		unsigned int get_num_threads() const;
+		const std::vector<int> & get_cpus() const {return cpus;}
+		/**
+		 * @brief pin the OpenMP team of the calling thread, once per thread and context
+		 */
+		void bind() const;
+
+		/**
+		 * @brief context installed on the calling thread, the default context if none
+		 */
+		static const ExecutionContext & current();
+		/**
+		 * @brief split the allowed cpus into nparts contexts of contiguous cpus, numa node by node
+		 */
+		static std::vector<ExecutionContext> partition(size_t nparts);
+
+	public:
+		/* install a context on the calling thread for the lifetime of the scope */
+		class Scope
+		{
+		public:
+			explicit Scope(const ExecutionContext &context);
+			~Scope();
+		private:
+			Scope(const Scope &);
+			Scope & operator=(const Scope &);
+			const ExecutionContext *previous;
+		};
+
+	private:
+		unsigned int nthreads;
+		std::vector<int> cpus;
+	};
+
+	/**
+	 * @brief number of threads of the current context, 1 inside a parallel region so that
+	 * nested regions do not oversubscribe
+	 */
+	unsigned int get_num_threads();
+
+	/**
+	 * @brief allowed cpus of the process grouped by numa node, read once before any pinning
+	 */
+	const std::vector<std::vector<int>> & get_node_cpus();
+}
+
+#endif /* EXECCONTEXT_H */
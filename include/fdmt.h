@@ -0,0 +1,106 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 14:20:10
+ * @modify date 2026-10-19 14:20:10
+ * @desc [fast dispersion measure transform]
+ */
+
+#ifndef FDMT_H
+#define FDMT_H
+
+#include <vector>
+#include "databuffer.h"
+#include "dedisperse.h"
+#include "constants.h"
+
+#include "simd.h"
+
+namespace Pulsar
+{
+	/**
+	 * @brief Fast Dispersion Measure Transform (Zackay & Ofek 2017).
+	 * The band is split into nsubband subbands, the channels of each subband are merged
+	 * pairwise with the exact 1/f^2 delays, and each subband ends up with one row per
+	 * integer delay 0..ndelay-1 across the subband, aligned at the top edge of the subband.
+	 * The rows are built from a buffer of ndump new samples plus an overlap of the maximum delay,
+	 * the first ndump samples of each row are complete.
+	 */
+	class FDMT
+	{
+	public:
+		FDMT();
+		~FDMT();
+		void close();
+		void prepare(DataBuffer<float> &databuffer);
+		void run(DataBuffer<float> &databuffer);
+		/**
+		 * @brief get the nsubband x ndump subband data of dm
+		 *
+		 * @param dm
+		 * @param subdata
+		 * @param dedisperse: also remove the delays between subbands
+		 */
+		void get_subdata(double dm, DataBuffer<float> &subdata, bool dedisperse=false);
+
+	public:
+		bool is_ready(){return ready;}
+		size_t get_nchans(){return nchans;}
+		size_t get_offset(){return offset;}
+		double get_tsamp(){return tsamp;}
+		size_t get_ndump(){return ndump;}
+		size_t get_nsamples(){return nsamples;}
+		size_t get_counter(){return counter;}
+		size_t get_ndelay(){return maxdelayn + 1;}
+
+	private:
+		void plan();
+		void init_leaves();
+		void merge(size_t level);
+
+	public:
+		size_t nsubband;
+		double maxdm;
+
+		std::vector<double> means;
+		std::vector<double> vars;
+		bool mean_var_ready;
+
+	private:
+		bool ready;
+		size_t counter;
+		size_t nchans;
+		size_t ndump;
+		double tsamp;
+		double foff;
+		std::vector<double> frequencies;
+		std::vector<double> frequencies_sub;
+		int maxdelayn;
+		size_t offset;
+		size_t nsamples;
+		size_t nlevel;
+		/* per level: channel range [chans[k], chans[k+1]) and frequency edges of each node */
+		std::vector<std::vector<size_t>> chans;
+		std::vector<std::vector<double>> fhs;
+		std::vector<std::vector<double>> fls;
+		/* per level: number of delays and first row of each node */
+		std::vector<std::vector<int>> ndelays;
+		std::vector<std::vector<size_t>> rows;
+		/* per level and row: rows of the high and low child in the level below, and the shift of the low child */
+		std::vector<std::vector<size_t>> rowH;
+		std::vector<std::vector<size_t>> rowL;
+		std::vector<std::vector<int>> shiftL;
+		std::vector<float> buffer;
+		aligned_vector<float> bufferT;
+		aligned_vector<float> state0;
+		aligned_vector<float> state1;
+
+	public:
+		static double dmdelay(double dm, double fh, double fl)
+		{
+			return dispersion_delay(dm, fh, fl);
+		}
+	};
+}
+
+#endif /* FDMT_H */
@@ -11,6 +11,9 @@
 #include <iostream>
 #include <vector>
 #include <complex>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 using namespace std;
 
@@ -142,4 +145,72 @@ ostream& operator<< (ostream &os, const FIFO_T<T> &fifo)
 	return os;
 }
 
+/* samples [start, start+size()) of a ConcurrentFIFO, split in two parts where it wraps around the end */
+template <typename T>
+struct FIFOSpan
+{
+	long int start;
+	T *data[2];
+	long int ns[2];
+	long int size() const {return ns[0]+ns[1];}
+};
+
+/* an index on its own cache line */
+struct FIFOIndex
+{
+	std::atomic<long int> value;
+	char pad[64-sizeof(std::atomic<long int>)];
+};
+
+/**
+ * @brief Thread safe ring buffer of (nsamples, nchans). Writers reserve samples with acquire_write and
+ * publish them in order with commit, readers reserve with acquire_read and free them in order with
+ * release, the spans point into the buffer so no copy is needed. Head and tail are atomic sample
+ * counts since the last reset, each on its own cache line. Reservations are made by compare and swap,
+ * so any number of producers and consumers may share the fifo. Waiting spins (yielding) or blocks on a condition variable.
+ * After close, acquire_read returns the remaining samples and then an empty span.
+ */
+template <typename T>
+class ConcurrentFIFO
+{
+public:
+	enum WaitPolicy{SPIN, BLOCK};
+public:
+	ConcurrentFIFO();
+	ConcurrentFIFO(const ConcurrentFIFO<T> &fifo) = delete;
+	ConcurrentFIFO<T> & operator=(const ConcurrentFIFO<T> &fifo) = delete;
+	~ConcurrentFIFO();
+	void resize(long int ns, long int nc);
+	void reset();
+	FIFOSpan<T> acquire_write(long int ns);
+	void commit(const FIFOSpan<T> &span);
+	FIFOSpan<T> acquire_read(long int ns);
+	void release(const FIFOSpan<T> &span);
+	void write(const T *data, long int ns);
+	long int read(T *data, long int ns);
+	void close();
+	bool is_closed(){return closed.load();}
+	long int get_ndata(){return head.value.load()-tail.value.load();}
+private:
+	FIFOSpan<T> get_span(long int start, long int ns);
+	template <typename Predicate>
+	void wait(Predicate pred);
+	void notify();
+public:
+	WaitPolicy policy;
+	long int nsamples;
+	long int nchans;
+private:
+	T *buffer;
+	/* committed and reserved write positions */
+	FIFOIndex head;
+	FIFOIndex whead;
+	/* released and reserved read positions */
+	FIFOIndex tail;
+	FIFOIndex rtail;
+	std::atomic<bool> closed;
+	std::mutex mtx;
+	std::condition_variable cv;
+};
+
 #endif /* FIFO_H_ */
@@ -132,4 +132,47 @@ public:
 };
 
 
+/**
+ * @brief KD-tree with the points in one contiguous (ndim, npoints) array. The tree is implicit:
+ * the node of range [lo, hi) is the point at (lo+hi)/2, split by nth_element along dimension depth%ndim,
+ * ranges of at most leafsize points are scanned linearly. The levels are built in parallel.
+ * runDBSCAN marks the core points in parallel, merges neighbouring core points with a lock-free
+ * union-find, and attaches the other points to the cluster of their first core neighbour.
+ * Results are in the order of the input points, recycle gives the same (index, clusterID, flag)
+ * state as KDtree, flag is 1 for core and 2 for other points, clusterID is 0 for noise.
+ */
+template <typename T>
+class FlatKDtree
+{
+public:
+	FlatKDtree();
+	FlatKDtree(int k);
+	~FlatKDtree();
+	void build(const vector<vector<T>> &points);
+	/**
+	 * @brief indices of the points within squared distance radius of point
+	 */
+	void findNeighbors(const vector<T> &point, T radius, vector<long int> &neighbors);
+	void runDBSCAN(T radius2, int k);
+	void recycle(vector<vector<long int>> &state);
+private:
+	template <typename F>
+	bool searchRec(long int lo, long int hi, long int depth, const T *point, T radius, F &visit);
+	long int find(long int i);
+	void unite(long int i, long int j);
+public:
+	int ndim;
+	int ncluster;
+	long int leafsize;
+	vector<int> clusterID;
+	vector<int> flag;
+private:
+	long int npoints;
+	/* (ndim, npoints) in tree order */
+	vector<T> coords;
+	/* input index of the points in tree order */
+	vector<long int> perm;
+	vector<long int> parent;
+};
+
 #endif /* KDTREE_H_ */
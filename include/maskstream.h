@@ -0,0 +1,60 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 13:05:12
+ * @modify date 2026-10-19 13:05:12
+ * @desc [run-length encoded stream of rfi masks]
+ */
+
+#ifndef MASKSTREAM_H
+#define MASKSTREAM_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fstream>
+
+/**
+ * @brief File of rfi mask records, one record per (block counter, rfi step).
+ * The masked cells of a nsamples x nchans block are run-length encoded,
+ * along time or frequency, whichever is shorter.
+ *
+ * file: "XRFIMSK1", then records of
+ *   uint64 counter, uint32 step, uint32 nsamples, uint32 nchans, float fill,
+ *   uint32 order (0: index i*nchans+j, 1: index j*nsamples+i),
+ *   uint64 nruns, nruns x (uint64 start, uint64 length)
+ */
+class MaskStream
+{
+public:
+	MaskStream();
+	MaskStream(const MaskStream &maskstream);
+	MaskStream & operator=(const MaskStream &maskstream);
+	~MaskStream();
+	/**
+	 * @brief open mask file
+	 *
+	 * @param fname
+	 * @param mode: "w" to record masks, "r" to replay masks
+	 * @return false if the file can not be opened or is not a mask file
+	 */
+	bool open(const std::string &fname, const std::string &mode);
+	void close();
+	bool is_writing() const {return writing;}
+	bool is_reading() const {return reading;}
+	void write(uint64_t counter, uint32_t step, float fill, const std::vector<unsigned char> &cells, size_t nsamples, size_t nchans);
+	/**
+	 * @brief read next record, cells is resized to nsamples*nchans
+	 *
+	 * @return false at the end of file
+	 */
+	bool read(uint64_t &counter, uint32_t &step, float &fill, std::vector<unsigned char> &cells, size_t &nsamples, size_t &nchans);
+public:
+	std::string filename;
+private:
+	bool writing;
+	bool reading;
+	std::fstream file;
+};
+
+#endif /* MASKSTREAM_H */
@@ -0,0 +1,140 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 16:52:12
+ * @modify date 2026-10-19 16:52:12
+ * @desc [batched folding of many candidates from shared dedispersed subband data]
+ */
+
+#ifndef MULTIFOLD_H
+#define MULTIFOLD_H
+
+#include <string>
+#include <vector>
+
+#include "databuffer.h"
+#include "dedisperse.h"
+#include "predictor.h"
+#include "kepler.h"
+#include "mjd.h"
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+namespace Pulsar
+{
+	struct FoldCandidate
+	{
+		double dm;
+		/* spin frequency (Hz) and its derivative at start_mjd, used without predictor and orbit */
+		double f0;
+		double f1;
+		/* orbit, used when orbit.Pb > 0, orbit.f0 defaults to f0 */
+		Kepler orbit;
+		/* tempo2 predictor, used when not empty */
+		Predictors predictor;
+		/* archive name without extension */
+		std::string rootname;
+	};
+
+	struct FoldProfiles
+	{
+		size_t nsubband;
+		double tsamp;
+		/* reference frequency of the dedispersed subbands */
+		double fref;
+		size_t nsamp_per_subint;
+		std::vector<double> frequencies;
+		/* (nsubint, nsubband, nbin) mean profiles */
+		std::vector<float> profiles;
+		std::vector<double> periods;
+		std::vector<double> offs_subs;
+
+		/* samples folded since start_mjd */
+		long int nsamples;
+		/* samples in the current subint */
+		size_t isamp;
+		/* (nbin, nsubband) sums and hits of the current subint */
+		std::vector<float> sums;
+		std::vector<unsigned int> hits;
+	};
+
+	/**
+	 * @brief Fold many (dm, ephemeris) candidates block by block. Candidates of the same dm share
+	 * one copy of the dedispersed subband data from get_subdata, the dm groups run in parallel.
+	 * The ephemeris is evaluated in long double at knots every knot_interval seconds, the phases
+	 * in between are interpolated linearly and binned with vector instructions. Each sample adds
+	 * its row of subbands to the (nbin, nsubband) sums of its bin, which are averaged and transposed
+	 * into (nsubband, nbin) profiles when a subint is complete.
+	 */
+	class MultiFold
+	{
+	public:
+		MultiFold();
+		~MultiFold();
+		void prepare();
+		/**
+		 * @brief fold the current block of a TreeDedispersion, DedispersionX or FDMT
+		 */
+		template <typename DedispersionT>
+		void run(DedispersionT &dedispersion)
+		{
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+			for (size_t g=0; g<groups.size(); g++)
+			{
+				int thread_id = omp_get_thread_num();
+
+				dedispersion.get_subdata(groupdms[g], subdatas[thread_id], true);
+				fold(subdatas[thread_id], g, thread_id);
+			}
+		}
+		/**
+		 * @brief fold the dedispersed subband data of dm group g
+		 */
+		void fold(DataBuffer<float> &subdata, size_t g, int thread_id=0);
+		/**
+		 * @brief fold the incomplete last subints
+		 */
+		void close();
+		/**
+		 * @brief write one fold mode archive per candidate
+		 */
+		void write_archives();
+
+	private:
+		long double get_phase(size_t k, long int isample);
+		double get_period(size_t k, long int isample);
+		void flush(size_t k, long int iend);
+
+	public:
+		std::vector<FoldCandidate> candidates;
+		MJD start_mjd;
+		/* seconds */
+		double tsubint;
+		int nbin;
+		/* seconds between the exact phase evaluations */
+		double knot_interval;
+
+		std::string template_file;
+		std::string src_name;
+		std::string ra;
+		std::string dec;
+		std::string telescope;
+
+	public:
+		std::vector<FoldProfiles> folds;
+
+	private:
+		/* threads of the execution context at prepare, one subdata per thread */
+		unsigned int nthreads;
+		std::vector<double> groupdms;
+		std::vector<std::vector<size_t>> groups;
+		std::vector<DataBuffer<float>> subdatas;
+		std::vector<std::vector<int>> bins;
+	};
+}
+
+#endif /* MULTIFOLD_H */
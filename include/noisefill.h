@@ -0,0 +1,66 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 10:12:31
+ * @modify date 2026-10-19 10:12:31
+ * @desc [counter-based gaussian noise generator for filling flagged data]
+ */
+
+#ifndef NOISEFILL_H
+#define NOISEFILL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+
+/**
+ * @brief Gaussian noise from Philox4x32-10 and Box-Muller.
+ * The value at stream index i only depends on (seed, counter, channel, i),
+ * so the fill is reproducible, thread safe and independent of the order of calls.
+ * The values are the same with every kernel table, see simd.h.
+ */
+class NoiseFill
+{
+public:
+	/* the seed is s ^ salt, see salt */
+	NoiseFill(uint64_t s=0, uint64_t salt=0) : seed(s ^ salt) {}
+	~NoiseFill(){}
+	/**
+	 * @brief salt of a module instance, so that the modules and beams seeded alike
+	 * (config "seed") get independent streams
+	 *
+	 * @param module: e.g. "rfi"
+	 * @param ibeam: config "ibeam"
+	 */
+	static uint64_t salt(const std::string &module, uint64_t ibeam);
+	/**
+	 * @brief fill data[k*stride], k=0..n-1, with normal(mean, stddev) noise
+	 * taken from stream indices offset..offset+n-1 of stream (counter, channel)
+	 *
+	 * @param data
+	 * @param n
+	 * @param stride
+	 * @param counter: block counter, e.g. the sample counter of the data buffer
+	 * @param channel
+	 * @param offset: first stream index, e.g. the sample index in the block
+	 * @param mean
+	 * @param stddev
+	 */
+	void fill_strided(float *data, size_t n, size_t stride, uint64_t counter, uint32_t channel, uint64_t offset, float mean=0., float stddev=1.) const;
+	void fill(float *data, size_t n, uint64_t counter, uint32_t channel, uint64_t offset, float mean=0., float stddev=1.) const
+	{
+		fill_strided(data, n, 1, counter, channel, offset, mean, stddev);
+	}
+private:
+	/* 32 standard normals of stream indices block*32..block*32+31 */
+	void generate(float *out, uint64_t block, uint64_t counter, uint32_t channel) const;
+public:
+	uint64_t seed;
+};
+
+#endif /* NOISEFILL_H */
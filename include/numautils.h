@@ -0,0 +1,94 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 20:41:05
+ * @modify date 2026-10-19 20:41:05
+ * @desc [numa aware allocation and thread placement]
+ */
+
+#ifndef NUMAUTILS_H
+#define NUMAUTILS_H
+
+#include <stddef.h>
+#include <vector>
+#include <new>
+
+/* alignment of the buffers shared with the vector kernels, one cache line, independent of the build flags */
+#define XLIBS_ALIGNMENT 64
+
+namespace PulsarX
+{
+	enum AffinityPolicy {AFFINITY_NONE=0, AFFINITY_COMPACT=1, AFFINITY_SPREAD=2};
+
+	/**
+	 * @brief placement of the large buffers, initialized from the environment variables
+	 * XLIBS_FIRST_TOUCH=0|1 (default 1), XLIBS_HUGEPAGES=0|1 (default 0) and
+	 * XLIBS_AFFINITY=none|compact|spread (default none)
+	 */
+	struct MemoryPolicy
+	{
+		/* the pages are first touched by the OpenMP threads with the static partition of the compute loops */
+		bool first_touch;
+		/* transparent huge pages for the large buffers */
+		bool hugepages;
+		/* compact fills the cores of one node first, spread alternates the nodes */
+		AffinityPolicy affinity;
+	};
+
+	const MemoryPolicy & get_memory_policy();
+	void set_memory_policy(const MemoryPolicy &policy);
+
+	/**
+	 * @brief pin the OpenMP threads of the current execution context (see execcontext.h), the
+	 * default context uses the affinity policy. The OpenMP runtime keeps its threads, so that
+	 * every later parallel region runs on the same cpus. Called by the large allocations, the
+	 * policy is ignored if OMP_PROC_BIND or OMP_PLACES is set.
+	 */
+	void bind_threads();
+
+	/**
+	 * @brief buffers of at least 1 MB are mapped directly, 2 MB aligned, so that their pages are
+	 * placed by the first touch, smaller ones come from the heap. numa_free keeps a few freed
+	 * mappings of each length, a buffer freed and allocated again every block reuses its pages
+	 * without another first touch.
+	 */
+	void * numa_alloc(size_t size, size_t alignment);
+	void numa_free(void *p, size_t size);
+	/**
+	 * @brief unmap the freed mappings kept by numa_free
+	 */
+	void numa_trim();
+
+	template <typename T, size_t Alignment=XLIBS_ALIGNMENT>
+	class numa_allocator
+	{
+	public:
+		typedef T value_type;
+		template <typename U>
+		struct rebind {typedef numa_allocator<U, Alignment> other;};
+
+		numa_allocator() noexcept {}
+		template <typename U>
+		numa_allocator(const numa_allocator<U, Alignment> &) noexcept {}
+
+		T * allocate(size_t n)
+		{
+			return static_cast<T *>(numa_alloc(n * sizeof(T), Alignment));
+		}
+
+		void deallocate(T *p, size_t n) noexcept
+		{
+			numa_free(p, n * sizeof(T));
+		}
+	};
+
+	template <typename T, typename U, size_t Alignment>
+	inline bool operator==(const numa_allocator<T, Alignment> &, const numa_allocator<U, Alignment> &) noexcept {return true;}
+	template <typename T, typename U, size_t Alignment>
+	inline bool operator!=(const numa_allocator<T, Alignment> &, const numa_allocator<U, Alignment> &) noexcept {return false;}
+}
+
+template <typename T>
+using aligned_vector = std::vector<T, PulsarX::numa_allocator<T>>;
+
+#endif /* NUMAUTILS_H */
@@ -0,0 +1,107 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 22:15:37
+ * @modify date 2026-10-19 22:15:37
+ * @desc [channel sub-band partitioning of a block]
+ */
+
+#ifndef PARTITIONER_H
+#define PARTITIONER_H
+
+#include <vector>
+#include <algorithm>
+
+#include "dataview.h"
+#include "execcontext.h"
+
+namespace XLIBS
+{
+	/**
+	 * @brief split the channels of a block into sub-bands which are processed concurrently, a
+	 * thread takes whole sub-bands and only touches their channels of every sample. The partition
+	 * only depends on nchans and the parameters, not on the thread count. The sub-bands are views,
+	 * nothing is copied. Per channel steps run with map, cross channel quantities (e.g. the
+	 * zero-dm time series) are partial sums of the sub-bands added by reduce.
+	 * The default sub-band is one aligned block of 16 channels, so a band of nchans channels
+	 * keeps nchans / 16 threads busy.
+	 * RFI::zdot is driven through map and reduce. Equalize, BaseLine, Patch and RFI::kadaneF
+	 * still run on the whole band with loops over samples, each thread takes whole rows.
+	 */
+	class ChannelPartitioner
+	{
+	public:
+		/**
+		 * @param nsubband: 0 for sub-bands of nblock aligned blocks
+		 * @param align: sub-band boundaries are multiples of align channels, 16 floats is one cache line
+		 * @param nblock: aligned blocks per sub-band when nsubband is 0
+		 */
+		ChannelPartitioner(int nsubband=0, int align=16, int nblock=1);
+		void prepare(int nchans);
+
+		size_t size() const {return starts.empty() ? 0 : starts.size() - 1;}
+		int get_start(size_t k) const {return starts[k];}
+		int get_nchans(size_t k) const {return starts[k + 1] - starts[k];}
+
+		template <typename T>
+		DataView<T> get(const DataView<T> &view, size_t k) const
+		{
+			return view.sub(get_start(k), get_nchans(k));
+		}
+
+		/**
+		 * @brief f(k, sub) on every sub-band, concurrently on the threads of the execution context,
+		 * nested parallel loops in f run with one thread
+		 */
+		template <typename T, typename F>
+		void map(const DataView<T> &view, F f) const
+		{
+			long int n = size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(std::max(1L, std::min(n, (long int)get_num_threads())))
+#endif
+			for (long int k=0; k<n; k++)
+			{
+				f(k, get(view, k));
+			}
+		}
+
+		/**
+		 * @brief partial(k, sub, out) adds the contribution of sub-band k to out of nout zeros,
+		 * result is the sum of the partial results, added in sub-band order so that it does not
+		 * depend on the thread count
+		 */
+		template <typename T, typename U, typename F>
+		void reduce(const DataView<T> &view, std::vector<U> &result, size_t nout, F partial) const
+		{
+			std::vector<U> partials(size() * nout, 0);
+			map(view, [&](size_t k, const DataView<T> &sub)
+			{
+				partial(k, sub, partials.data() + k * nout);
+			});
+
+			result.assign(nout, 0);
+			size_t n = size();
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(get_num_threads())
+#endif
+			for (size_t i=0; i<nout; i++)
+			{
+				for (size_t k=0; k<n; k++)
+				{
+					result[i] += partials[k * nout + i];
+				}
+			}
+		}
+
+	public:
+		int nsubband;
+		int align;
+		int nblock;
+
+	private:
+		std::vector<int> starts;
+	};
+}
+
+#endif /* PARTITIONER_H */
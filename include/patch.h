@@ -10,6 +10,7 @@
 #define PATCH_H
 
 #include "databuffer.h"
+#include "noisefill.h"
 
 class Patch : public DataBuffer<float>
 {
@@ -27,6 +28,7 @@ public:
 	float width;
 	float threshold;
 	float killrate;
+	NoiseFill noise;
 };
 
 #endif /* PATCH_H */
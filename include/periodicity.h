@@ -0,0 +1,95 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 16:10:05
+ * @modify date 2026-10-19 16:10:05
+ * @desc [fft periodicity search of dedispersed time series]
+ */
+
+#ifndef PERIODICITY_H
+#define PERIODICITY_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fftw3.h>
+
+namespace Pulsar
+{
+	struct PeriodicityCandidate
+	{
+		uint32_t idm;
+		double dm;
+		/* number of summed harmonics */
+		uint32_t nh;
+		/* frequency of the fundamental in Hz */
+		double freq;
+		/* sum of the whitened harmonic powers */
+		float power;
+		/* equivalent gaussian significance */
+		float sigma;
+		/* number of dms and harmonic sums merged into the candidate by sifting */
+		uint32_t nhits;
+	};
+
+	/**
+	 * @brief FFT search of ndm dedispersed time series of nsamples each.
+	 * The rows are transformed in batches of nbatch with one FFTW many plan, the batches
+	 * run in parallel on per thread arrays. The power spectra are whitened by a running median
+	 * in blocks of growing width, summed incoherently over 1, 2, 4, ..., maxharm harmonics,
+	 * and the peaks above threshold of all dms are sifted into one candidate list.
+	 */
+	class PeriodicitySearch
+	{
+	public:
+		PeriodicitySearch();
+		~PeriodicitySearch();
+		void prepare(size_t ndm, size_t nsamples, double tsamp);
+		/**
+		 * @brief search ndm rows of nsamples, row k starts at data + k * ld
+		 */
+		void run(const float *data, size_t ld);
+		void close();
+
+	private:
+		void whiten(float *power, float *scratch);
+		void harmonic_sum(std::vector<PeriodicityCandidate> &cands, float *sum, const float *power, uint32_t idm);
+		void sift();
+
+	public:
+		/* optional dm of the rows */
+		std::vector<double> vdm;
+		size_t nbatch;
+		uint32_t maxharm;
+		float threshold;
+		double minfreq;
+		size_t rn_width;
+		double rn_growth;
+		size_t rn_maxwidth;
+		/* bins of 1/T */
+		double sift_tolerance;
+		size_t maxcands;
+		std::string wisdomfile;
+		unsigned int fftw_flags;
+
+	public:
+		std::vector<PeriodicityCandidate> candidates;
+
+	private:
+		size_t ndm;
+		size_t nsamples;
+		size_t nbins;
+		double tsamp;
+		/* threads of the execution context at prepare, one scratch per thread */
+		unsigned int nthreads;
+		fftwf_plan plan;
+		std::vector<float *> fftin;
+		std::vector<fftwf_complex *> fftout;
+		std::vector<float> powers;
+		std::vector<float> sums;
+		std::vector<float> scratch;
+		std::vector<std::vector<PeriodicityCandidate>> rowcands;
+	};
+}
+
+#endif /* PERIODICITY_H */
@@ -14,6 +14,7 @@
 #include "equalize.h"
 #include "baseline.h"
 #include "rfi.h"
+#include "execcontext.h"
 
 namespace XLIBS {
 	class Pipeline : public DataBuffer<float>
@@ -26,9 +27,16 @@ namespace XLIBS {
 		~Pipeline();
 		void prepare(DataBuffer<float> &databuffer);
 		DataBuffer<float> * run(DataBuffer<float> &databuffer);		
+		/* threads and cores of the components, installed during prepare and run */
+		void set_context(const ExecutionContext &c){context = c;}
+		const ExecutionContext & get_context(){return context;}
+		/* state of the pipeline and of its components */
+		void save_state(Checkpoint &checkpoint, const std::string &prefix) const;
+		bool load_state(const Checkpoint &checkpoint, const std::string &prefix);
 
 	private:
 		mode_t mode;
+		ExecutionContext context;
 		//components
 		Downsample downsample;
 		Equalize equalize;
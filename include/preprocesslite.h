@@ -10,6 +10,7 @@
 #define PREPROCESSLITE_H
 
 #include "databuffer.h"
+#include "noisefill.h"
 
 class PreprocessLite : public DataBuffer<float>
 {
@@ -21,6 +22,7 @@ public:
 		thresig = 3.;
 		filltype = "mean";
 		killrate = 0.;
+		noise = NoiseFill(0, NoiseFill::salt("preprocesslite", 0));
 	}
 	PreprocessLite(nlohmann::json &config)
 	{
@@ -29,6 +31,7 @@ public:
 		thresig = config["zapthre"];
 		filltype = config["filltype"];
 		killrate = 0.;
+		noise = NoiseFill(config.value<uint64_t>("seed", 0), NoiseFill::salt("preprocesslite", config.value<uint64_t>("ibeam", 0)));
 	}
 	~PreprocessLite(){}
 	void read_config(nlohmann::json &config)
@@ -38,6 +41,7 @@ public:
 		thresig = config["zapthre"];
 		filltype = config["filltype"];
 		killrate = 0.;
+		noise = NoiseFill(config.value<uint64_t>("seed", 0), NoiseFill::salt("preprocesslite", config.value<uint64_t>("ibeam", 0)));
 	}
 	void prepare(DataBuffer<float> &databuffer);
 	DataBuffer<float> * run(DataBuffer<float> &databuffer);
@@ -51,6 +55,7 @@ public:
 
 	std::vector<pair<double, double>> zaplist;
 	std::vector<std::vector<unsigned char>> mask;
+	NoiseFill noise;
 };
 
 #endif /* PREPROCESSLITE_H */
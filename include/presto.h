@@ -9,9 +9,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/trim.hpp>
 
-#ifdef __AVX2__
-#include <boost/align/aligned_allocator.hpp>
-#endif
+#include "simd.h"
 
 namespace PRESTO 
 {
@@ -213,11 +211,7 @@ namespace PRESTO
 			datfile.seekg(skip_start*sizeof(float), std::ios::beg);
 			isample_cur = skip_start;
 		}
-#ifdef __AVX2__
-		int read_data(std::vector<float, boost::alignment::aligned_allocator<float, 32>> &data, int n)
-#else
-		int read_data(std::vector<float> &data, int n)
-#endif
+		int read_data(aligned_vector<float> &data, int n)
 		{
 			datfile.read((char *)(data.data()), sizeof(float)*n);
 			isample_cur += datfile.gcount() / sizeof(float);
@@ -15,6 +15,7 @@
 #include "filterbank.h"
 #include "databuffer.h"
 #include "mjd.h"
+#include "checkpoint.h"
 
 class PSRDataReader
 {
@@ -43,6 +44,11 @@ public:
 	virtual void check() = 0;
 	virtual void read_header() = 0;
 	virtual void skip_head() = 0;
+	/**
+	 * @brief move to sample isample of the observation (counted from the first sample like
+	 * skip_start), the next read_data starts there
+	 */
+	virtual void seek(size_t isample) = 0;
 	virtual size_t read_data(DataBuffer<float> &databuffer, size_t ndump, bool virtual_reading = false) = 0;
 	virtual size_t read_data(DataBuffer<unsigned char> &databuffer, size_t ndump, bool virtual_reading = false) = 0;
 	virtual MJD get_start_mjd_curfile() = 0;
@@ -54,6 +60,21 @@ public:
 	virtual void get_filterbank_template(Filterbank &fil) = 0;
 
 public:
+	/* position of the reader, load_state seeks to it, see checkpoint.h */
+	void save_state(Checkpoint &checkpoint, const std::string &prefix)
+	{
+		checkpoint.put(prefix + ".count", (uint64_t)get_count());
+	}
+
+	bool load_state(const Checkpoint &checkpoint, const std::string &prefix)
+	{
+		uint64_t count = 0;
+		if (!checkpoint.get(prefix + ".count", count) or count > nsamples) return false;
+
+		seek(count);
+		return true;
+	}
+
 	void get_fmin_fmax(double &fmin, double &fmax)
 	{
 		fmin = *std::min_element(frequencies.begin(), frequencies.end());
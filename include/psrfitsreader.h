@@ -20,6 +20,7 @@ public:
 	void check();
 	void read_header();
 	void skip_head();
+	void seek(size_t isample);
 	size_t read_data(DataBuffer<float> &databuffer, size_t ndump, bool virtual_reading = false);
 	size_t read_data(DataBuffer<unsigned char> &databuffer, size_t ndump, bool virtual_reading = false);
 	MJD get_start_mjd_curfile()
@@ -41,6 +42,7 @@ public:
 	void get_filterbank_template(Filterbank &filtem);
 
 private:
+	void skip_to(size_t isample);
 	Integration it;
 	Integration it8;
 	size_t ntot;
@@ -27,6 +27,11 @@ public:
     void prepare(DataBuffer<float> &databuffer);
     DataBuffer<T> * run(DataBuffer<float> &databuffer);
     DataBuffer<T> * get(){return this;}
+    /**
+     * @brief write one fold mode subint of (npol, nchans, nbin) profiles,
+     * prepare with mode FOLD and the folded data buffer first
+     */
+    void write_fold(float *profiles, double folding_period, double offs_sub);
     void close()
     {
         if (fits.fptr != NULL)
@@ -47,6 +52,9 @@ public:
     long int nsamp_per_subint;
     int ibeam;
     int npol;
+    /* fold mode */
+    int nbin;
+    double dm;
 public:
     string src_name;
     string ra;
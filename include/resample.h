@@ -0,0 +1,89 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 17:31:08
+ * @modify date 2026-10-19 17:31:08
+ * @desc [time domain resampling of dedispersed series for acceleration and orbital templates]
+ */
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <vector>
+#include <map>
+#include <utility>
+
+#include "databuffer.h"
+#include "kepler.h"
+#include "mjd.h"
+
+namespace Pulsar
+{
+	/**
+	 * @brief Resample time series to the pulsar frame of a set of templates, constant accelerations
+	 * first and then Kepler orbits. For a line of sight delay R(t), output sample i takes the input sample
+	 * i + round((R(t_i) - R(epoch)) / tsamp), with R(t) = a (t - epoch)^2 / 2c for an acceleration a and
+	 * the roemer delay for an orbit, which matches the phase model of Kepler::get_fphase.
+	 * All delays are measured from the same epoch, so a stream resampled block by block is the same
+	 * series as the concatenated blocks resampled at once.
+	 * The index maps are computed once per (nsamples, tsamp) and shared by all dms, resampling is
+	 * a vectorized gather. Row (k * ntemplate + t) of the output is dm k resampled with template t,
+	 * ready for PeriodicitySearch::run.
+	 */
+	class Resampler
+	{
+	public:
+		Resampler();
+		~Resampler();
+		/**
+		 * @brief build the index maps for series of nsamples at tsamp, if not built yet
+		 */
+		void prepare(size_t nsamples, double tsamp);
+		/**
+		 * @brief resample ndm rows of nsamples, row k starts at data + k * ld,
+		 * row (k * ntemplate + t) of the output starts at out + (k * ntemplate + t) * ldout
+		 */
+		void run(float *out, size_t ldout, const float *data, size_t ld, size_t ndm, size_t nsamples, double tsamp);
+		/**
+		 * @brief resample the samples of a (nsamples, nchans) data buffer with template t, e.g. subbands for folding.
+		 * The block starts at sample counter - nsamples since start_mjd. The last get_nlead() input samples
+		 * are not resampled yet, so output sample i of the block is sample counter - nsamples - get_nlead() + i
+		 * of the stream, the samples before the start of the stream are zeros. Calls with several templates
+		 * on the same block share the carried samples.
+		 */
+		void run(DataBuffer<float> &out, DataBuffer<float> &databuffer, size_t t);
+		size_t get_ntemplate(){return accs.size() + orbits.size();}
+		long int get_nlead(){return nforward;}
+
+	private:
+		const std::vector<int> & get_maps(size_t nsamples, double tsamp);
+		double get_delay(size_t t, double ti, double te);
+		void make_maps(std::vector<int> &map, size_t nsamples, double tsamp);
+		void prepare_stream(double tsamp);
+
+	public:
+		/* m/s^2 */
+		std::vector<double> accs;
+		std::vector<Kepler> orbits;
+		/* mjd of the first sample, for the orbits */
+		MJD start_mjd;
+		/* seconds since start_mjd the delays are measured from, the middle of the series if negative */
+		double epoch;
+		/* length of the stream in seconds, bounds the acceleration delays of the data buffer run */
+		double tobs;
+
+	private:
+		/* (ntemplate, nsamples) index maps for each (nsamples, tsamp) */
+		std::map<std::pair<size_t, double>, std::vector<int>> maps;
+		/* input samples that the next block still reads ahead or behind */
+		long int nforward;
+		long int nbackward;
+		/* (nbackward + nforward + nsamples, nchans), the carried samples and the last block */
+		std::vector<float> history;
+		/* (ntemplate, nsamples) rows of history for the last block, -1 before the start of the stream */
+		std::vector<int> blockmap;
+		long int blockstart;
+	};
+}
+
+#endif /* RESAMPLE_H */
@@ -14,6 +14,8 @@
 
 #include "databuffer.h"
 #include "equalize.h"
+#include "noisefill.h"
+#include "maskstream.h"
 
 using namespace std;
 
@@ -27,6 +29,11 @@ public:
 	~RFI();
 	void read_config(nlohmann::json &config);
 	void prepare(DataBuffer<float> &databuffer);
+	/**
+	 * @brief zap and the sk steps at the head of rfilist, which need power data, e.g. before
+	 * equalization in Pipeline, the next run only performs the remaining steps of the block
+	 */
+	DataBuffer<float> * prerun(DataBuffer<float> &databuffer);
 	DataBuffer<float> * run(DataBuffer<float> &databuffer);
 	DataBuffer<float> * zap(DataBuffer<float> &databuffer, const vector<pair<double, double>> &zaplist);
 	DataBuffer<float> * zdot(DataBuffer<float> &databuffer);
@@ -34,6 +41,18 @@ public:
 	DataBuffer<float> * mask(DataBuffer<float> &databuffer, float threRFI2, int td, int fd);
 	DataBuffer<float> * kadaneF(DataBuffer<float> &databuffer, float threRFI2, double widthlimit, int td, int fd);
 	DataBuffer<float> * kadaneT(DataBuffer<float> &databuffer, float threRFI2, double bandlimit, int td, int fd);
+	/**
+	 * @brief spectral kurtosis flagger on power data (before equalization, see prerun),
+	 * SK of each window of td samples and group of fd channels is computed from S1 and S2 sums,
+	 * cells deviating by more than threRFI sigma (quartile estimate over the block) are filled with the window mean
+	 */
+	DataBuffer<float> * sk(DataBuffer<float> &databuffer, float threRFI, int td, int fd);
+	/**
+	 * @brief apply the mask of rfi step from maskstream, without recomputing statistics
+	 * 
+	 * @return nullptr if the record does not match the data, the step should be computed
+	 */
+	DataBuffer<float> * replay(DataBuffer<float> &databuffer, size_t step);
 	DataBuffer<float> * get(){return this;}
 public:
 	string filltype;
@@ -44,8 +63,32 @@ public:
 	float threKadaneT;
 	double widthlimit;
 	double bandlimitKT;
+	float threSK;
+	/* skip kadaneF and kadaneT on blocks where sk flags nothing */
+	bool skgate;
+	long int skflagged;
+	NoiseFill noise;
+	/* record (open "w") or replay (open "r") the masks of mask, kadaneF, kadaneT and sk */
+	MaskStream maskstream;
+private:
+	DataBuffer<float> * run(DataBuffer<float> &databuffer, long int first, long int last);
+	void mark(long int i0, long int i1, long int j0, long int j1)
+	{
+		if (maskcells.empty()) return;
+		for (long int i=i0; i<i1; i++)
+		{
+			for (long int j=j0; j<j1; j++)
+			{
+				maskcells[i*nchans+j] = 1;
+			}
+		}
+	}
 private:
 	Equalize equalize;
+	std::vector<unsigned char> maskcells;
+	float maskfill;
+	/* number of steps done by prerun on the current block, -1 without prerun */
+	long int nprerun;
 };
 
 
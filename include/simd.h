@@ -0,0 +1,100 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 19:05:37
+ * @modify date 2026-10-19 19:05:37
+ * @desc [run time selection of the vector kernels]
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <boost/align/aligned_allocator.hpp>
+
+#include "numautils.h"
+
+/* clones of auto-vectorized loops, the variant is chosen by the loader from the cpu features */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && (__GNUC__ >= 6)
+	#define XLIBS_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+	#define XLIBS_TARGET_CLONES
+#endif
+
+/* no fused multiply-add contraction in between, for the code whose scalar and vector versions must agree bit for bit */
+#if defined(__GNUC__) && !defined(__clang__)
+#define XLIBS_EXACT_FP_BEGIN _Pragma("GCC push_options") _Pragma("GCC optimize (\"fp-contract=off\")")
+	#define XLIBS_EXACT_FP_END _Pragma("GCC pop_options")
+#else
+	#define XLIBS_EXACT_FP_BEGIN
+	#define XLIBS_EXACT_FP_END
+#endif
+
+namespace PulsarX
+{
+	enum SIMDLevel {SIMD_SCALAR=0, SIMD_AVX2=1, SIMD_AVX512=2};
+
+	/**
+	 * @brief kernels of avx2.h behind function pointers, so that one binary runs the best
+	 * implementation on each node. All of them take any size and alignment: the AVX2 kernels
+	 * need 32 byte aligned data and finish the tails with the scalar code, the AVX-512 kernels
+	 * use unaligned loads and masked tails. The AVX-512 table takes the AVX2 kernels of the
+	 * entries without an AVX-512 version.
+	 */
+	struct SIMDKernels
+	{
+		float (*reduce)(const float *data, size_t size);
+		void (*accumulate_mean)(double *mean, double *mean_scale, double scale, const float *data, size_t size);
+		void (*accumulate_mean_var)(double *mean, double *var, const float *data, size_t size);
+		void (*accumulate_mean_var2)(double &mean, double &var, const float *data, size_t size);
+		void (*remove_baseline)(float *data_out, const float *data_in, const float *a, const float *b, float s, size_t size);
+		float (*remove_baseline_reduce)(float *data_out, const float *data_in, const float *a, const float *b, float s, size_t size);
+		/* quantize to nbits and pack 8 / nbits samples per byte, lowest bits first */
+		void (*scale)(unsigned char *data_out, const float *data_in, float scl, float offs, unsigned int nbits, size_t size);
+		void (*accumulate_mean_var3)(float &mean, float &var, const float *data, size_t size);
+		void (*normalize2)(float *data_out, const float *data_in, const float *mean, const float *stddev_inv, size_t size);
+		/* sums of x, x^2, x^3, x^4 and of x times last_data, which is then set to x */
+		void (*accumulate_moments)(double *mean1, double *mean2, double *mean3, double *mean4, double *corr1, double *last_data, const float *data, size_t size);
+		/* Kadane along the rows of arr(nrow, ncol) for each column */
+		void (*kadane2D)(float *maxSum, int *start, int *end, const float *arr, size_t nrow, size_t ncol);
+		/* maximum positive (p) and negative (n) sums at once, arr has row stride ld */
+		void (*kadane2D_pn)(float *maxSum_p, int *start_p, int *end_p, float *maxSum_n, int *start_n, int *end_n, const float *arr, size_t nrow, size_t ncol, size_t ld);
+		/* best[i] = max(best[i], (a[i]-a[i-w])*scl) of the prefix sum a, bestw[i] is the width of the maximum */
+		void (*boxcar_max)(float *best, int *bestw, const float *a, size_t size, int w, float scl);
+		/* sum[k] = power[k/nh] + power[2k/nh] + ... + power[k], nh is a power of 2 */
+		void (*harmonic_sum)(float *sum, const float *power, size_t size, int nh);
+		/* bins[i] = floor(frac(phi0 + i * dphi) * nbin) */
+		void (*phase_bins)(int *bins, double phi0, double dphi, size_t size, int nbin);
+		/* out[i] = in[idx[i]] */
+		void (*gather)(float *out, const float *in, const int *idx, size_t size);
+		/* 32 standard normals of the Philox4x32-10 stream (seed, counter, channel), see noisefill.h,
+		 * bit identical in all tables */
+		void (*normal32)(float *out, uint64_t block, uint64_t counter, uint32_t channel, uint64_t seed);
+		/* out(ncol, nrow) = in(nrow, ncol)^T with row strides ldo and ldi, nrow and ncol are multiples of 16,
+		 * stream writes the output with non-temporal stores */
+		void (*transpose16)(float *out, long int ldo, const float *in, long int ldi, long int nrow, long int ncol, bool stream);
+	};
+
+	/**
+	 * @brief highest level supported by the cpu, lowered by the environment variable
+	 * XLIBS_SIMD=scalar|avx2|avx512
+	 */
+	SIMDLevel get_simd_level();
+	/**
+	 * @brief select the kernels of level, clipped to the cpu
+	 */
+	void set_simd_level(SIMDLevel level);
+	const char * get_simd_name(SIMDLevel level);
+	const SIMDKernels & get_scalar_kernels();
+	const SIMDKernels & simd_kernels();
+	/* false on cpus without AVX2 or with XLIBS_SIMD=scalar, the callers keep their own scalar loops */
+	inline bool simd_enabled() {return &simd_kernels() != &get_scalar_kernels();}
+
+	/* defined in simd_avx2.cpp and simd_avx512.cpp, built with AVX2 and AVX-512 whatever the global flags */
+	const SIMDKernels & get_avx2_kernels();
+	const SIMDKernels & get_avx512_kernels();
+}
+
+#endif /* SIMD_H */
@@ -0,0 +1,93 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 15:41:18
+ * @modify date 2026-10-19 15:41:18
+ * @desc [streaming matched filter single pulse search of dm-time data]
+ */
+
+#ifndef SINGLEPULSE_H
+#define SINGLEPULSE_H
+
+#include <stdint.h>
+#include <vector>
+#include "databuffer.h"
+
+namespace Pulsar
+{
+	struct SinglePulseCandidate
+	{
+		uint32_t idm;
+		uint32_t width;
+		/* first sample of the boxcar since the start of the stream */
+		int64_t sample;
+		float snr;
+	};
+
+	/**
+	 * @brief Boxcar search of ndm rows of dedispersed time series, block by block.
+	 * Each row is normalized by a running median and interquartile range, and boxcars of
+	 * log-spaced widths are evaluated from the prefix sum. The last maxwidth-1 samples of a row
+	 * are carried to the next block, so every boxcar is evaluated once, at the block holding its end.
+	 * Runs of samples above threshold give one candidate, the boxcar of maximum S/N, reported
+	 * by the block where the run ends, so a run across blocks is reported once.
+	 */
+	class SinglePulseSearch
+	{
+	public:
+		SinglePulseSearch();
+		~SinglePulseSearch();
+		void prepare(size_t ndm, size_t ndump, double tsamp);
+		/**
+		 * @brief search ndm rows of ndump samples, row k starts at data + k * ld
+		 */
+		void run(const float *data, size_t ld);
+		/**
+		 * @brief search a (ndump, ndm) data buffer, e.g. dm trials as channels
+		 */
+		void run(DataBuffer<float> &databuffer);
+		/**
+		 * @brief candidates of the runs still open at the end of the stream
+		 */
+		void flush();
+
+	private:
+		void update_stats(size_t k, const float *row, float *scratch);
+
+	public:
+		float threshold;
+		size_t maxwidth;
+		/* ratio of neighbouring widths */
+		double width_step;
+		/* weight of the new block in the running statistics */
+		double alpha;
+
+	public:
+		long int counter;
+		std::vector<int> widths;
+		std::vector<SinglePulseCandidate> candidates;
+
+	private:
+		size_t ndm;
+		size_t ndump;
+		double tsamp;
+		size_t ntail;
+		/* threads of the execution context at prepare, one scratch per thread */
+		unsigned int nthreads;
+		bool stats_ready;
+		std::vector<float> medians;
+		std::vector<float> sigmas;
+		std::vector<float> tails;
+		std::vector<float> bufferT;
+		std::vector<float> prefix;
+		std::vector<float> best;
+		std::vector<int> bestw;
+		std::vector<float> scratch;
+		std::vector<std::vector<SinglePulseCandidate>> rowcands;
+		/* run of row k above threshold at the end of the last block */
+		std::vector<unsigned char> openruns;
+		std::vector<SinglePulseCandidate> opencands;
+	};
+}
+
+#endif /* SINGLEPULSE_H */
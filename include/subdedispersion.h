@@ -31,6 +31,9 @@ namespace RealTime
 		void prepare();
 		void run(vector<float> &data);
 		void cache();
+		/* counter, dead channels, overlap rows of the buffer and the caches, see checkpoint.h */
+		void save_state(Checkpoint &checkpoint, const string &prefix) const;
+		bool load_state(const Checkpoint &checkpoint, const string &prefix);
 		void get_subdata(vector<float> &subdata, int idm, bool overlaped=false) const;
 		void get_timdata(vector<float> &timdata, int idm, bool overlaped=false) const;
 		void dumpsubdata(const string &rootname, int idm) const
@@ -76,8 +79,12 @@ namespace RealTime
 		vector<int> fcnt;
 		vector<int> decodeidm;
 		vector<int> decodeisub;
+		/* flagged subbands, see DataBuffer::chmask */
+		vector<unsigned char> chmask;
 	public:
 		long int counter;
+		vector<int> ndead;
+		vector<bool> dead;
 		vector<int> mxdelayn;
 		vector<float> buffer;
 		vector<float> bufferT;
@@ -98,6 +105,9 @@ namespace RealTime
 		void prepare(DataBuffer<float> &databuffer);
 		void run(DataBuffer<float> &databuffer, long int ns);
 		void cache(){sub.cache();}
+		/* counters, statistics, dead channels and overlap rows, including the subband stage, see checkpoint.h */
+		void save_state(Checkpoint &checkpoint, const string &prefix) const;
+		bool load_state(const Checkpoint &checkpoint, const string &prefix);
 		void modifynblock();
 		void makeinf(Filterbank &fil);
 		void makeinf(long double tstart, std::string telescope, std::string source_name, std::string ra, std::string dec, double mean, double stddev);
@@ -132,6 +142,8 @@ namespace RealTime
 		double ddm;
 		int ndm;
 		double overlap;
+		/* 0 for round(sqrt(nchans)) */
+		int nsubband;
 	public:
 		double mean;
 		double var;
@@ -139,12 +151,13 @@ namespace RealTime
 		long int counter;
 		int offset;
 		int noverlap;
-		int nsubband;
 		int nchans;
 		long int nsamples;
 		double tsamp;
 		vector<double> frequencies;
 		vector<int> mxdelayn;
+		vector<int> ndead;
+		vector<bool> dead;
 		vector<int> fmap;
 		vector<int> fcnt;
 		vector<double> frefsub;
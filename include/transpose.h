@@ -0,0 +1,41 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 18:20:14
+ * @modify date 2026-10-19 18:20:14
+ * @desc [cache-oblivious multithreaded matrix transpose]
+ */
+
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include <stddef.h>
+
+struct TransposeConfig
+{
+	/* rows and columns of the leaf blocks, multiples of the kernel size */
+	long int tiley;
+	long int tilex;
+	/* output bytes above which aligned outputs are written with non-temporal stores */
+	size_t stream_threshold;
+	bool calibrated;
+};
+
+/**
+ * @brief time the leaf shapes once on a matrix larger than the L2 cache and keep the fastest one,
+ * the streaming threshold is the size of the last level cache. Called by the first transpose,
+ * force recalibrates. Returns a copy of the config, which may be recalibrated concurrently.
+ */
+TransposeConfig transpose_calibrate(bool force=false);
+
+/**
+ * @brief out(n, m) = in(m, n)^T. The matrix is halved recursively along the edge with more leaves
+ * down to tiley x tilex leaf blocks, which are distributed over the threads in the recursion order
+ * so that each thread works on a compact region of both matrices. 4 byte types are transposed in
+ * registers by 16x16 kernels (AVX-512, or four 8x8 with AVX2, chosen at run time, see simd.h), other types
+ * and the edges element by element.
+ */
+template <typename T>
+void transpose_fast(T *out, const T *in, long int m, long int n);
+
+#endif /* TRANSPOSE_H */
@@ -112,6 +112,19 @@ void runMedian2(T *data, T *datMedian, long int size, int w);
 template <typename T>
 void runMedian3(T *data, T *datMedian, long int size, int w);
 
+/**
+ * @brief Select the elements of given ranks, same as std::nth_element on a copy of data,
+ * but in parallel: the ranks are bracketed from a subsample, located with per-thread
+ * histograms, and resolved exactly from the few values gathered in the hit bins
+ *
+ * @param values: output, values[k] is the element of rank ranks[k] in ascending order
+ * @param data
+ * @param size
+ * @param ranks
+ */
+template <typename T>
+void parallel_nth_element(std::vector<T> &values, const T *data, size_t size, const std::vector<size_t> &ranks);
+
 #ifdef __AVX2__
 void transpose_AVX2(float *out, float *in, int m, int n);
 #endif
@@ -45,6 +45,7 @@ DataBuffer<T>::DataBuffer(const DataBuffer<T> &databuffer)
 	means = databuffer.means;
 	vars = databuffer.vars;
 	weights = databuffer.weights;
+	chmask = databuffer.chmask;
 
 	buffer = databuffer.buffer;
 }
@@ -65,6 +66,7 @@ DataBuffer<T> & DataBuffer<T>::operator=(const DataBuffer<T> &databuffer)
 	means = databuffer.means;
 	vars = databuffer.vars;
 	weights = databuffer.weights;
+	chmask = databuffer.chmask;
 
 	buffer = databuffer.buffer;
 
@@ -110,9 +112,7 @@ void DataBuffer<T>::prepare(DataBuffer<T> &databuffer)
 template <typename T>
 DataBuffer<T> * DataBuffer<T>::run(DataBuffer<T> &databuffer)
 {
-	if (closable) open();
-
-	buffer = databuffer.buffer;
+	take(databuffer);
 
 	means = databuffer.means;
 	vars = databuffer.vars;
@@ -140,6 +140,73 @@ DataBuffer<T> * DataBuffer<T>::filter(DataBuffer<T> &databuffer)
 	return databuffer.get();
 };
 
+template <typename T>
+DataHandle<T> DataBuffer<T>::share()
+{
+	if (closable) return DataHandle<T>(buffer, nsamples, nchans);
+
+	aligned_vector<T> temp(buffer);
+	return DataHandle<T>(temp, nsamples, nchans);
+}
+
+template <typename T>
+void DataBuffer<T>::take(DataBuffer<T> &databuffer)
+{
+	if (&databuffer == this) return;
+
+	if (databuffer.closable)
+		buffer.swap(databuffer.buffer);
+	else
+		buffer = databuffer.buffer;
+}
+
+template <typename T>
+void DataBuffer<T>::save_state(Checkpoint &checkpoint, const string &prefix) const
+{
+	checkpoint.put(prefix + ".counter", counter);
+	checkpoint.put(prefix + ".equalized", equalized);
+	checkpoint.put(prefix + ".mean_var_ready", mean_var_ready);
+	checkpoint.put(prefix + ".means", means);
+	checkpoint.put(prefix + ".vars", vars);
+	checkpoint.put(prefix + ".weights", weights);
+	checkpoint.put(prefix + ".chmask", chmask);
+}
+
+template <typename T>
+bool DataBuffer<T>::load_state(const Checkpoint &checkpoint, const string &prefix)
+{
+	long int counter_chk = 0;
+	bool equalized_chk = false, mean_var_ready_chk = false;
+	vector<double> means_chk, vars_chk, weights_chk;
+	vector<unsigned char> chmask_chk;
+
+	if (!checkpoint.get(prefix + ".counter", counter_chk) or
+		!checkpoint.get(prefix + ".equalized", equalized_chk) or
+		!checkpoint.get(prefix + ".mean_var_ready", mean_var_ready_chk) or
+		!checkpoint.get(prefix + ".means", means_chk) or
+		!checkpoint.get(prefix + ".vars", vars_chk) or
+		!checkpoint.get(prefix + ".weights", weights_chk) or
+		!checkpoint.get(prefix + ".chmask", chmask_chk))
+		return false;
+
+	if (means_chk.size() != means.size() or vars_chk.size() != vars.size() or weights_chk.size() != weights.size())
+		return false;
+
+	/* an empty mask flags nothing, otherwise one entry per channel */
+	if (!chmask_chk.empty() and chmask_chk.size() != (size_t)nchans)
+		return false;
+
+	counter = counter_chk;
+	equalized = equalized_chk;
+	mean_var_ready = mean_var_ready_chk;
+	means.swap(means_chk);
+	vars.swap(vars_chk);
+	weights.swap(weights_chk);
+	chmask.swap(chmask_chk);
+
+	return true;
+}
+
 template <typename T>
 void DataBuffer<T>::open()
 {
@@ -9,6 +9,8 @@
 #include <iostream>
 #include <fstream>
 #include <string.h>
+#include <algorithm>
+#include <thread>
 #include "fifo.h"
 #include "dedisperse.h"
 
@@ -210,7 +212,7 @@ void FIFO<T>::get_mean_rms(vector<T> &mean, vector<T> &rms)
 	mean.resize(nchans, 0);
 	rms.resize(nchans, 0);
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<nsamples; i++)
 	{
@@ -229,34 +231,39 @@ void FIFO<T>::get_mean_rms(vector<T> &mean, vector<T> &rms)
 	}
 }
 
+/**
+ * @brief first ring row of each channel for a delayed write of ns samples, the write of channel j
+ * is the rows [base[j], base[j]+ns) wrapped once at nsamples, i.e. at most two contiguous segments
+ */
+static inline void get_write_base(vector<long int> &base, const long int *delay, long int nc, long int nw, long int nsamples)
+{
+	base.resize(nc);
+	for (long int j=0; j<nc; j++)
+	{
+		long int r = (nw-delay[j])%nsamples;
+		base[j] = r < 0 ? r+nsamples : r;
+	}
+}
+
 /* (nsamples, nchans) */
 template <typename T>
 void FIFO<T>::write(T *data, long int ns, long int nc)
 {
-	T *pw = buffer+nw*nchans;
+	vector<long int> base;
+	get_write_base(base, delay, nc, nw, nsamples);
+
+	const long int *pbase = base.data();
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<ns; i++)
 	{
-		T *pd = data+i*nchans;
+		const T *pd = data+i*nchans;
 		for (long int j=0; j<nc; j++)
 		{
-			long int l = i-delay[j];
-
-			if (nw+l >= 0 and nw+l < nsamples)
-			{
-				pw[l*nchans + j] = *pd;
-			}
-			else if (nw+l < 0)
-			{
-				pw[(l+nsamples)*nchans + j] = *pd;
-			}
-			else if (nw+l >= nsamples)
-			{
-				pw[(l-nsamples)*nchans + j] = *pd;
-			}
-			pd++;
+			long int r = pbase[j]+i;
+			r -= r >= nsamples ? nsamples : 0;
+			buffer[r*nchans+j] = pd[j];
 		}
 	}
 	ndata += ns;
@@ -269,7 +276,7 @@ void FIFO<T>::write_raw(T *data, long int ns, long int nc)
 {
 	T *pw = buffer+nw*nchans;
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<ns; i++)
 	{
@@ -297,7 +304,7 @@ void FIFO<T>::read(T *data, long int ns, long int nc)
 {
 	T *pr = buffer+nr*nchans;
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<ns; i++)
 	{
@@ -325,7 +332,7 @@ void FIFO<T>::readT_T(T *data, long int nc, long int ns)
 {
 	T *pr = buffer+nr;
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int j=0; j<nc; j++)
 	{
@@ -351,30 +358,19 @@ void FIFO<T>::readT_T(T *data, long int nc, long int ns)
 template <typename T>
 void FIFO<T>::writeT_T(T *data, long int nc, long int ns)
 {
-	T *pw = buffer+nw;
+	vector<long int> base;
+	get_write_base(base, delay, nc, nw, nsamples);
+
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int j=0; j<nc; j++)
 	{
-		T *pdw = pw+j*nsamples;
-		long int l = -delay[j];
-		for (long int i=0; i<ns; i++)
-		{
-			if (nw+l >= 0 and nw+l < nsamples)
-			{
-				pdw[l] = data[j*ns+i];
-			}
-			else if (nw+l < 0)
-			{
-				pdw[l+nsamples] = data[j*ns+i];
-			}
-			else if (nw+l >= nsamples)
-			{
-				pdw[l-nsamples] = data[j*ns+i];
-			}
-			l++;
-		}
+		T *pdw = buffer+j*nsamples;
+		const T *pd = data+j*ns;
+		long int n0 = std::min(ns, nsamples-base[j]);
+		std::copy(pd, pd+n0, pdw+base[j]);
+		std::copy(pd+n0, pd+ns, pdw);
 	}
 
 	ndata += ns;
@@ -387,7 +383,7 @@ void FIFO<T>::read_T(T *data, long int ns, long int nc)
 {
 	T *pr = buffer+nr;
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int j=0; j<nc; j++)
 	{
@@ -413,29 +409,25 @@ void FIFO<T>::read_T(T *data, long int ns, long int nc)
 template <typename T>
 void FIFO<T>::write_T(T *data, long int ns, long int nc)
 {
-	T *pw = buffer+nw;
+	vector<long int> base;
+	get_write_base(base, delay, nc, nw, nsamples);
+
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int j=0; j<nc; j++)
 	{
-		T *pdw = pw+j*nsamples;
-		long int l = -delay[j];
-		for (long int i=0; i<ns; i++)
+		T *pdw = buffer+j*nsamples+base[j];
+		const T *pd = data+j;
+		long int n0 = std::min(ns, nsamples-base[j]);
+		for (long int i=0; i<n0; i++)
 		{
-			if (nw+l >= 0 and nw+l < nsamples)
-			{
-				pdw[l] = data[i*nc+j];
-			}
-			else if (nw+l < 0)
-			{
-				pdw[l+nsamples] = data[i*nc+j];
-			}
-			else if (nw+l >= nsamples)
-			{
-				pdw[l-nsamples] = data[i*nc+j];
-			}
-			l++;
+			pdw[i] = pd[i*nc];
+		}
+		pdw -= nsamples;
+		for (long int i=n0; i<ns; i++)
+		{
+			pdw[i] = pd[i*nc];
 		}
 	}
 
@@ -449,7 +441,7 @@ void FIFO<T>::write_raw_T(T *data, long int ns, long int nc)
 {
 	T *pw = buffer+nw;
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int j=0; j<nc; j++)
 	{
@@ -674,7 +666,7 @@ void FIFO_T<T>::read(T *data, long int nc, long int ns)
 {
 	T *pr = buffer+nr;
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int j=0; j<nc; j++)
 	{
@@ -700,30 +692,19 @@ void FIFO_T<T>::read(T *data, long int nc, long int ns)
 template <typename T>
 void FIFO_T<T>::write(T *data, long int nc, long int ns)
 {
-	T *pw = buffer+nw;
+	vector<long int> base;
+	get_write_base(base, delay, nc, nw, nsamples);
+
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int j=0; j<nc; j++)
 	{
-		T *pdw = pw+j*nsamples;
-		long int l = -delay[j];
-		for (long int i=0; i<ns; i++)
-		{
-			if (nw+l >= 0 and nw+l < nsamples)
-			{
-				pdw[l] = data[j*ns+i];
-			}
-			else if (nw+l < 0)
-			{
-				pdw[l+nsamples] = data[j*ns+i];
-			}
-			else if (nw+l >= nsamples)
-			{
-				pdw[l-nsamples] = data[j*ns+i];
-			}
-			l++;
-		}
+		T *pdw = buffer+j*nsamples;
+		const T *pd = data+j*ns;
+		long int n0 = std::min(ns, nsamples-base[j]);
+		std::copy(pd, pd+n0, pdw+base[j]);
+		std::copy(pd+n0, pd+ns, pdw);
 	}
 
 	ndata += ns;
@@ -736,7 +717,7 @@ void FIFO_T<T>::write_raw(T *data, long int nc, long int ns)
 {
 	T *pw = buffer+nw;
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int j=0; j<nc; j++)
 	{
@@ -761,6 +742,235 @@ void FIFO_T<T>::write_raw(T *data, long int nc, long int ns)
 	nw = nw >= nsamples? nw-nsamples:nw;
 }
 
+/* =======================================================================================================================================*/
+
+template <typename T>
+ConcurrentFIFO<T>::ConcurrentFIFO()
+{
+	policy = BLOCK;
+	nsamples = 0;
+	nchans = 0;
+	buffer = NULL;
+	head.value = 0;
+	whead.value = 0;
+	tail.value = 0;
+	rtail.value = 0;
+	closed = false;
+}
+
+template <typename T>
+ConcurrentFIFO<T>::~ConcurrentFIFO()
+{
+	if (buffer != NULL)
+	{
+		delete [] buffer;
+		buffer = NULL;
+	}
+}
+
+template <typename T>
+void ConcurrentFIFO<T>::resize(long int ns, long int nc)
+{
+	if (ns != nsamples or nc != nchans)
+	{
+		if (buffer != NULL)
+		{
+			delete [] buffer;
+			buffer = NULL;
+		}
+
+		buffer = new T [ns*nc];
+		nsamples = ns;
+		nchans = nc;
+	}
+
+	std::fill(buffer, buffer+nsamples*nchans, T());
+	reset();
+}
+
+/* not thread safe */
+template <typename T>
+void ConcurrentFIFO<T>::reset()
+{
+	head.value = 0;
+	whead.value = 0;
+	tail.value = 0;
+	rtail.value = 0;
+	closed = false;
+}
+
+template <typename T>
+FIFOSpan<T> ConcurrentFIFO<T>::get_span(long int start, long int ns)
+{
+	FIFOSpan<T> span;
+	if (nsamples == 0)
+	{
+		span.start = start;
+		span.ns[0] = 0;
+		span.ns[1] = 0;
+		span.data[0] = buffer;
+		span.data[1] = buffer;
+		return span;
+	}
+
+	long int pos = start%nsamples;
+	span.start = start;
+	span.ns[0] = std::min(ns, nsamples-pos);
+	span.ns[1] = ns-span.ns[0];
+	span.data[0] = buffer+pos*nchans;
+	span.data[1] = buffer;
+	return span;
+}
+
+template <typename T>
+template <typename Predicate>
+void ConcurrentFIFO<T>::wait(Predicate pred)
+{
+	if (policy == SPIN)
+	{
+		long int n = 0;
+		while (!pred())
+		{
+			if (++n > 64) std::this_thread::yield();
+		}
+	}
+	else
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		cv.wait(lock, pred);
+	}
+}
+
+template <typename T>
+void ConcurrentFIFO<T>::notify()
+{
+	if (policy == BLOCK)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		cv.notify_all();
+	}
+}
+
+/**
+ * @brief reserve ns samples for writing, the span is empty if the fifo is closed
+ */
+template <typename T>
+FIFOSpan<T> ConcurrentFIFO<T>::acquire_write(long int ns)
+{
+	if (ns > nsamples)
+	{
+		cerr<<"Error: span is larger than fifo"<<endl;
+		return get_span(whead.value.load(), 0);
+	}
+
+	long int start = 0;
+	while (true)
+	{
+		wait([&]() {start = whead.value.load(); return start+ns-tail.value.load(std::memory_order_acquire) <= nsamples or closed.load();});
+		if (closed.load()) return get_span(start, 0);
+
+		if (whead.value.compare_exchange_weak(start, start+ns)) break;
+	}
+
+	return get_span(start, ns);
+}
+
+/**
+ * @brief publish the samples of span, after the spans reserved before it
+ */
+template <typename T>
+void ConcurrentFIFO<T>::commit(const FIFOSpan<T> &span)
+{
+	if (span.size() == 0) return;
+
+	wait([&]() {return head.value.load(std::memory_order_acquire) == span.start;});
+	head.value.store(span.start+span.size(), std::memory_order_release);
+	notify();
+}
+
+/**
+ * @brief reserve ns samples for reading, fewer if the fifo is closed
+ */
+template <typename T>
+FIFOSpan<T> ConcurrentFIFO<T>::acquire_read(long int ns)
+{
+	if (ns > nsamples)
+	{
+		cerr<<"Error: span is larger than fifo"<<endl;
+		return get_span(rtail.value.load(), 0);
+	}
+
+	long int start = 0;
+	while (true)
+	{
+		wait([&]() {start = rtail.value.load(); return head.value.load(std::memory_order_acquire)-start >= ns or closed.load();});
+
+		long int n = std::min(ns, head.value.load(std::memory_order_acquire)-start);
+		if (n <= 0) return get_span(start, 0);
+
+		if (rtail.value.compare_exchange_weak(start, start+n)) return get_span(start, n);
+	}
+}
+
+/**
+ * @brief free the samples of span for writing, after the spans reserved before it
+ */
+template <typename T>
+void ConcurrentFIFO<T>::release(const FIFOSpan<T> &span)
+{
+	if (span.size() == 0) return;
+
+	wait([&]() {return tail.value.load(std::memory_order_acquire) == span.start;});
+	tail.value.store(span.start+span.size(), std::memory_order_release);
+	notify();
+}
+
+template <typename T>
+void ConcurrentFIFO<T>::write(const T *data, long int ns)
+{
+	FIFOSpan<T> span = acquire_write(ns);
+	if (span.size() < ns) return;
+
+	memcpy(span.data[0], data, sizeof(T)*span.ns[0]*nchans);
+	memcpy(span.data[1], data+span.ns[0]*nchans, sizeof(T)*span.ns[1]*nchans);
+
+	commit(span);
+}
+
+/**
+ * @brief read ns samples, return the number read, which is less than ns only after close
+ */
+template <typename T>
+long int ConcurrentFIFO<T>::read(T *data, long int ns)
+{
+	FIFOSpan<T> span = acquire_read(ns);
+
+	memcpy(data, span.data[0], sizeof(T)*span.ns[0]*nchans);
+	memcpy(data+span.ns[0]*nchans, span.data[1], sizeof(T)*span.ns[1]*nchans);
+
+	release(span);
+
+	return span.size();
+}
+
+/**
+ * @brief no more writes, wake up all waiting threads
+ */
+template <typename T>
+void ConcurrentFIFO<T>::close()
+{
+	if (policy == BLOCK)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		closed = true;
+		cv.notify_all();
+	}
+	else
+	{
+		closed = true;
+	}
+}
+
 template class FIFO<unsigned char>;
 template class FIFO<float>;
 template class FIFO<double>;
@@ -771,3 +981,8 @@ template class FIFO_T<unsigned char>;
 template class FIFO_T<float>;
 template class FIFO_T<double>;
 template class FIFO_T<complex<double>>;
+
+template class ConcurrentFIFO<unsigned char>;
+template class ConcurrentFIFO<float>;
+template class ConcurrentFIFO<double>;
+template class ConcurrentFIFO<complex<float>>;
@@ -6,11 +6,13 @@
  */
 
 #include "kdtree.h"
+#include "dedisperse.h"
 
 #include <iostream>
 #include <vector>
 #include <utility>
 #include <algorithm>
+#include <numeric>
 
 using namespace std;
 
@@ -288,8 +290,283 @@ void KDtree<T>::showRec(KDnode<T> *root)
 	showRec(root->right);
 }
 
+/* =======================================================================================================================================*/
+
+template <typename T>
+FlatKDtree<T>::FlatKDtree()
+{
+	ndim = 0;
+	ncluster = 0;
+	leafsize = 32;
+	npoints = 0;
+}
+
+template <typename T>
+FlatKDtree<T>::FlatKDtree(int k)
+{
+	ndim = k;
+	ncluster = 0;
+	leafsize = 32;
+	npoints = 0;
+}
+
+template <typename T>
+FlatKDtree<T>::~FlatKDtree(){}
+
+template <typename T>
+void FlatKDtree<T>::build(const vector<vector<T>> &points)
+{
+	npoints = points.size();
+
+	vector<T> pts(ndim*npoints);
+	for (long int i=0; i<npoints; i++)
+	{
+		for (long int d=0; d<ndim; d++)
+		{
+			pts[d*npoints+i] = points[i][d];
+		}
+	}
+
+	perm.resize(npoints);
+	iota(perm.begin(), perm.end(), 0);
+
+	/* the ranges of one level are independent */
+	vector<pair<long int, long int>> level(1, make_pair(0L, npoints));
+	vector<pair<long int, long int>> next;
+	long int depth = 0;
+	while (!level.empty())
+	{
+		const T *x = pts.data()+(depth%ndim)*npoints;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(XLIBS::get_num_threads())
+#endif
+		for (size_t r=0; r<level.size(); r++)
+		{
+			long int lo = level[r].first;
+			long int hi = level[r].second;
+			if (hi-lo <= leafsize) continue;
+
+			long int mid = lo+(hi-lo)/2;
+			nth_element(perm.begin()+lo, perm.begin()+mid, perm.begin()+hi, [x](long int a, long int b) {return x[a] < x[b];});
+		}
+
+		next.clear();
+		for (auto r=level.begin(); r!=level.end(); ++r)
+		{
+			if (r->second-r->first <= leafsize) continue;
+
+			long int mid = r->first+(r->second-r->first)/2;
+			next.push_back(make_pair(r->first, mid));
+			next.push_back(make_pair(mid+1, r->second));
+		}
+		swap(level, next);
+		depth++;
+	}
+
+	coords.resize(ndim*npoints);
+	for (long int d=0; d<ndim; d++)
+	{
+		for (long int p=0; p<npoints; p++)
+		{
+			coords[d*npoints+p] = pts[d*npoints+perm[p]];
+		}
+	}
+
+	clusterID.assign(npoints, 0);
+	flag.assign(npoints, 0);
+	ncluster = 0;
+}
+
+/**
+ * @brief call visit(p) for the points p within squared distance radius, stop when it returns true
+ */
+template <typename T>
+template <typename F>
+bool FlatKDtree<T>::searchRec(long int lo, long int hi, long int depth, const T *point, T radius, F &visit)
+{
+	if (hi-lo <= leafsize)
+	{
+		for (long int p=lo; p<hi; p++)
+		{
+			T dis = 0;
+			for (long int d=0; d<ndim; d++)
+			{
+				T diff = coords[d*npoints+p]-point[d];
+				dis += diff*diff;
+			}
+			if (dis <= radius and visit(p)) return true;
+		}
+		return false;
+	}
+
+	long int mid = lo+(hi-lo)/2;
+	int dim = depth%ndim;
+
+	T dis = 0;
+	for (long int d=0; d<ndim; d++)
+	{
+		T diff = coords[d*npoints+mid]-point[d];
+		dis += diff*diff;
+	}
+	if (dis <= radius and visit(mid)) return true;
+
+	T diff = point[dim]-coords[dim*npoints+mid];
+	if (diff < 0)
+	{
+		if (searchRec(lo, mid, depth+1, point, radius, visit)) return true;
+		if (diff*diff <= radius and searchRec(mid+1, hi, depth+1, point, radius, visit)) return true;
+	}
+	else
+	{
+		if (searchRec(mid+1, hi, depth+1, point, radius, visit)) return true;
+		if (diff*diff <= radius and searchRec(lo, mid, depth+1, point, radius, visit)) return true;
+	}
+
+	return false;
+}
+
+template <typename T>
+void FlatKDtree<T>::findNeighbors(const vector<T> &point, T radius, vector<long int> &neighbors)
+{
+	neighbors.clear();
+	auto visit = [&](long int p) {neighbors.push_back(perm[p]); return false;};
+	searchRec(0, npoints, 0, point.data(), radius, visit);
+}
+
+template <typename T>
+long int FlatKDtree<T>::find(long int i)
+{
+	/* path halving, the links only move up so the races are benign */
+	long int x = i;
+	while (true)
+	{
+		long int p = __atomic_load_n(&parent[x], __ATOMIC_RELAXED);
+		if (p == x) return x;
+		long int gp = __atomic_load_n(&parent[p], __ATOMIC_RELAXED);
+		if (gp != p) __atomic_compare_exchange_n(&parent[x], &p, gp, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+		x = gp;
+	}
+}
+
+template <typename T>
+void FlatKDtree<T>::unite(long int i, long int j)
+{
+	/* link the larger root under the smaller one */
+	while (true)
+	{
+		i = find(i);
+		j = find(j);
+		if (i == j) return;
+		if (i < j) swap(i, j);
+
+		long int expected = i;
+		if (__atomic_compare_exchange_n(&parent[i], &expected, j, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return;
+	}
+}
+
+template <typename T>
+void FlatKDtree<T>::runDBSCAN(T radius2, int k)
+{
+	vector<unsigned char> core(npoints, 0);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(XLIBS::get_num_threads())
+#endif
+	for (long int p=0; p<npoints; p++)
+	{
+		vector<T> point(ndim);
+		for (long int d=0; d<ndim; d++) point[d] = coords[d*npoints+p];
+
+		long int count = 0;
+		auto visit = [&count, k](long int) {return ++count >= k;};
+		searchRec(0, npoints, 0, point.data(), radius2, visit);
+
+		core[p] = count >= k;
+	}
+
+	parent.resize(npoints);
+	iota(parent.begin(), parent.end(), 0);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(XLIBS::get_num_threads())
+#endif
+	for (long int p=0; p<npoints; p++)
+	{
+		if (!core[p]) continue;
+
+		vector<T> point(ndim);
+		for (long int d=0; d<ndim; d++) point[d] = coords[d*npoints+p];
+
+		auto visit = [&](long int q) {if (core[q] and q < p) unite(p, q); return false;};
+		searchRec(0, npoints, 0, point.data(), radius2, visit);
+	}
+
+	/* root of each point, -1 for noise */
+	vector<long int> root(npoints, -1);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(XLIBS::get_num_threads())
+#endif
+	for (long int p=0; p<npoints; p++)
+	{
+		if (core[p])
+		{
+			root[p] = find(p);
+			continue;
+		}
+
+		vector<T> point(ndim);
+		for (long int d=0; d<ndim; d++) point[d] = coords[d*npoints+p];
+
+		long int nearest = -1;
+		auto visit = [&](long int q) {if (core[q]) {nearest = q; return true;} return false;};
+		searchRec(0, npoints, 0, point.data(), radius2, visit);
+
+		if (nearest >= 0) root[p] = find(nearest);
+	}
+
+	/* number the clusters in the order of the input points */
+	vector<long int> pos(npoints);
+	for (long int p=0; p<npoints; p++) pos[perm[p]] = p;
+
+	vector<int> ids(npoints, 0);
+	ncluster = 0;
+	for (long int i=0; i<npoints; i++)
+	{
+		long int p = pos[i];
+		if (root[p] < 0)
+		{
+			clusterID[i] = 0;
+		}
+		else
+		{
+			if (ids[root[p]] == 0) ids[root[p]] = ++ncluster;
+			clusterID[i] = ids[root[p]];
+		}
+		flag[i] = core[p] ? 1 : 2;
+	}
+}
+
+template <typename T>
+void FlatKDtree<T>::recycle(vector<vector<long int>> &state)
+{
+	state.clear();
+	state.reserve(npoints);
+	for (long int i=0; i<npoints; i++)
+	{
+		vector<long int> stat(3);
+		stat[0] = i;
+		stat[1] = clusterID[i];
+		stat[2] = flag[i];
+		state.push_back(stat);
+	}
+}
+
 template class KDnode<long int>;
 template class KDtree<long int>;
+template class FlatKDtree<long int>;
 
 template class KDnode<double>;
 template class KDtree<double>;
+template class FlatKDtree<double>;
@@ -0,0 +1,36 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 22:15:37
+ * @modify date 2026-10-19 22:15:37
+ * @desc [description]
+ */
+
+#include "partitioner.h"
+
+using namespace XLIBS;
+
+ChannelPartitioner::ChannelPartitioner(int n, int a, int b)
+{
+	nsubband = n;
+	align = std::max(1, a);
+	nblock = std::max(1, b);
+}
+
+void ChannelPartitioner::prepare(int nchans)
+{
+	starts.clear();
+	if (nchans <= 0) return;
+
+	int nblocks = (nchans + align - 1) / align;
+	int nsub = nsubband > 0 ? nsubband : (nblocks + nblock - 1) / nblock;
+	nsub = std::max(1, std::min(nsub, nblocks));
+
+	/* the same number of aligned blocks per sub-band within one, the last one ends at nchans */
+	starts.push_back(0);
+	for (int k=1; k<nsub; k++)
+	{
+		starts.push_back((long int)k * nblocks / nsub * align);
+	}
+	starts.push_back(nchans);
+}
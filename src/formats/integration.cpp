@@ -452,6 +452,7 @@ void Integration::load_data(void *dat, int np, int nc, int nb)
 					min_value = pro[i]<min_value ? pro[i]:min_value;
 				}
 				scales[m] = (max_value-min_value)/(TYPE_MAX-TYPE_MIN);
+				if (scales[m] == 0.) scales[m] = 1.;
 				if (dtype == SHORT)
 					offsets[m] = (max_value+min_value)*0.5;
 				else if (dtype == USHORT)
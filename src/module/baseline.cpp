@@ -6,9 +6,7 @@
  * @desc [description]
  */
 
-#ifdef __AVX2__
-#include "avx2.h"
-#endif
+#include "simd.h"
 
 #include "baseline.h"
 #include "dedisperse.h"
@@ -67,78 +65,14 @@ DataBuffer<float> * BaseLine::filter(DataBuffer<float> &databuffer)
 
 	BOOST_LOG_TRIVIAL(debug)<<"perform baseline removal with time scale="<<width;
 
-#ifndef __AVX2__
-	vector<double> xe(nchans, 0.);
-	vector<double> xs(nchans, 0.);
-	vector<double> alpha(nchans, 0.);
-	vector<double> beta(nchans, 0.);
-	vector<double> szero(nsamples, 0.);
-	vector<double> s(nsamples, 0.);
-	double se = 0.;
-	double ss = 0.;
-
-	if (outref.empty())
-	{
-		for (long int i=0; i<nsamples; i++)
-		{
-			double temp = 0.;
-			for (long int j=0; j<nchans; j++)
-			{
-				temp += databuffer.buffer[i*nchans+j];
-			}
-			szero[i] = temp/nchans;
-		}
-
-		runMedian2(szero.data(), s.data(), nsamples, width/tsamp);
-	}
-	else
-	{
-		std::copy(outref.begin()+counter, outref.begin()+counter+nsamples, s.begin());
-	}
-
-	for (long int i=0; i<nsamples; i++)
-	{
-		for (long int j=0; j<nchans; j++)
-		{
-			xe[j] += databuffer.buffer[i*nchans+j];
-		}
-
-		se += s[i];
-		ss += s[i]*s[i];
-		
-		for (long int j=0; j<nchans; j++)
-		{
-			xs[j] += databuffer.buffer[i*nchans+j]*s[i];
-		}
-	}
-
-	double tmp = se*se-ss*nsamples;
-	if (tmp != 0)
+	if (PulsarX::simd_enabled())
 	{
-		for (long int j=0; j<nchans; j++)
-		{
-			alpha[j] = (xe[j]*se-xs[j]*nsamples)/tmp;
-			beta[j] = (xs[j]*se-xe[j]*ss)/tmp;
-		}
-	}
-
-	for (long int i=0; i<nsamples; i++)
-	{
-		for (long int j=0; j<nchans; j++)
-		{
-			databuffer.buffer[i*nchans+j] = databuffer.buffer[i*nchans+j]-alpha[j]*s[i]-beta[j];
-		}
-	}
-
-#else
-	if (nchans % 8 == 0)
-	{
-		vector<double, boost::alignment::aligned_allocator<double, 32>> xe(nchans, 0.);
-		vector<double, boost::alignment::aligned_allocator<double, 32>> xs(nchans, 0.);
-		vector<float, boost::alignment::aligned_allocator<float, 32>> alpha(nchans, 0.);
-		vector<float, boost::alignment::aligned_allocator<float, 32>> beta(nchans, 0.);
-		vector<float, boost::alignment::aligned_allocator<float, 32>> szero(nsamples, 0.);
-		vector<float, boost::alignment::aligned_allocator<float, 32>> s(nsamples, 0.);
+		aligned_vector<double> xe(nchans, 0.);
+		aligned_vector<double> xs(nchans, 0.);
+		aligned_vector<float> alpha(nchans, 0.);
+		aligned_vector<float> beta(nchans, 0.);
+		aligned_vector<float> szero(nsamples, 0.);
+		aligned_vector<float> s(nsamples, 0.);
 		double se = 0.;
 		double ss = 0.;
 
@@ -146,7 +80,7 @@ DataBuffer<float> * BaseLine::filter(DataBuffer<float> &databuffer)
 		{
 			for (long int i=0; i<nsamples; i++)
 			{
-				double temp = PulsarX::reduce(databuffer.buffer.data()+i*nchans, nchans);
+				double temp = PulsarX::simd_kernels().reduce(databuffer.buffer.data()+i*nchans, nchans);
 				szero[i] = temp/nchans;
 			}
 
@@ -159,7 +93,7 @@ DataBuffer<float> * BaseLine::filter(DataBuffer<float> &databuffer)
 
 		for (long int i=0; i<nsamples; i++)
 		{
-			PulsarX::accumulate_mean(xe.data(), xs.data(), s[i], databuffer.buffer.data()+i*nchans, nchans);
+			PulsarX::simd_kernels().accumulate_mean(xe.data(), xs.data(), s[i], databuffer.buffer.data()+i*nchans, nchans);
 
 			se += s[i];
 			ss += s[i]*s[i];
@@ -177,7 +111,7 @@ DataBuffer<float> * BaseLine::filter(DataBuffer<float> &databuffer)
 
 		for (long int i=0; i<nsamples; i++)
 		{
-			PulsarX::remove_baseline(databuffer.buffer.data()+i*nchans, databuffer.buffer.data()+i*nchans, alpha.data(), beta.data(), s[i], nchans);
+			PulsarX::simd_kernels().remove_baseline(databuffer.buffer.data()+i*nchans, databuffer.buffer.data()+i*nchans, alpha.data(), beta.data(), s[i], nchans);
 		}
 
 	}
@@ -245,7 +179,6 @@ DataBuffer<float> * BaseLine::filter(DataBuffer<float> &databuffer)
 			}
 		}
 	}
-#endif
 
 	std::fill(databuffer.means.begin(), databuffer.means.end(), 0.);
 
@@ -336,6 +269,7 @@ DataBuffer<float> * BaseLine::run(DataBuffer<float> &databuffer)
 	vars = databuffer.vars;
 	mean_var_ready = databuffer.mean_var_ready;
 	weights = databuffer.weights;
+	chmask = databuffer.chmask;
 
 	counter += nsamples;
 
@@ -358,94 +292,22 @@ DataBuffer<float> * BaseLine::filter2(DataBuffer<float> &databuffer)
 
 	BOOST_LOG_TRIVIAL(debug)<<"perform baseline removal with time scale="<<width;
 
-#ifndef __AVX2__
-	vector<double> xe(nchans, 0.);
-	vector<double> xs(nchans, 0.);
-	vector<double> alpha(nchans, 0.);
-	vector<double> beta(nchans, 0.);
-	vector<double> szero(nsamples, 0.);
-	vector<double> sstdzero(nsamples, 0.);
-	vector<double> s(nsamples, 0.);
-	vector<double> sstd(nsamples, 0.);
-	double se = 0.;
-	double ss = 0.;
-
-	for (long int i=0; i<nsamples; i++)
-	{
-		double temp = 0.;
-		for (long int j=0; j<nchans; j++)
-		{
-			temp += databuffer.buffer[i*nchans+j];
-		}
-		szero[i] = temp/nchans;
-	}
-
-	runMedian2(szero.data(), s.data(), nsamples, width/tsamp);
-
-	for (long int i=0; i<nsamples; i++)
-	{
-		for (long int j=0; j<nchans; j++)
-		{
-			xe[j] += databuffer.buffer[i*nchans+j];
-		}
-
-		se += s[i];
-		ss += s[i]*s[i];
-		
-		for (long int j=0; j<nchans; j++)
-		{
-			xs[j] += databuffer.buffer[i*nchans+j]*s[i];
-		}
-	}
-
-	double tmp = se*se-ss*nsamples;
-	if (tmp != 0)
-	{
-		for (long int j=0; j<nchans; j++)
-		{
-			alpha[j] = (xe[j]*se-xs[j]*nsamples)/tmp;
-			beta[j] = (xs[j]*se-xe[j]*ss)/tmp;
-		}
-	}
-
-	for (long int i=0; i<nsamples; i++)
-	{
-		for (long int j=0; j<nchans; j++)
-		{
-			databuffer.buffer[i*nchans+j] = (databuffer.buffer[i*nchans+j]-alpha[j]*s[i]-beta[j]);
-			sstdzero[i] +=  databuffer.buffer[i*nchans+j] * databuffer.buffer[i*nchans+j];
-		}
-		sstdzero[i] /= nchans;
-	}
-
-	runMedian2(sstdzero.data(), sstd.data(), nsamples, width/tsamp);
-
-	for (long int i=0; i<nsamples; i++)
-	{
-		double norm = sstd[i] == 0. ? 0. : 1./sstd[i];
-		for (long int j=0; j<nchans; j++)
-		{
-			databuffer.buffer[i*nchans+j] *= norm;
-		}
-	}
-
-#else
-	if (nchans % 8 == 0)
+	if (PulsarX::simd_enabled())
 	{
-		vector<double, boost::alignment::aligned_allocator<double, 32>> xe(nchans, 0.);
-		vector<double, boost::alignment::aligned_allocator<double, 32>> xs(nchans, 0.);
-		vector<float, boost::alignment::aligned_allocator<float, 32>> alpha(nchans, 0.);
-		vector<float, boost::alignment::aligned_allocator<float, 32>> beta(nchans, 0.);
-		vector<float, boost::alignment::aligned_allocator<float, 32>> szero(nsamples, 0.);
-		vector<float, boost::alignment::aligned_allocator<float, 32>> sstdzero(nsamples, 0.);
-		vector<float, boost::alignment::aligned_allocator<float, 32>> s(nsamples, 0.);
-		vector<float, boost::alignment::aligned_allocator<float, 32>> sstd(nsamples, 0.);
+		aligned_vector<double> xe(nchans, 0.);
+		aligned_vector<double> xs(nchans, 0.);
+		aligned_vector<float> alpha(nchans, 0.);
+		aligned_vector<float> beta(nchans, 0.);
+		aligned_vector<float> szero(nsamples, 0.);
+		aligned_vector<float> sstdzero(nsamples, 0.);
+		aligned_vector<float> s(nsamples, 0.);
+		aligned_vector<float> sstd(nsamples, 0.);
 		double se = 0.;
 		double ss = 0.;
 
 		for (long int i=0; i<nsamples; i++)
 		{
-			double temp = PulsarX::reduce(databuffer.buffer.data()+i*nchans, nchans);
+			double temp = PulsarX::simd_kernels().reduce(databuffer.buffer.data()+i*nchans, nchans);
 			szero[i] = temp/nchans;
 		}
 
@@ -453,7 +315,7 @@ DataBuffer<float> * BaseLine::filter2(DataBuffer<float> &databuffer)
 
 		for (long int i=0; i<nsamples; i++)
 		{
-			PulsarX::accumulate_mean(xe.data(), xs.data(), s[i], databuffer.buffer.data()+i*nchans, nchans);
+			PulsarX::simd_kernels().accumulate_mean(xe.data(), xs.data(), s[i], databuffer.buffer.data()+i*nchans, nchans);
 
 			se += s[i];
 			ss += s[i]*s[i];
@@ -471,7 +333,7 @@ DataBuffer<float> * BaseLine::filter2(DataBuffer<float> &databuffer)
 
 		for (long int i=0; i<nsamples; i++)
 		{
-			sstdzero[i] = PulsarX::remove_baseline_reduce(databuffer.buffer.data()+i*nchans, databuffer.buffer.data()+i*nchans, alpha.data(), beta.data(), s[i], nchans);
+			sstdzero[i] = PulsarX::simd_kernels().remove_baseline_reduce(databuffer.buffer.data()+i*nchans, databuffer.buffer.data()+i*nchans, alpha.data(), beta.data(), s[i], nchans);
 			sstdzero[i] /= nchans;
 		}
 
@@ -559,7 +421,6 @@ DataBuffer<float> * BaseLine::filter2(DataBuffer<float> &databuffer)
 		}
 	}
 
-#endif
 
 	std::fill(databuffer.means.begin(), databuffer.means.end(), 0.);
 	std::fill(databuffer.vars.begin(), databuffer.vars.end(), 1.);
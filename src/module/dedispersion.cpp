@@ -10,7 +10,9 @@
 #include "logging.h"
 #include "dedisperse.h"
 #include "utils.h"
+#include "simd.h"
 #include <algorithm>
+#include <limits>
 
 Dedispersion::Dedispersion()
 {
@@ -59,6 +61,9 @@ void Dedispersion::prepare(DataBuffer<float> &databuffer)
 	}
 
 	offset = buf_size - nsamples;
+
+	ndead.resize(nchans, std::numeric_limits<int>::max());
+	dead.resize(nchans, true);
 }
 
 DataBuffer<float> * Dedispersion::run(DataBuffer<float> &databuffer)
@@ -67,14 +72,19 @@ DataBuffer<float> * Dedispersion::run(DataBuffer<float> &databuffer)
 
 	int nspace = buf_size - nsamples;
 
+	update_dead_channels(ndead, dead, databuffer.chmask, nchans, buf_size / nsamples);
+
 	for (long int i=0; i<nsamples; i++)
 	{
 		for (long int j=0; j<nchans; j++)
 		{
-			buf[(i+nspace)*nchans+j] = databuffer.buffer[i*nchans+j];
+			buf[(i+nspace)*nchans+j] = (databuffer.chmask.empty() or !databuffer.chmask[j]) ? databuffer.buffer[i*nchans+j] : 0.;
 		}
 	}
 
+	weights = databuffer.weights;
+	chmask = databuffer.chmask;
+
 	BOOST_LOG_TRIVIAL(debug)<<"perform dedispersion";
 
 	databuffer.isbusy = false;
@@ -87,13 +97,16 @@ DataBuffer<float> * Dedispersion::run(DataBuffer<float> &databuffer)
 			for (long int j=0; j<nchans/16; j++)
 			{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 				for (long int n=0; n<16; n++)
 				{
 					for (long int m=0; m<16; m++)
 					{
-						buffer[(i * 16 + n) * nchans + (j * 16 + m)] = buf[(i * 16 + n + delayn[j * 16 + m]) * nchans + (j * 16 + m)];
+						if (dead[j * 16 + m])
+							buffer[(i * 16 + n) * nchans + (j * 16 + m)] = 0.;
+						else
+							buffer[(i * 16 + n) * nchans + (j * 16 + m)] = buf[(i * 16 + n + delayn[j * 16 + m]) * nchans + (j * 16 + m)];
 					}
 				}
 			}
@@ -105,7 +118,7 @@ DataBuffer<float> * Dedispersion::run(DataBuffer<float> &databuffer)
 		{
 			for (long int j=0; j<nchans; j++)
 			{
-				buffer[i * nchans + j] = buf[(i + delayn[j]) * nchans + j];
+				buffer[i * nchans + j] = dead[j] ? 0. : buf[(i + delayn[j]) * nchans + j];
 			}
 		}
 	}
@@ -123,4 +136,189 @@ DataBuffer<float> * Dedispersion::run(DataBuffer<float> &databuffer)
 	BOOST_LOG_TRIVIAL(debug)<<"finished";
 
 	return this;
-}
\ No newline at end of file
+}
+/* =======================================================================================================================================*/
+
+XLIBS_TARGET_CLONES static void accumulate(float *out, const float *in, size_t n)
+{
+	for (size_t i=0; i<n; i++)
+	{
+		out[i] += in[i];
+	}
+}
+
+BatchDedispersion::BatchDedispersion()
+{
+	nsubband = 0;
+	tile_ndm = 8;
+	tile_nsamples = 1024;
+	tile_nchans = 32;
+
+	counter = 0;
+	offset = 0;
+
+	nsamples = 0;
+	nchans = 0;
+	tsamp = 0.;
+	buf_size = 0;
+}
+
+BatchDedispersion::~BatchDedispersion()
+{
+}
+
+void BatchDedispersion::prepare(DataBuffer<float> &databuffer)
+{
+	nsamples = databuffer.nsamples;
+	nchans = databuffer.nchans;
+	tsamp = databuffer.tsamp;
+
+	if (nsubband == 0 || nsubband > nchans) nsubband = nchans;
+
+	if (vdm.empty())
+	{
+		BOOST_LOG_TRIVIAL(error)<<"dm list is empty";
+		exit(-1);
+	}
+
+	double fmax = *std::max_element(databuffer.frequencies.begin(), databuffer.frequencies.end());
+	double fmin = *std::min_element(databuffer.frequencies.begin(), databuffer.frequencies.end());
+	double maxdm = *std::max_element(vdm.begin(), vdm.end());
+
+	int maxdelayn = std::ceil(Dedispersion::dmdelay(maxdm, fmax, fmin) / tsamp);
+	maxdelayn = (int) std::ceil(maxdelayn * 1. / nsamples) * nsamples;
+
+	buf_size = nsamples + maxdelayn;
+	buf.resize(nsamples * nchans, 0.);
+	blockT.resize(nchans * nsamples, 0.);
+	bufT.resize(nchans * buf_size, 0.);
+
+	size_t ndm = vdm.size();
+	dedata.resize(ndm * nsubband * nsamples, 0.);
+
+	delayn.resize(ndm * nchans, 0);
+	for (size_t k=0; k<ndm; k++)
+	{
+		for (size_t j=0; j<nchans; j++)
+		{
+			delayn[k * nchans + j] = std::round(Dedispersion::dmdelay(vdm[k], fmax, databuffer.frequencies[j]) / tsamp);
+		}
+	}
+
+	submap.resize(nchans, 0);
+	frequencies_sub.resize(nsubband, 0.);
+	std::vector<int> cnt(nsubband, 0);
+	for (size_t j=0; j<nchans; j++)
+	{
+		submap[j] = j * nsubband / nchans;
+		frequencies_sub[submap[j]] += databuffer.frequencies[j];
+		cnt[submap[j]]++;
+	}
+	for (size_t s=0; s<nsubband; s++)
+	{
+		frequencies_sub[s] /= cnt[s];
+	}
+
+	offset = buf_size - nsamples;
+
+	ndead.resize(nchans, std::numeric_limits<int>::max());
+	dead.resize(nchans, true);
+}
+
+void BatchDedispersion::run(DataBuffer<float> &databuffer)
+{
+	size_t nspace = buf_size - nsamples;
+
+	update_dead_channels(ndead, dead, databuffer.chmask, nchans, buf_size / nsamples);
+
+	for (size_t i=0; i<nsamples; i++)
+	{
+		for (size_t j=0; j<nchans; j++)
+		{
+			buf[i * nchans + j] = (databuffer.chmask.empty() or !databuffer.chmask[j]) ? databuffer.buffer[i * nchans + j] : 0.;
+		}
+	}
+
+	BOOST_LOG_TRIVIAL(debug)<<"perform batch dedispersion of "<<vdm.size()<<" dms";
+
+	databuffer.isbusy = false;
+	if (databuffer.closable) databuffer.close();
+
+	/* only the new block is transposed, the history of each channel moves to the front */
+	transpose_pad<float>(blockT.data(), buf.data(), nsamples, nchans);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+	for (size_t j=0; j<nchans; j++)
+	{
+		float *row = bufT.data() + j * buf_size;
+		std::copy(row + nsamples, row + buf_size, row);
+		std::copy(blockT.data() + j * nsamples, blockT.data() + (j + 1) * nsamples, row + nspace);
+	}
+
+	std::fill(dedata.begin(), dedata.end(), 0.);
+
+	size_t ndm = vdm.size();
+	size_t ntile_dm = (ndm + tile_ndm - 1) / tile_ndm;
+	size_t ntile_t = (nsamples + tile_nsamples - 1) / tile_nsamples;
+
+	/* the tiles write to disjoint outputs */
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+	for (size_t itile=0; itile<ntile_dm*ntile_t; itile++)
+	{
+		size_t idm0 = (itile / ntile_t) * tile_ndm;
+		size_t idm1 = std::min(idm0 + tile_ndm, ndm);
+		size_t i0 = (itile % ntile_t) * tile_nsamples;
+		size_t i1 = std::min(i0 + tile_nsamples, nsamples);
+
+		for (size_t j0=0; j0<nchans; j0+=tile_nchans)
+		{
+			size_t j1 = std::min(j0 + tile_nchans, nchans);
+			for (size_t k=idm0; k<idm1; k++)
+			{
+				for (size_t j=j0; j<j1; j++)
+				{
+					if (dead[j]) continue;
+
+					const float *in = bufT.data() + j * buf_size + delayn[k * nchans + j];
+					float *out = dedata.data() + (k * nsubband + submap[j]) * nsamples;
+					accumulate(out + i0, in + i0, i1 - i0);
+				}
+			}
+		}
+	}
+
+	counter += nsamples;
+
+	BOOST_LOG_TRIVIAL(debug)<<"finished";
+}
+
+void BatchDedispersion::get_subdata(size_t idm, DataBuffer<float> &subdata)
+{
+	subdata.resize(nsamples, nsubband);
+	subdata.tsamp = tsamp;
+	subdata.frequencies = frequencies_sub;
+	subdata.means.resize(nsubband, 0.);
+	subdata.vars.resize(nsubband, 0.);
+
+	/* a subband is flagged if all its channels are dead */
+	subdata.chmask.resize(nsubband, 1);
+	std::fill(subdata.chmask.begin(), subdata.chmask.end(), 1);
+	for (size_t j=0; j<nchans; j++)
+	{
+		if (!dead[j]) subdata.chmask[submap[j]] = 0;
+	}
+
+	for (size_t i=0; i<nsamples; i++)
+	{
+		for (size_t s=0; s<nsubband; s++)
+		{
+			subdata.buffer[i * nsubband + s] = dedata[(idm * nsubband + s) * nsamples + i];
+		}
+	}
+
+	subdata.counter += nsamples;
+}
@@ -8,6 +8,7 @@
 
 #include "dedispersionX.h"
 #include "utils.h"
+#include <limits>
 
 #ifdef _OPENMP
 	#include <omp.h>
@@ -15,6 +16,15 @@
 
 using namespace Pulsar;
 
+/* out = a + b, out may alias a */
+XLIBS_TARGET_CLONES static void add_rows(float *out, const float *a, const float *b, size_t n)
+{
+	for (size_t i=0; i<n; i++)
+	{
+		out[i] = a[i] + b[i];
+	}
+}
+
 TreeDedispersion::TreeDedispersion()
 {
 	nsubband = 0;
@@ -75,6 +85,15 @@ void TreeDedispersion::close()
 	hit.clear();
 	hit.shrink_to_fit();
 
+	ndead.clear();
+	ndead.shrink_to_fit();
+
+	dead.clear();
+	dead.shrink_to_fit();
+
+	alive.clear();
+	alive.shrink_to_fit();
+
 	cache0.clear();
 	cache0.shrink_to_fit();
 
@@ -136,6 +155,10 @@ void TreeDedispersion::prepare(DataBuffer<float> &databuffer)
 
 	offset = nsamples-ndump;
 
+	ndead.resize(nchans, std::numeric_limits<int>::max());
+	dead.resize(nchans, true);
+	alive.resize((maxdepth + 1) * nchans, true);
+
 	ready = true;
 
 	std::vector<std::pair<std::string, std::string>> meta = {
@@ -255,27 +278,53 @@ void TreeDedispersion::update_map()
 	}
 }
 
+void TreeDedispersion::update_chmask(const std::vector<unsigned char> &chmask)
+{
+	update_dead_channels(ndead, dead, chmask, nchans_orig, (nsamples + ndump - 1) / ndump);
+
+	for (size_t j=0; j<nchans; j++)
+	{
+		alive[maxdepth * nchans + j] = !dead[j];
+	}
+
+	for (size_t k=maxdepth; k>0; k--)
+	{
+		for (size_t j=0; j<(nchans>>(maxdepth-k+1)); j++)
+		{
+			alive[(k - 1) * nchans + j] = alive[k * nchans + 2 * j] || alive[k * nchans + 2 * j + 1];
+		}
+	}
+}
+
 void TreeDedispersion::transform(size_t depth, size_t ichan)
 {
-#ifndef __AVX2__
-	std::vector<float> *temp = bufferT.empty() ? ptr_bufferT : &bufferT;
-#else
-	std::vector<float, boost::alignment::aligned_allocator<float, 32>> *temp = bufferT.empty() ? ptr_bufferT : &bufferT;
-#endif
+	aligned_vector<float> *temp = bufferT.empty() ? ptr_bufferT : &bufferT;
 
 	if (depth == maxdepth)
 	{
 		return;
 	}
 
+	/* all channels of the subtree are dead, the rows stay zero */
+	if (!alive[depth * nchans + ichan])
+	{
+		return;
+	}
+
 	transform(depth + 1, 2 * ichan);
 	transform(depth + 1, 2 * ichan + 1);
 
+	if (!alive[(depth + 1) * nchans + 2 * ichan] || !alive[(depth + 1) * nchans + 2 * ichan + 1])
+	{
+		transform_ragged(depth, ichan, alive[(depth + 1) * nchans + 2 * ichan]);
+		return;
+	}
+
 	size_t ndm = (nchans >> (depth + 1));
 	if (frequencies.front() > frequencies.back())
 	{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (size_t idm=0; idm<ndm; idm++)
 		{
@@ -295,25 +344,19 @@ void TreeDedispersion::transform(size_t depth, size_t ichan)
 
 			if (hit[depth * nchans + ichan * (ndm * 2) + ndm + idm])
 			{
-				for (size_t i=0; i<nsamples; i++)
-				{
-					(*temp)[(2 * ichan + 1) * ndm * nsamples + idm * nsamples + i] = (*temp)[(2 * ichan + 0) * ndm * nsamples + idm * nsamples + i] + cache1[i + thread_id * nsamples];
-				}
+				add_rows(temp->data() + (2 * ichan + 1) * ndm * nsamples + idm * nsamples, temp->data() + (2 * ichan + 0) * ndm * nsamples + idm * nsamples, cache1.data() + thread_id * nsamples, nsamples);
 			}
 
 			if (hit[depth * nchans + ichan * (ndm * 2) + idm])
 			{
-				for (size_t i=0; i<nsamples; i++)
-				{
-					(*temp)[(2 * ichan + 0) * ndm * nsamples + idm * nsamples + i] = (*temp)[(2 * ichan + 0) * ndm * nsamples + idm * nsamples + i] + cache0[i + thread_id * nsamples];
-				}
+				add_rows(temp->data() + (2 * ichan + 0) * ndm * nsamples + idm * nsamples, temp->data() + (2 * ichan + 0) * ndm * nsamples + idm * nsamples, cache0.data() + thread_id * nsamples, nsamples);
 			}
 		}
 	}
 	else
 	{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (size_t idm=0; idm<ndm; idm++)
 		{
@@ -333,18 +376,68 @@ void TreeDedispersion::transform(size_t depth, size_t ichan)
 
 			if (hit[depth * nchans + ichan * (ndm * 2) + idm])
 			{
-				for (size_t i=0; i<nsamples; i++)
-				{
-					(*temp)[(2 * ichan + 0) * ndm * nsamples + idm * nsamples + i] = (*temp)[(2 * ichan + 1) * ndm * nsamples + idm * nsamples + i] + cache0[i + thread_id * nsamples];
-				}
+				add_rows(temp->data() + (2 * ichan + 0) * ndm * nsamples + idm * nsamples, temp->data() + (2 * ichan + 1) * ndm * nsamples + idm * nsamples, cache0.data() + thread_id * nsamples, nsamples);
 			}
 
 			if (hit[depth * nchans + ichan * (ndm * 2) + ndm + idm])
 			{
-				for (size_t i=0; i<nsamples; i++)
-				{
-					(*temp)[(2 * ichan + 1) * ndm * nsamples + idm * nsamples + i] = (*temp)[(2 * ichan + 1) * ndm * nsamples + idm * nsamples + i] + cache1[i + thread_id * nsamples];
-				}
+				add_rows(temp->data() + (2 * ichan + 1) * ndm * nsamples + idm * nsamples, temp->data() + (2 * ichan + 1) * ndm * nsamples + idm * nsamples, cache1.data() + thread_id * nsamples, nsamples);
+			}
+		}
+	}
+}
+
+/**
+ * @brief merge a live subtree with a dead (all zero) one, e.g. at the edge of the padded channels,
+ * the sum reduces to a copy or a shift of the live rows
+ */
+void TreeDedispersion::transform_ragged(size_t depth, size_t ichan, bool alive0)
+{
+	aligned_vector<float> *temp = bufferT.empty() ? ptr_bufferT : &bufferT;
+
+	size_t ndm = (nchans >> (depth + 1));
+
+	/* the subtree shifted by the delay */
+	size_t ishift = frequencies.front() > frequencies.back() ? 2 * ichan + 1 : 2 * ichan + 0;
+	bool alive_shift = (ishift == 2 * ichan) ? alive0 : !alive0;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+	for (size_t idm=0; idm<ndm; idm++)
+	{
+		bool hit0 = hit[depth * nchans + ichan * (ndm * 2) + idm];
+		bool hit1 = hit[depth * nchans + ichan * (ndm * 2) + ndm + idm];
+
+		auto row0 = temp->begin() + (2 * ichan + 0) * ndm * nsamples + idm * nsamples;
+		auto row1 = temp->begin() + (2 * ichan + 1) * ndm * nsamples + idm * nsamples;
+
+		if (!alive_shift)
+		{
+			/* out = unshifted rows */
+			if (ishift == 2 * ichan + 1)
+			{
+				if (hit1) std::copy(row0, row0 + nsamples, row1);
+			}
+			else
+			{
+				if (hit0) std::copy(row1, row1 + nsamples, row0);
+			}
+		}
+		else
+		{
+			/* out = shifted rows, the row of the shifted subtree is rotated in place last */
+			size_t delayn0 = delayn[depth * nchans + ichan * (ndm * 2) + idm];
+			size_t delayn1 = delayn[depth * nchans + ichan * (ndm * 2) + ndm + idm];
+			if (ishift == 2 * ichan + 1)
+			{
+				if (hit0) std::rotate_copy(row1, row1 + delayn0, row1 + nsamples, row0);
+				if (hit1) std::rotate(row1, row1 + delayn1, row1 + nsamples);
+			}
+			else
+			{
+				if (hit1) std::rotate_copy(row0, row0 + delayn1, row0 + nsamples, row1);
+				if (hit0) std::rotate(row0, row0 + delayn0, row0 + nsamples);
 			}
 		}
 	}
@@ -354,11 +447,13 @@ void TreeDedispersion::run(DataBuffer<float> &databuffer)
 {
 	size_t nspace = nsamples - ndump;
 
+	update_chmask(databuffer.chmask);
+
 	for (size_t i=0; i<ndump; i++)
 	{
 		for (size_t j=0; j<nchans_orig; j++)
 		{
-			buffer[(i + nspace) * nchans + j] = databuffer.buffer[i * nchans_orig + j];
+			buffer[(i + nspace) * nchans + j] = (databuffer.chmask.empty() or !databuffer.chmask[j]) ? databuffer.buffer[i * nchans_orig + j] : 0.;
 		}
 	}
 
@@ -396,9 +491,55 @@ void TreeDedispersion::run()
 	counter += ndump;
 }
 
+void TreeDedispersion::save_state(Checkpoint &checkpoint, const std::string &prefix) const
+{
+	checkpoint.put(prefix + ".counter", counter);
+	checkpoint.put(prefix + ".means", means);
+	checkpoint.put(prefix + ".vars", vars);
+	checkpoint.put(prefix + ".mean_var_ready", mean_var_ready);
+	checkpoint.put(prefix + ".ndead", ndead);
+	checkpoint.put(prefix + ".dead", dead);
+
+	/* the first nsamples-ndump rows are kept for the next block */
+	if (!buffer.empty())
+		checkpoint.put(prefix + ".overlap", buffer.data(), (nsamples - ndump) * nchans);
+}
+
+bool TreeDedispersion::load_state(const Checkpoint &checkpoint, const std::string &prefix)
+{
+	size_t counter_chk = 0;
+	bool mean_var_ready_chk = false;
+	std::vector<double> means_chk, vars_chk;
+	std::vector<int> ndead_chk;
+	std::vector<bool> dead_chk;
+
+	if (!checkpoint.get(prefix + ".counter", counter_chk) or
+		!checkpoint.get(prefix + ".means", means_chk) or
+		!checkpoint.get(prefix + ".vars", vars_chk) or
+		!checkpoint.get(prefix + ".mean_var_ready", mean_var_ready_chk) or
+		!checkpoint.get(prefix + ".ndead", ndead_chk) or
+		!checkpoint.get(prefix + ".dead", dead_chk))
+		return false;
+
+	if (means_chk.size() != means.size() or vars_chk.size() != vars.size() or ndead_chk.size() != ndead.size())
+		return false;
+
+	if (!buffer.empty() and !checkpoint.get(prefix + ".overlap", buffer.data(), (nsamples - ndump) * nchans))
+		return false;
+
+	counter = counter_chk;
+	mean_var_ready = mean_var_ready_chk;
+	means.swap(means_chk);
+	vars.swap(vars_chk);
+	ndead.swap(ndead_chk);
+	dead.swap(dead_chk);
+
+	return true;
+}
+
 void TreeDedispersion::get_subdata(double dm, DataBuffer<float> &subdata, bool dedisperse)
 {
-	std::vector<float> *temp = dedata.empty() ? ptr_dedata : &dedata;
+	aligned_vector<float> *temp = dedata.empty() ? ptr_dedata : &dedata;
 
 	get_subdata_tem(dm, subdata);
 
@@ -613,7 +754,7 @@ void DedispersionX::prerun(DataBuffer<float> &databuffer)
 			{
 				if (enable)
 				{
-					std::vector<float> &buffer = buffers[0];
+					aligned_vector<float> &buffer = buffers[0];
 					size_t nsamples = buffer.size() / nchans;
 					size_t ndump = treededispersions[k].get_ndump();
 					size_t nspace = nsamples - ndump;
@@ -622,13 +763,15 @@ void DedispersionX::prerun(DataBuffer<float> &databuffer)
 					{
 						for (size_t j=0; j<nchans_orig; j++)
 						{
-							buffer[(i + nspace) * nchans + j] = databuffer.buffer[i * nchans_orig + j];
+							buffer[(i + nspace) * nchans + j] = (databuffer.chmask.empty() or !databuffer.chmask[j]) ? databuffer.buffer[i * nchans_orig + j] : 0.;
 						}
 					}
 
 					enable = false;
 				}
 
+				treededispersions[k].update_chmask(databuffer.chmask);
+
 				if (databuffer.mean_var_ready)
 				{
 					int nch = ceil(nchans*1./nsubband);
@@ -645,7 +788,7 @@ void DedispersionX::prerun(DataBuffer<float> &databuffer)
 			}
 			else
 			{
-				std::vector<float> &buffer = buffers[k];
+				aligned_vector<float> &buffer = buffers[k];
 				size_t nsamples = buffer.size() / nchans;
 				size_t ndump = treededispersions[k].get_ndump();
 				size_t nspace = nsamples - ndump;
@@ -654,10 +797,12 @@ void DedispersionX::prerun(DataBuffer<float> &databuffer)
 				{
 					for (size_t j=0; j<nchans_orig; j++)
 					{
-						buffer[(i + nspace) * nchans + j] = downsamples[k].buffer[i * nchans_orig + j];
+						buffer[(i + nspace) * nchans + j] = (downsamples[k].chmask.empty() or !downsamples[k].chmask[j]) ? downsamples[k].buffer[i * nchans_orig + j] : 0.;
 					}
 				}
 
+				treededispersions[k].update_chmask(downsamples[k].chmask);
+
 				if (downsamples[k].mean_var_ready)
 				{
 					int nch = ceil(nchans*1./nsubband);
@@ -691,7 +836,7 @@ void DedispersionX::postrun(DataBuffer<float> &databuffer)
 			{
 				if (enable)
 				{
-					std::vector<float> &buffer = buffers[0];
+					aligned_vector<float> &buffer = buffers[0];
 					size_t nsamples = buffer.size() / nchans;
 					size_t ndump = treededispersions[k].get_ndump();
 					size_t nspace = nsamples - ndump;
@@ -708,7 +853,7 @@ void DedispersionX::postrun(DataBuffer<float> &databuffer)
 			}
 			else
 			{
-				std::vector<float> &buffer = buffers[k];
+				aligned_vector<float> &buffer = buffers[k];
 				size_t nsamples = buffer.size() / nchans;
 				size_t ndump = treededispersions[k].get_ndump();
 				size_t nspace = nsamples - ndump;
@@ -741,7 +886,7 @@ void DedispersionX::run(DataBuffer<float> &databuffer)
 	}
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (size_t k=0; k<downsamples.size(); k++)
 	{
@@ -775,4 +920,36 @@ void DedispersionX::run(size_t k)
 	}
 
 	BOOST_LOG_TRIVIAL(debug)<<"finished";
+}
+
+void DedispersionX::save_state(Checkpoint &checkpoint, const std::string &prefix) const
+{
+	for (size_t k=0; k<treededispersions.size(); k++)
+	{
+		std::string prefix_k = prefix + ".segment" + std::to_string(k);
+
+		downsamples[k].save_state(checkpoint, prefix_k + ".downsample");
+		treededispersions[k].save_state(checkpoint, prefix_k + ".tree");
+
+		/* the first nsamples-ndump rows are kept for the next block */
+		if (!buffers[k].empty())
+			checkpoint.put(prefix_k + ".overlap", buffers[k].data(), buffers[k].size() - treededispersions[k].get_ndump() * nchans);
+	}
+}
+
+bool DedispersionX::load_state(const Checkpoint &checkpoint, const std::string &prefix)
+{
+	for (size_t k=0; k<treededispersions.size(); k++)
+	{
+		std::string prefix_k = prefix + ".segment" + std::to_string(k);
+
+		if (!downsamples[k].load_state(checkpoint, prefix_k + ".downsample") or
+			!treededispersions[k].load_state(checkpoint, prefix_k + ".tree"))
+			return false;
+
+		if (!buffers[k].empty() and !checkpoint.get(prefix_k + ".overlap", buffers[k].data(), buffers[k].size() - treededispersions[k].get_ndump() * nchans))
+			return false;
+	}
+
+	return true;
 }
\ No newline at end of file
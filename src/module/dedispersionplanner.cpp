@@ -0,0 +1,376 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 15:03:07
+ * @modify date 2026-10-19 15:03:07
+ * @desc [description]
+ */
+
+#include <unistd.h>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+#include "json.hpp"
+#include "dedispersionplanner.h"
+#include "dedispersion.h"
+#include "subdedispersion.h"
+#include "dedispersionX.h"
+#include "fdmt.h"
+#include "noisefill.h"
+
+using namespace Pulsar;
+
+/* rms of the rounding of a delay to samples */
+static const double rms_round = 1./std::sqrt(12.);
+
+DedispersionPlanner::DedispersionPlanner()
+{
+	dms = 0.;
+	dme = 0.;
+	ddm = 0.;
+	memory_budget = 0.;
+	smearing_tolerance = 1.5;
+	ndumps = {1024, 4096, 16384};
+	nsubbands = {16, 32, 64, 128};
+	nthreads = {XLIBS::get_num_threads()};
+	backends = {"brute", "subband", "tree", "fdmt"};
+	nrepeat = 3;
+
+	best.backend = "";
+	best.nsubband = 0;
+	best.ndump = 0;
+	best.nthreads = 0;
+	best.memory = 0.;
+	best.smearing = 0.;
+	best.cost = 0.;
+}
+
+DedispersionPlanner::~DedispersionPlanner()
+{
+}
+
+bool DedispersionPlanner::plan(const DataBuffer<float> &databuffer)
+{
+	std::string key = get_key(databuffer);
+
+	if (!cachefile.empty() && load_cache(key))
+	{
+		BOOST_LOG_TRIVIAL(info)<<"dedispersion plan "<<best.backend<<" is read from "<<cachefile;
+		return true;
+	}
+
+	std::vector<DedispersionPlan> candidates;
+	make_candidates(candidates, databuffer);
+
+	tried.clear();
+	best.backend = "";
+	best.cost = std::numeric_limits<double>::max();
+
+	for (auto c=candidates.begin(); c!=candidates.end(); ++c)
+	{
+		if (memory_budget > 0. && c->memory > memory_budget) continue;
+		if (c->smearing > smearing_tolerance) continue;
+
+		c->cost = benchmark(*c, databuffer);
+		tried.push_back(*c);
+
+		BOOST_LOG_TRIVIAL(debug)<<"dedispersion candidate "<<c->backend<<" nsubband="<<c->nsubband<<" ndump="<<c->ndump<<" nthreads="<<c->nthreads<<" cost="<<c->cost;
+
+		if (c->cost < best.cost) best = *c;
+	}
+
+	if (best.backend.empty())
+	{
+		BOOST_LOG_TRIVIAL(error)<<"no dedispersion plan fits the memory budget and smearing tolerance";
+		return false;
+	}
+
+	std::vector<std::pair<std::string, std::string>> meta = {
+			{"backend", best.backend},
+			{"nsubband", std::to_string(best.nsubband)},
+			{"ndump", std::to_string(best.ndump)},
+			{"number of threads", std::to_string(best.nthreads)},
+			{"memory (MB)", std::to_string(best.memory / 1024. / 1024.)},
+			{"smearing (samples)", std::to_string(best.smearing)},
+			{"cost (s/s)", std::to_string(best.cost)},
+			{"candidates tried", std::to_string(tried.size())}
+		};
+	format_logging("Dedispersion Planner Info", meta);
+
+	if (!cachefile.empty()) save_cache(key);
+
+	return true;
+}
+
+void DedispersionPlanner::make_candidates(std::vector<DedispersionPlan> &candidates, const DataBuffer<float> &databuffer)
+{
+	size_t nchans = databuffer.nchans;
+	double tsamp = databuffer.tsamp;
+	double fmax = *std::max_element(databuffer.frequencies.begin(), databuffer.frequencies.end());
+	double fmin = *std::min_element(databuffer.frequencies.begin(), databuffer.frequencies.end());
+
+	double ddm_sample = tsamp / dispersion_delay(1., fmax, fmin);
+	double ddm_grid = ddm == 0. ? ddm_sample : ddm;
+	size_t ndm = std::ceil((dme - dms) / ddm_grid);
+
+	/* smearing of a dm between two trials, uniform in half a step */
+	double smear_grid = dispersion_delay(0.5 * ddm_grid, fmax, fmin) / tsamp / std::sqrt(3.);
+	double smear_sample = 0.5 / std::sqrt(3.);
+
+	size_t nchans2 = std::pow(2, std::ceil(std::log2(nchans)));
+	size_t depth = std::log2(nchans2);
+
+	for (auto b=backends.begin(); b!=backends.end(); ++b)
+	{
+		for (auto ndump=ndumps.begin(); ndump!=ndumps.end(); ++ndump)
+		{
+			auto roundup = [&](double n){return std::ceil(n / *ndump) * *ndump;};
+			size_t maxdelayn = std::ceil(dispersion_delay(dme, fmax, fmin) / tsamp);
+
+			for (auto nth=nthreads.begin(); nth!=nthreads.end(); ++nth)
+			{
+				DedispersionPlan c;
+				c.backend = *b;
+				c.ndump = *ndump;
+				c.nthreads = *nth;
+				c.cost = 0.;
+
+				if (*b == "brute")
+				{
+					c.nsubband = 0;
+					c.memory = 4. * ndm * (*ndump + roundup(maxdelayn) + *ndump) * nchans;
+					c.smearing = std::sqrt(rms_round * rms_round + smear_grid * smear_grid);
+					candidates.push_back(c);
+				}
+				else if (*b == "subband")
+				{
+					for (auto nsub=nsubbands.begin(); nsub!=nsubbands.end(); ++nsub)
+					{
+						if (*nsub > nchans) continue;
+
+						size_t nsubdm = std::ceil(1. * ndm / *nsub);
+						double smear_sub = dispersion_delay(0.5 * ddm_grid * *nsub, fmax, fmin) / *nsub / tsamp / std::sqrt(3.);
+						c.nsubband = *nsub;
+						c.memory = 4. * (2. * roundup(maxdelayn / *nsub + *ndump) * nchans + 2. * nsubdm * *nsub * (*ndump + roundup(maxdelayn)) + 2. * *nsub * nsubdm * *ndump);
+						c.smearing = std::sqrt(2. * rms_round * rms_round + smear_grid * smear_grid + smear_sub * smear_sub);
+						candidates.push_back(c);
+					}
+				}
+				else if (*b == "tree")
+				{
+					for (auto nsub=nsubbands.begin(); nsub!=nsubbands.end(); ++nsub)
+					{
+						if (*nsub > nchans2 || (*nsub & (*nsub - 1)) != 0) continue;
+
+						size_t maxdelayn_seg = std::ceil(dispersion_delay(dms + nchans2 * ddm_sample, fmax, fmin) / tsamp);
+						c.nsubband = *nsub;
+						c.memory = 4. * 3. * nchans2 * (*ndump + roundup(maxdelayn_seg));
+						c.smearing = std::sqrt(depth * rms_round * rms_round + smear_sample * smear_sample);
+						candidates.push_back(c);
+					}
+				}
+				else if (*b == "fdmt")
+				{
+					for (auto nsub=nsubbands.begin(); nsub!=nsubbands.end(); ++nsub)
+					{
+						if (*nsub > nchans) continue;
+
+						size_t nlevel = std::ceil(std::log2(1. * nchans / *nsub)) + 1;
+						size_t nsamples = *ndump + roundup(maxdelayn);
+						c.nsubband = *nsub;
+						c.memory = 4. * (2. * nchans * nsamples + 2. * (2. * nchans + maxdelayn) * nsamples);
+						c.smearing = std::sqrt(nlevel * rms_round * rms_round + smear_sample * smear_sample);
+						candidates.push_back(c);
+					}
+				}
+				else
+				{
+					BOOST_LOG_TRIVIAL(warning)<<"unknown dedispersion backend "<<*b;
+				}
+			}
+		}
+	}
+}
+
+double DedispersionPlanner::benchmark(const DedispersionPlan &candidate, const DataBuffer<float> &databuffer)
+{
+	/* the candidate thread count on the cpus of the caller */
+	XLIBS::ExecutionContext context(candidate.nthreads, XLIBS::ExecutionContext::current().get_cpus());
+	XLIBS::ExecutionContext::Scope scope(context);
+
+	size_t nchans = databuffer.nchans;
+	double tsamp = databuffer.tsamp;
+	double fmax = *std::max_element(databuffer.frequencies.begin(), databuffer.frequencies.end());
+	double fmin = *std::min_element(databuffer.frequencies.begin(), databuffer.frequencies.end());
+	double ddm_sample = tsamp / dispersion_delay(1., fmax, fmin);
+	double ddm_grid = ddm == 0. ? ddm_sample : ddm;
+
+	DataBuffer<float> data(candidate.ndump, nchans);
+	data.tsamp = tsamp;
+	data.frequencies = databuffer.frequencies;
+	NoiseFill noise;
+	noise.fill(data.buffer.data(), data.buffer.size(), 0, 0, 0);
+
+	/* the first block fills the overlap and is not timed */
+	double elapsed = 0.;
+	double scale = 1.;
+	auto timeit = [&](std::function<void()> f)
+	{
+		f();
+		auto t0 = std::chrono::steady_clock::now();
+		for (int k=0; k<nrepeat; k++) f();
+		auto t1 = std::chrono::steady_clock::now();
+		elapsed = std::chrono::duration<double>(t1 - t0).count();
+	};
+
+	if (candidate.backend == "brute")
+	{
+		/* one dm trial, the trials are independent */
+		Dedispersion dedisp;
+		dedisp.dm = dme;
+		dedisp.prepare(data);
+		timeit([&](){dedisp.run(data); dedisp.isbusy = false;});
+		scale = std::ceil((dme - dms) / ddm_grid);
+	}
+	else if (candidate.backend == "subband")
+	{
+		RealTime::SubbandDedispersion dedisp;
+		dedisp.nsubband = candidate.nsubband;
+		dedisp.ndump = candidate.ndump;
+		dedisp.dms = dms;
+		dedisp.ddm = ddm_grid;
+		dedisp.ndm = std::ceil((dme - dms) / ddm_grid);
+		dedisp.overlap = 0.;
+		dedisp.prepare(data);
+		timeit([&](){dedisp.run(data, candidate.ndump);});
+	}
+	else if (candidate.backend == "tree")
+	{
+		/* the first segment of DedispersionX, the following segments are downsampled by 2, 4, ... */
+		TreeDedispersion dedisp;
+		dedisp.nsubband = candidate.nsubband;
+		dedisp.dms = dms;
+		dedisp.ddm = ddm_sample;
+		dedisp.prepare(data);
+		dedisp.hit_all();
+		timeit([&](){dedisp.run(data);});
+
+		scale = 0.;
+		double ddm_seg = ddm_sample;
+		size_t ds = 1;
+		double dms_seg = dms;
+		do
+		{
+			scale += 1. / ds;
+			dms_seg += dedisp.get_nchans() * ddm_seg;
+			ddm_seg *= 2;
+			ds *= 2;
+		} while (dms_seg <= dme);
+	}
+	else if (candidate.backend == "fdmt")
+	{
+		FDMT dedisp;
+		dedisp.nsubband = candidate.nsubband;
+		dedisp.maxdm = dme;
+		dedisp.prepare(data);
+		timeit([&](){dedisp.run(data);});
+	}
+
+	return elapsed * scale / (nrepeat * candidate.ndump * tsamp);
+}
+
+std::string DedispersionPlanner::get_key(const DataBuffer<float> &databuffer)
+{
+	char hostname[256] = {0};
+	gethostname(hostname, 255);
+
+	std::ostringstream key;
+	key<<std::setprecision(12);
+	key<<hostname<<"_nchans"<<databuffer.nchans<<"_tsamp"<<databuffer.tsamp;
+	key<<"_fch1"<<databuffer.frequencies.front()<<"_fchn"<<databuffer.frequencies.back();
+	key<<"_dm"<<dms<<"-"<<dme<<"-"<<ddm;
+	key<<"_mem"<<memory_budget<<"_smear"<<smearing_tolerance;
+	key<<"_ndump";
+	for (auto n : ndumps) key<<"-"<<n;
+	key<<"_nsub";
+	for (auto n : nsubbands) key<<"-"<<n;
+	key<<"_nthreads";
+	for (auto n : nthreads) key<<"-"<<n;
+	key<<"_backends";
+	for (auto b : backends) key<<"-"<<b;
+
+	return key.str();
+}
+
+bool DedispersionPlanner::load_cache(const std::string &key)
+{
+	std::ifstream f(cachefile);
+	if (!f.is_open()) return false;
+
+	nlohmann::json cache;
+	try
+	{
+		f >> cache;
+	}
+	catch (const nlohmann::json::exception &e)
+	{
+		BOOST_LOG_TRIVIAL(warning)<<"can not parse dedispersion plan cache "<<cachefile;
+		return false;
+	}
+
+	if (!cache.contains(key)) return false;
+
+	nlohmann::json &p = cache[key];
+	best.backend = p["backend"];
+	best.nsubband = p["nsubband"];
+	best.ndump = p["ndump"];
+	best.nthreads = p["nthreads"];
+	best.memory = p["memory"];
+	best.smearing = p["smearing"];
+	best.cost = p["cost"];
+
+	return true;
+}
+
+void DedispersionPlanner::save_cache(const std::string &key)
+{
+	nlohmann::json cache;
+
+	std::ifstream fin(cachefile);
+	if (fin.is_open())
+	{
+		try
+		{
+			fin >> cache;
+		}
+		catch (const nlohmann::json::exception &e)
+		{
+			cache = nlohmann::json::object();
+		}
+		fin.close();
+	}
+
+	cache[key] = {
+		{"backend", best.backend},
+		{"nsubband", best.nsubband},
+		{"ndump", best.ndump},
+		{"nthreads", best.nthreads},
+		{"memory", best.memory},
+		{"smearing", best.smearing},
+		{"cost", best.cost}
+	};
+
+	std::ofstream fout(cachefile);
+	if (!fout.is_open())
+	{
+		BOOST_LOG_TRIVIAL(warning)<<"can not write dedispersion plan cache "<<cachefile;
+		return;
+	}
+	fout<<cache.dump(4)<<std::endl;
+}
@@ -60,7 +60,7 @@ DataBuffer<float> * Defaraday::filter(DataBuffer<float> &databuffer)
 	BOOST_LOG_TRIVIAL(debug)<<"perform defaraday";
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (size_t i=0; i<databuffer.nsamples; i++)
 	{
@@ -107,7 +107,7 @@ DataBuffer<float> * Defaraday::run(DataBuffer<float> &databuffer)
 	int nchans_real = databuffer.nchans / 4;
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (size_t i=0; i<databuffer.nsamples; i++)
 	{
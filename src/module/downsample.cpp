@@ -107,7 +107,7 @@ DataBuffer<float> * Downsample::run(DataBuffer<float> &databuffer)
 		std::fill(buffer.begin(), buffer.end(), 0.);
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<nsamples; i++)
 	{
@@ -141,6 +141,20 @@ DataBuffer<float> * Downsample::run(DataBuffer<float> &databuffer)
 		if (vars[j] == 0.) weights[j] = 0.;
 	}
 
+	/* a channel is flagged if all the merged channels are flagged */
+	chmask.clear();
+	if (!databuffer.chmask.empty())
+	{
+		chmask.resize(nchans, 1);
+		for (long int j=0; j<nchans; j++)
+		{
+			for (long int k=0; k<fd; k++)
+			{
+				if (!databuffer.chmask[j*fd+k]) chmask[j] = 0;
+			}
+		}
+	}
+
 	mean_var_ready = databuffer.mean_var_ready;
 
 	databuffer.isbusy = false;
@@ -12,9 +12,7 @@
 #include "dedisperse.h"
 #include "logging.h"
 
-#ifdef __AVX2__
-#include "avx2.h"
-#endif
+#include "simd.h"
 
 using namespace std;
 
@@ -72,23 +70,9 @@ DataBuffer<float> * Equalize::run(DataBuffer<float> &databuffer)
 		if (chstd[j] == 0.) chstd[j] = 1.;
 	}
 
-#ifndef __AVX2__
-
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
-#endif
-	for (long int i=0; i<nsamples; i++)
+	if (PulsarX::simd_enabled())
 	{
-		for (long int j=0; j<nchans; j++)
-		{
-			buffer[i*nchans+j] = (databuffer.buffer[i*nchans+j]-chmean[j])/chstd[j];
-		}
-	}
-
-#else
-	if (nchans % 8 == 0)
-	{
-		std::vector<float, boost::alignment::aligned_allocator<float, 32>> chmeanf(nchans, 0.), chstdf_inv(nchans, 0.);
+		aligned_vector<float> chmeanf(nchans, 0.), chstdf_inv(nchans, 0.);
 		for (long int j=0; j<nchans; j++)
 		{
 			chmeanf[j] = chmean[j];
@@ -96,17 +80,17 @@ DataBuffer<float> * Equalize::run(DataBuffer<float> &databuffer)
 		}
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int i=0; i<nsamples; i++)
 		{
-			PulsarX::normalize2(buffer.data()+i*nchans, databuffer.buffer.data()+i*nchans, chmeanf.data(), chstdf_inv.data(), nchans);
+			PulsarX::simd_kernels().normalize2(buffer.data()+i*nchans, databuffer.buffer.data()+i*nchans, chmeanf.data(), chstdf_inv.data(), nchans);
 		}
 	}
 	else
 	{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int i=0; i<nsamples; i++)
 		{
@@ -116,7 +100,6 @@ DataBuffer<float> * Equalize::run(DataBuffer<float> &databuffer)
 			}
 		}
 	}
-#endif
 
 	equalized = true;
 	counter += nsamples;
@@ -125,6 +108,7 @@ DataBuffer<float> * Equalize::run(DataBuffer<float> &databuffer)
 	std::fill(vars.begin(), vars.end(), 1.);
 	mean_var_ready = databuffer.mean_var_ready;
 	weights = databuffer.weights;
+	chmask = databuffer.chmask;
 
 	databuffer.isbusy = false;
 	isbusy = true;
@@ -160,23 +144,9 @@ DataBuffer<float> * Equalize::filter(DataBuffer<float> &databuffer)
 		if (chstd[j] == 0.) chstd[j] = 1.;
 	}
 
-#ifndef __AVX2__
-
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
-#endif
-	for (long int i=0; i<nsamples; i++)
-	{
-		for (long int j=0; j<nchans; j++)
-		{
-			databuffer.buffer[i*nchans+j] = (databuffer.buffer[i*nchans+j]-chmean[j])/chstd[j];
-		}
-	}
-
-#else
-	if (nchans % 8 == 0)
+	if (PulsarX::simd_enabled())
 	{
-		std::vector<float, boost::alignment::aligned_allocator<float, 32>> chmeanf(nchans, 0.), chstdf_inv(nchans, 0.);
+		aligned_vector<float> chmeanf(nchans, 0.), chstdf_inv(nchans, 0.);
 		for (long int j=0; j<nchans; j++)
 		{
 			chmeanf[j] = chmean[j];
@@ -184,17 +154,17 @@ DataBuffer<float> * Equalize::filter(DataBuffer<float> &databuffer)
 		}
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int i=0; i<nsamples; i++)
 		{
-			PulsarX::normalize2(databuffer.buffer.data()+i*nchans, databuffer.buffer.data()+i*nchans, chmeanf.data(), chstdf_inv.data(), nchans);
+			PulsarX::simd_kernels().normalize2(databuffer.buffer.data()+i*nchans, databuffer.buffer.data()+i*nchans, chmeanf.data(), chstdf_inv.data(), nchans);
 		}
 	}
 	else
 	{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int i=0; i<nsamples; i++)
 		{
@@ -204,7 +174,6 @@ DataBuffer<float> * Equalize::filter(DataBuffer<float> &databuffer)
 			}
 		}
 	}
-#endif
 
 	std::fill(databuffer.means.begin(), databuffer.means.end(), 0.);
 	std::fill(databuffer.vars.begin(), databuffer.vars.end(), 1.);
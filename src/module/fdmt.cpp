@@ -0,0 +1,409 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 14:20:32
+ * @modify date 2026-10-19 14:20:32
+ * @desc [description]
+ */
+
+#include "fdmt.h"
+#include "utils.h"
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+using namespace Pulsar;
+
+static const size_t norow = std::numeric_limits<size_t>::max();
+
+FDMT::FDMT()
+{
+	nsubband = 1;
+	maxdm = 0.;
+
+	mean_var_ready = false;
+
+	ready = false;
+	counter = 0;
+	nchans = 0;
+	ndump = 0;
+	tsamp = 0.;
+	foff = 0.;
+	maxdelayn = 0;
+	offset = 0;
+	nsamples = 0;
+	nlevel = 0;
+}
+
+FDMT::~FDMT()
+{
+}
+
+void FDMT::close()
+{
+	buffer.clear();
+	buffer.shrink_to_fit();
+
+	bufferT.clear();
+	bufferT.shrink_to_fit();
+
+	state0.clear();
+	state0.shrink_to_fit();
+
+	state1.clear();
+	state1.shrink_to_fit();
+}
+
+void FDMT::prepare(DataBuffer<float> &databuffer)
+{
+	tsamp = databuffer.tsamp;
+	ndump = databuffer.nsamples;
+	nchans = databuffer.nchans;
+
+	if (nsubband == 0 || nsubband > nchans)
+	{
+		BOOST_LOG_TRIVIAL(error)<<"number of subbands should be in [1, number of channels]";
+		exit(-1);
+	}
+
+	frequencies.resize(nchans);
+	double fch1 = databuffer.frequencies.front();
+	foff = nchans > 1 ? (databuffer.frequencies.back() - databuffer.frequencies.front()) / (nchans - 1) : 0.;
+	for (size_t j=0; j<nchans; j++)
+	{
+		frequencies[j] = fch1 + j * foff;
+	}
+
+	double fmax = *std::max_element(frequencies.begin(), frequencies.end()) + 0.5 * std::abs(foff);
+	double fmin = *std::min_element(frequencies.begin(), frequencies.end()) - 0.5 * std::abs(foff);
+
+	maxdelayn = std::ceil(dmdelay(maxdm, fmax, fmin) / tsamp);
+
+	nsamples = ndump + ceil(1.*maxdelayn/ndump)*ndump;
+	offset = nsamples - ndump;
+
+	plan();
+
+	buffer.resize(nsamples * nchans, 0.);
+	bufferT.resize(nchans * nsamples, 0.);
+
+	size_t nrow0 = 0, nrow1 = 0;
+	for (size_t k=0; k<nlevel; k++)
+	{
+		size_t &nrow = k % 2 ? nrow1 : nrow0;
+		nrow = std::max(nrow, rows[k].back());
+	}
+	state0.resize(nrow0 * nsamples, 0.);
+	state1.resize(nrow1 * nsamples, 0.);
+
+	means.resize(nsubband, 0.);
+	vars.resize(nsubband, 0.);
+
+	ready = true;
+
+	std::vector<std::pair<std::string, std::string>> meta = {
+			{"maximum dm", std::to_string(maxdm)},
+			{"maximum delay", std::to_string(maxdelayn)},
+			{"number of subbands", std::to_string(nsubband)},
+			{"number of levels", std::to_string(nlevel)},
+			{"tsamp", std::to_string(tsamp)},
+			{"offset of first sample", std::to_string(offset)},
+			{"buffer size", std::to_string(nsamples)},
+			{"dump size", std::to_string(ndump)}
+		};
+	format_logging("FDMT Info", meta);
+}
+
+/**
+ * @brief split the subbands into halves until single channels, a node of one channel is carried to the next level,
+ * so any number of channels is supported without padding
+ */
+void FDMT::plan()
+{
+	/* top down */
+	std::vector<std::vector<size_t>> bounds(1);
+	std::vector<std::vector<size_t>> child0, child1;
+
+	for (size_t s=0; s<=nsubband; s++)
+	{
+		bounds[0].push_back(s * nchans / nsubband);
+	}
+
+	while (bounds.back().size() - 1 < nchans)
+	{
+		const std::vector<size_t> &b = bounds.back();
+		std::vector<size_t> bnext, c0, c1;
+		for (size_t i=0; i<b.size()-1; i++)
+		{
+			c0.push_back(bnext.size());
+			bnext.push_back(b[i]);
+			if (b[i+1] - b[i] > 1)
+			{
+				c1.push_back(bnext.size());
+				bnext.push_back(b[i] + (b[i+1] - b[i] + 1) / 2);
+			}
+			else
+			{
+				c1.push_back(norow);
+			}
+		}
+		bnext.push_back(b.back());
+
+		child0.push_back(c0);
+		child1.push_back(c1);
+		bounds.push_back(bnext);
+	}
+
+	nlevel = bounds.size();
+
+	/* bottom up, level 0 are the channels */
+	std::reverse(bounds.begin(), bounds.end());
+	std::reverse(child0.begin(), child0.end());
+	std::reverse(child1.begin(), child1.end());
+
+	chans = bounds;
+	fhs.resize(nlevel);
+	fls.resize(nlevel);
+	ndelays.resize(nlevel);
+	rows.resize(nlevel);
+	rowH.resize(nlevel);
+	rowL.resize(nlevel);
+	shiftL.resize(nlevel);
+
+	for (size_t k=0; k<nlevel; k++)
+	{
+		size_t nnode = chans[k].size() - 1;
+		fhs[k].resize(nnode);
+		fls[k].resize(nnode);
+		ndelays[k].resize(nnode);
+		rows[k].resize(nnode + 1);
+
+		rows[k][0] = 0;
+		for (size_t i=0; i<nnode; i++)
+		{
+			double fa = frequencies[chans[k][i]];
+			double fb = frequencies[chans[k][i+1] - 1];
+			fhs[k][i] = std::max(fa, fb) + 0.5 * std::abs(foff);
+			fls[k][i] = std::min(fa, fb) - 0.5 * std::abs(foff);
+			ndelays[k][i] = std::ceil(dmdelay(maxdm, fhs[k][i], fls[k][i]) / tsamp) + 1;
+			rows[k][i+1] = rows[k][i] + ndelays[k][i];
+		}
+	}
+
+	/* delay tables of the merges */
+	for (size_t k=1; k<nlevel; k++)
+	{
+		size_t nnode = chans[k].size() - 1;
+		rowH[k].resize(rows[k].back());
+		rowL[k].resize(rows[k].back());
+		shiftL[k].resize(rows[k].back());
+
+		for (size_t i=0; i<nnode; i++)
+		{
+			size_t i0 = child0[k-1][i];
+			size_t i1 = child1[k-1][i];
+
+			if (i1 == norow)
+			{
+				for (int d=0; d<ndelays[k][i]; d++)
+				{
+					rowH[k][rows[k][i] + d] = rows[k-1][i0] + std::min(d, ndelays[k-1][i0] - 1);
+					rowL[k][rows[k][i] + d] = norow;
+					shiftL[k][rows[k][i] + d] = 0;
+				}
+				continue;
+			}
+
+			size_t iH = fhs[k-1][i0] > fhs[k-1][i1] ? i0 : i1;
+			size_t iL = fhs[k-1][i0] > fhs[k-1][i1] ? i1 : i0;
+
+			double fh = fhs[k][i];
+			double fl = fls[k][i];
+			double fm = fls[k-1][iH];
+			double ratio = (1./(fm*fm) - 1./(fh*fh)) / (1./(fl*fl) - 1./(fh*fh));
+
+			for (int d=0; d<ndelays[k][i]; d++)
+			{
+				int dH = std::min((int)std::round(d * ratio), ndelays[k-1][iH] - 1);
+				int dL = std::max(0, std::min(d - dH, ndelays[k-1][iL] - 1));
+
+				rowH[k][rows[k][i] + d] = rows[k-1][iH] + dH;
+				rowL[k][rows[k][i] + d] = rows[k-1][iL] + dL;
+				shiftL[k][rows[k][i] + d] = dH;
+			}
+		}
+	}
+
+	frequencies_sub = fhs[nlevel - 1];
+}
+
+/**
+ * @brief row d of channel j is the mean of samples t..t+d, the smearing within the channel
+ */
+void FDMT::init_leaves()
+{
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+	for (size_t j=0; j<nchans; j++)
+	{
+		const float *in = bufferT.data() + j * nsamples;
+		float *out = state0.data() + rows[0][j] * nsamples;
+
+		std::copy(in, in + nsamples, out);
+
+		for (int d=1; d<ndelays[0][j]; d++)
+		{
+			float *prev = out + (d - 1) * nsamples;
+			float *cur = out + d * nsamples;
+			for (size_t i=0; i<nsamples-d; i++)
+			{
+				cur[i] = prev[i] + in[i + d];
+			}
+			for (size_t i=nsamples-d; i<nsamples; i++)
+			{
+				cur[i] = prev[i];
+			}
+		}
+
+		for (int d=1; d<ndelays[0][j]; d++)
+		{
+			float *cur = out + d * nsamples;
+			float scl = 1. / (d + 1);
+			for (size_t i=0; i<nsamples; i++)
+			{
+				cur[i] *= scl;
+			}
+		}
+	}
+}
+
+void FDMT::merge(size_t level)
+{
+	const float *in = (level - 1) % 2 ? state1.data() : state0.data();
+	float *out = level % 2 ? state1.data() : state0.data();
+
+	size_t nrow = rows[level].back();
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+	for (size_t r=0; r<nrow; r++)
+	{
+		const float *pH = in + rowH[level][r] * nsamples;
+		float *po = out + r * nsamples;
+
+		if (rowL[level][r] == norow)
+		{
+			std::copy(pH, pH + nsamples, po);
+			continue;
+		}
+
+		size_t shift = shiftL[level][r];
+		const float *pL = in + rowL[level][r] * nsamples + shift;
+		for (size_t i=0; i<nsamples-shift; i++)
+		{
+			po[i] = pH[i] + pL[i];
+		}
+		for (size_t i=nsamples-shift; i<nsamples; i++)
+		{
+			po[i] = pH[i];
+		}
+	}
+}
+
+void FDMT::run(DataBuffer<float> &databuffer)
+{
+	size_t nspace = nsamples - ndump;
+
+	for (size_t i=0; i<ndump; i++)
+	{
+		for (size_t j=0; j<nchans; j++)
+		{
+			buffer[(i + nspace) * nchans + j] = (databuffer.chmask.empty() or !databuffer.chmask[j]) ? databuffer.buffer[i * nchans + j] : 0.;
+		}
+	}
+
+	/* weighted sums over the channels of each subband, the masked channels are zeros */
+	if (databuffer.mean_var_ready)
+	{
+		std::fill(means.begin(), means.end(), 0.);
+		std::fill(vars.begin(), vars.end(), 0.);
+		for (size_t s=0; s<nsubband; s++)
+		{
+			for (size_t j=s*nchans/nsubband; j<(s+1)*nchans/nsubband; j++)
+			{
+				if (!databuffer.chmask.empty() and databuffer.chmask[j]) continue;
+				means[s] += databuffer.weights[j] * databuffer.means[j];
+				vars[s] += databuffer.weights[j] * databuffer.vars[j];
+			}
+		}
+	}
+	mean_var_ready = databuffer.mean_var_ready;
+
+	transpose_pad<float>(bufferT.data(), buffer.data(), nsamples, nchans);
+
+	init_leaves();
+
+	for (size_t k=1; k<nlevel; k++)
+	{
+		merge(k);
+	}
+
+	for (size_t i=0; i<nspace; i++)
+	{
+		for (size_t j=0; j<nchans; j++)
+		{
+			buffer[i * nchans + j] = buffer[(i + ndump) * nchans + j];
+		}
+	}
+
+	counter += ndump;
+}
+
+void FDMT::get_subdata(double dm, DataBuffer<float> &subdata, bool dedisperse)
+{
+	size_t top = nlevel - 1;
+	const float *temp = top % 2 ? state1.data() : state0.data();
+
+	subdata.resize(ndump, nsubband);
+	subdata.tsamp = tsamp;
+	subdata.frequencies = frequencies_sub;
+	subdata.means.resize(nsubband);
+	subdata.vars.resize(nsubband);
+
+	double fref = *std::max_element(frequencies_sub.begin(), frequencies_sub.end());
+
+	std::vector<size_t> rowid(nsubband, 0);
+	std::vector<size_t> delayn(nsubband, 0);
+	for (size_t j=0; j<nsubband; j++)
+	{
+		int d = std::round(dmdelay(dm, fhs[top][j], fls[top][j]) / tsamp);
+		rowid[j] = rows[top][j] + std::max(0, std::min(d, ndelays[top][j] - 1));
+
+		if (dedisperse)
+		{
+			delayn[j] = std::round(dmdelay(dm, fref, fhs[top][j]) / tsamp);
+			delayn[j] = std::min(delayn[j], nsamples - ndump);
+		}
+	}
+
+	for (size_t i=0; i<ndump; i++)
+	{
+		for (size_t j=0; j<nsubband; j++)
+		{
+			subdata.buffer[i * nsubband + j] = temp[rowid[j] * nsamples + i + delayn[j]];
+		}
+	}
+
+	std::copy(means.begin(), means.end(), subdata.means.begin());
+	std::copy(vars.begin(), vars.end(), subdata.vars.begin());
+
+	subdata.mean_var_ready = mean_var_ready;
+
+	subdata.counter += ndump;
+}
@@ -112,6 +112,35 @@ void FilterbankReader::read_header()
 }
 
 void FilterbankReader::skip_head()
+{
+	skip_to(skip_start);
+}
+
+void FilterbankReader::seek(size_t isample)
+{
+	/* release the file being read, the position is counted from the first file again */
+	if (!update_file and ifile_cur < (long int)fil.size()) fil[idmap[ifile_cur]].free();
+
+	ntot = 0;
+	count = 0;
+	ns_filn = 0;
+
+	ifile_cur = 0;
+	isubint_cur = 0;
+	isample_cur = 0;
+
+	update_file = true;
+	update_subint = true;
+
+	is_end = false;
+
+	skip_to(isample);
+
+	ntot = count - std::min(count, skip_start);
+	if (count >= nsamples - skip_end) is_end = true;
+}
+
+void FilterbankReader::skip_to(size_t isample)
 {
 	size_t nfil = fnames.size();
 	
@@ -128,7 +157,7 @@ void FilterbankReader::skip_head()
 		{
 			for (size_t i=0; i<nsblk; i++)
 			{
-				if (count == skip_start)
+				if (count == isample)
 				{
 					ifile_cur = idxn;
 					isubint_cur = s;
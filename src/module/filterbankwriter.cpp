@@ -6,9 +6,7 @@
  * @desc [description]
  */
 
-#ifdef __AVX2__
-#include "avx2.h"
-#endif
+#include "simd.h"
 
 #include <iostream>
 
@@ -77,19 +75,9 @@ void FilterbankWriter::run(DataBuffer<float> &databuffer)
 	}
 
 	double tmpmean=0., tmpstd=0.;
-#ifndef __AVX2__
-	for (long int i=0; i<databuffer.nsamples; i++)
+	if (PulsarX::simd_enabled())
 	{
-		for (long int j=0; j<databuffer.nchans; j++)
-		{
-			tmpmean += databuffer.buffer[i*databuffer.nchans+j];
-			tmpstd += databuffer.buffer[i*databuffer.nchans+j]*databuffer.buffer[i*databuffer.nchans+j];
-		}
-	}
-#else
-	if (databuffer.nsamples*databuffer.nchans % 4 == 0)
-	{
-		PulsarX::accumulate_mean_var2(tmpmean, tmpstd, databuffer.buffer.data(), databuffer.nsamples*databuffer.nchans);
+		PulsarX::simd_kernels().accumulate_mean_var2(tmpmean, tmpstd, databuffer.buffer.data(), databuffer.nsamples*databuffer.nchans);
 	}
 	else
 	{
@@ -102,7 +90,6 @@ void FilterbankWriter::run(DataBuffer<float> &databuffer)
 			}
 		}
 	}
-#endif
 	tmpmean /= databuffer.nsamples*databuffer.nchans;
 	tmpstd /= databuffer.nsamples*databuffer.nchans;
 	tmpstd -= tmpmean*tmpmean;
@@ -117,21 +104,9 @@ void FilterbankWriter::run(DataBuffer<float> &databuffer)
 	case 8:
 	{
 		std::vector<unsigned char> data8bit(databuffer.nsamples*databuffer.nchans, 0);
-#ifndef __AVX2__
-		for (long int i=0; i<databuffer.nsamples; i++)
-		{
-			for (long int j=0; j<databuffer.nchans; j++)
-			{
-				float tmp = std::round(scl*databuffer.buffer[i*databuffer.nchans+j]+offs);
-				tmp = std::max(0.f, tmp);
-				tmp = std::min(255.f, tmp);
-				data8bit[i*databuffer.nchans+j] = tmp;
-			}
-		}
-#else
-		if (databuffer.nsamples*databuffer.nchans % 8 == 0)
+		if (PulsarX::simd_enabled())
 		{
-			PulsarX::scale(data8bit.data(), databuffer.buffer.data(), scl, offs, 8, databuffer.nsamples*databuffer.nchans);
+			PulsarX::simd_kernels().scale(data8bit.data(), databuffer.buffer.data(), scl, offs, 8, databuffer.nsamples*databuffer.nchans);
 		}
 		else
 		{
@@ -146,7 +121,6 @@ void FilterbankWriter::run(DataBuffer<float> &databuffer)
 				}
 			}
 		}
-#endif
 
 		outfile.write((char *)(data8bit.data()), sizeof(unsigned char)*databuffer.nsamples*databuffer.nchans);
 	};break;
@@ -155,25 +129,9 @@ void FilterbankWriter::run(DataBuffer<float> &databuffer)
 		assert(databuffer.nchans % 2 == 0);
 
 		std::vector<unsigned char> data4bit(databuffer.nsamples*databuffer.nchans/2, 0);
-#ifndef __AVX2__
-		for (long int i=0; i<databuffer.nsamples; i++)
-		{
-			for (long int j=0; j<databuffer.nchans/2; j++)
-			{
-				float tmp0 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*2+0]+offs);
-				float tmp1 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*2+1]+offs);
-				tmp0 = std::max(0.f, tmp0);
-				tmp0 = std::min(15.f, tmp0);
-				tmp1 = std::max(0.f, tmp1);
-				tmp1 = std::min(15.f, tmp1);
-
-				data4bit[i*databuffer.nchans/2+j] = ((unsigned char)tmp0) + (((unsigned char)tmp1) << 4);
-			}
-		}
-#else
-		if (databuffer.nsamples*databuffer.nchans % 8 == 0)
+		if (PulsarX::simd_enabled())
 		{
-			PulsarX::scale(data4bit.data(), databuffer.buffer.data(), scl, offs, 4, databuffer.nsamples*databuffer.nchans);
+			PulsarX::simd_kernels().scale(data4bit.data(), databuffer.buffer.data(), scl, offs, 4, databuffer.nsamples*databuffer.nchans);
 		}
 		else
 		{
@@ -192,7 +150,6 @@ void FilterbankWriter::run(DataBuffer<float> &databuffer)
 				}
 			}
 		}
-#endif
 
 		outfile.write((char *)(data4bit.data()), sizeof(unsigned char)*databuffer.nsamples*databuffer.nchans/2);
 
@@ -202,31 +159,9 @@ void FilterbankWriter::run(DataBuffer<float> &databuffer)
 		assert(databuffer.nchans % 4 == 0);
 
 		std::vector<unsigned char> data2bit(databuffer.nsamples*databuffer.nchans/4, 0);
-#ifndef __AVX2__
-		for (long int i=0; i<databuffer.nsamples; i++)
-		{
-			for (long int j=0; j<databuffer.nchans/4; j++)
-			{
-				float tmp0 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*4+0]+offs);
-				float tmp1 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*4+1]+offs);
-				float tmp2 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*4+2]+offs);
-				float tmp3 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*4+3]+offs);
-				tmp0 = std::max(0.f, tmp0);
-				tmp0 = std::min(3.f, tmp0);
-				tmp1 = std::max(0.f, tmp1);
-				tmp1 = std::min(3.f, tmp1);
-				tmp2 = std::max(0.f, tmp2);
-				tmp2 = std::min(3.f, tmp2);
-				tmp3 = std::max(0.f, tmp3);
-				tmp3 = std::min(3.f, tmp3);
-
-				data2bit[i*databuffer.nchans/4+j] = ((unsigned char)tmp0) + (((unsigned char)tmp1) << 2) + (((unsigned char)tmp2) << 4) + (((unsigned char)tmp3) << 6);
-			}
-		}
-#else
-		if (databuffer.nsamples*databuffer.nchans % 8 == 0)
+		if (PulsarX::simd_enabled())
 		{
-			PulsarX::scale(data2bit.data(), databuffer.buffer.data(), scl, offs, 2, databuffer.nsamples*databuffer.nchans);
+			PulsarX::simd_kernels().scale(data2bit.data(), databuffer.buffer.data(), scl, offs, 2, databuffer.nsamples*databuffer.nchans);
 		}
 		else
 		{
@@ -251,7 +186,6 @@ void FilterbankWriter::run(DataBuffer<float> &databuffer)
 				}
 			}
 		}
-#endif
 
 		outfile.write((char *)(data2bit.data()), sizeof(unsigned char)*databuffer.nsamples*databuffer.nchans/4);
 
@@ -261,43 +195,9 @@ void FilterbankWriter::run(DataBuffer<float> &databuffer)
 		assert(databuffer.nsamples*databuffer.nchans % 8 == 0);
 
 		std::vector<unsigned char> data1bit(databuffer.nsamples*databuffer.nchans/8, 0);
-#ifndef __AVX2__
-		for (long int i=0; i<databuffer.nsamples; i++)
-		{
-			for (long int j=0; j<databuffer.nchans/8; j++)
-			{
-				float tmp0 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*8+0]+offs);
-				float tmp1 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*8+1]+offs);
-				float tmp2 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*8+2]+offs);
-				float tmp3 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*8+3]+offs);
-				float tmp4 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*8+4]+offs);
-				float tmp5 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*8+5]+offs);
-				float tmp6 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*8+6]+offs);
-				float tmp7 = std::round(scl*databuffer.buffer[i*databuffer.nchans+j*8+7]+offs);
-				tmp0 = std::max(0.f, tmp0);
-				tmp0 = std::min(1.f, tmp0);
-				tmp1 = std::max(0.f, tmp1);
-				tmp1 = std::min(1.f, tmp1);
-				tmp2 = std::max(0.f, tmp2);
-				tmp2 = std::min(1.f, tmp2);
-				tmp3 = std::max(0.f, tmp3);
-				tmp3 = std::min(1.f, tmp3);
-				tmp4 = std::max(0.f, tmp4);
-				tmp4 = std::min(1.f, tmp4);
-				tmp5 = std::max(0.f, tmp5);
-				tmp5 = std::min(1.f, tmp5);
-				tmp6 = std::max(0.f, tmp6);
-				tmp6 = std::min(1.f, tmp6);
-				tmp7 = std::max(0.f, tmp7);
-				tmp7 = std::min(1.f, tmp7);
-
-				data1bit[i*databuffer.nchans/8+j] = ((unsigned char)tmp0) + (((unsigned char)tmp1) << 1) + (((unsigned char)tmp2) << 2) + (((unsigned char)tmp3) << 3) + (((unsigned char)tmp4) << 4) + (((unsigned char)tmp5) << 5) + (((unsigned char)tmp6) << 6) + (((unsigned char)tmp7) << 7);
-			}
-		}
-#else
-		if (databuffer.nchans % 8 == 0)
+		if (PulsarX::simd_enabled() && databuffer.nchans % 8 == 0)
 		{
-			PulsarX::scale(data1bit.data(), databuffer.buffer.data(), scl, offs, 1, databuffer.nsamples*databuffer.nchans);
+			PulsarX::simd_kernels().scale(data1bit.data(), databuffer.buffer.data(), scl, offs, 1, databuffer.nsamples*databuffer.nchans);
 		}
 		else
 		{
@@ -334,7 +234,6 @@ void FilterbankWriter::run(DataBuffer<float> &databuffer)
 				}
 			}
 		}
-#endif
 
 		outfile.write((char *)(data1bit.data()), sizeof(unsigned char)*databuffer.nsamples*databuffer.nchans/8);
 
@@ -35,7 +35,7 @@ DataBuffer<float> * Flip::filter(DataBuffer<float> &databuffer)
 	BOOST_LOG_TRIVIAL(debug)<<"flip the frequency";
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<nsamples; i++)
 	{
@@ -0,0 +1,182 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 13:05:30
+ * @modify date 2026-10-19 13:05:30
+ * @desc [description]
+ */
+
+#include <string.h>
+#include <algorithm>
+#include "maskstream.h"
+
+static const char maskstream_magic[8] = {'X', 'R', 'F', 'I', 'M', 'S', 'K', '1'};
+
+/* run-length encode cells, visiting cell (i, j) in order of index */
+static void encode(std::vector<uint64_t> &runs, const std::vector<unsigned char> &cells, size_t nsamples, size_t nchans, bool freqmajor)
+{
+	runs.clear();
+
+	size_t nrow = freqmajor ? nchans : nsamples;
+	size_t ncol = freqmajor ? nsamples : nchans;
+
+	uint64_t k = 0;
+	bool inrun = false;
+	for (size_t r=0; r<nrow; r++)
+	{
+		for (size_t c=0; c<ncol; c++)
+		{
+			unsigned char m = freqmajor ? cells[c*nchans+r] : cells[r*ncol+c];
+			if (m and !inrun)
+			{
+				runs.push_back(k);
+				inrun = true;
+			}
+			else if (!m and inrun)
+			{
+				runs.push_back(k-runs.back());
+				inrun = false;
+			}
+			k++;
+		}
+	}
+
+	if (inrun) runs.push_back(k-runs.back());
+}
+
+MaskStream::MaskStream()
+{
+	writing = false;
+	reading = false;
+}
+
+MaskStream::MaskStream(const MaskStream &maskstream)
+{
+	filename = maskstream.filename;
+	writing = false;
+	reading = false;
+}
+
+MaskStream & MaskStream::operator=(const MaskStream &maskstream)
+{
+	filename = maskstream.filename;
+	writing = false;
+	reading = false;
+
+	return *this;
+}
+
+MaskStream::~MaskStream()
+{
+	close();
+}
+
+bool MaskStream::open(const std::string &fname, const std::string &mode)
+{
+	close();
+
+	filename = fname;
+
+	if (mode == "w")
+	{
+		file.open(filename, std::ios::out|std::ios::binary|std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		file.write(maskstream_magic, 8);
+		writing = true;
+	}
+	else if (mode == "r")
+	{
+		file.open(filename, std::ios::in|std::ios::binary);
+		if (!file.is_open()) return false;
+
+		char magic[8];
+		file.read(magic, 8);
+		if (!file or memcmp(magic, maskstream_magic, 8) != 0)
+		{
+			file.close();
+			return false;
+		}
+		reading = true;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void MaskStream::close()
+{
+	if (file.is_open()) file.close();
+	writing = false;
+	reading = false;
+}
+
+void MaskStream::write(uint64_t counter, uint32_t step, float fill, const std::vector<unsigned char> &cells, size_t nsamples, size_t nchans)
+{
+	if (!writing) return;
+
+	std::vector<uint64_t> runs_t, runs_f;
+	encode(runs_t, cells, nsamples, nchans, false);
+	encode(runs_f, cells, nsamples, nchans, true);
+
+	uint32_t order = runs_f.size() < runs_t.size() ? 1 : 0;
+	std::vector<uint64_t> &runs = order ? runs_f : runs_t;
+
+	uint32_t ns = nsamples;
+	uint32_t nc = nchans;
+	uint64_t nruns = runs.size()/2;
+
+	file.write((char *)&counter, sizeof(counter));
+	file.write((char *)&step, sizeof(step));
+	file.write((char *)&ns, sizeof(ns));
+	file.write((char *)&nc, sizeof(nc));
+	file.write((char *)&fill, sizeof(fill));
+	file.write((char *)&order, sizeof(order));
+	file.write((char *)&nruns, sizeof(nruns));
+	file.write((char *)runs.data(), sizeof(uint64_t)*runs.size());
+}
+
+bool MaskStream::read(uint64_t &counter, uint32_t &step, float &fill, std::vector<unsigned char> &cells, size_t &nsamples, size_t &nchans)
+{
+	if (!reading) return false;
+
+	uint32_t ns = 0, nc = 0, order = 0;
+	uint64_t nruns = 0;
+
+	file.read((char *)&counter, sizeof(counter));
+	file.read((char *)&step, sizeof(step));
+	file.read((char *)&ns, sizeof(ns));
+	file.read((char *)&nc, sizeof(nc));
+	file.read((char *)&fill, sizeof(fill));
+	file.read((char *)&order, sizeof(order));
+	file.read((char *)&nruns, sizeof(nruns));
+	if (!file) return false;
+
+	std::vector<uint64_t> runs(2*nruns, 0);
+	file.read((char *)runs.data(), sizeof(uint64_t)*runs.size());
+	if (!file) return false;
+
+	nsamples = ns;
+	nchans = nc;
+
+	cells.resize(nsamples*nchans);
+	std::fill(cells.begin(), cells.end(), 0);
+
+	for (uint64_t r=0; r<nruns; r++)
+	{
+		uint64_t start = runs[2*r];
+		uint64_t end = std::min(start+runs[2*r+1], (uint64_t)(nsamples*nchans));
+		for (uint64_t k=start; k<end; k++)
+		{
+			if (order == 0)
+				cells[k] = 1;
+			else
+				cells[(k%nsamples)*nchans+k/nsamples] = 1;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,276 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 16:52:40
+ * @modify date 2026-10-19 16:52:40
+ * @desc [description]
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <iomanip>
+
+#include "multifold.h"
+#include "psrfitswriter.h"
+#include "utils.h"
+
+#include "simd.h"
+
+using namespace Pulsar;
+
+XLIBS_TARGET_CLONES static void accumulate_row(float *out, const float *in, size_t n)
+{
+	for (size_t i=0; i<n; i++)
+	{
+		out[i] += in[i];
+	}
+}
+
+MultiFold::MultiFold()
+{
+	tsubint = 10.;
+	nbin = 128;
+	knot_interval = 0.1;
+	nthreads = 1;
+}
+
+MultiFold::~MultiFold()
+{
+}
+
+void MultiFold::prepare()
+{
+	/* candidates of the same dm share the subband data */
+	std::map<double, size_t> dmmap;
+
+	groupdms.clear();
+	groups.clear();
+	for (size_t k=0; k<candidates.size(); k++)
+	{
+		auto d = dmmap.find(candidates[k].dm);
+		if (d == dmmap.end())
+		{
+			dmmap[candidates[k].dm] = groups.size();
+			groupdms.push_back(candidates[k].dm);
+			groups.push_back(std::vector<size_t>{k});
+		}
+		else
+		{
+			groups[d->second].push_back(k);
+		}
+
+		if (candidates[k].orbit.Pb > 0. && candidates[k].orbit.f0 == 0.)
+			candidates[k].orbit.f0 = candidates[k].f0;
+
+		if (candidates[k].rootname.empty())
+		{
+			std::stringstream ss;
+			ss << "cand_" << std::setw(5) << std::setfill('0') << k + 1;
+			candidates[k].rootname = ss.str();
+		}
+	}
+
+	folds.clear();
+	folds.resize(candidates.size());
+	for (auto f=folds.begin(); f!=folds.end(); ++f)
+	{
+		f->nsubband = 0;
+		f->tsamp = 0.;
+		f->fref = 0.;
+		f->nsamp_per_subint = 0;
+		f->nsamples = 0;
+		f->isamp = 0;
+	}
+
+	nthreads = XLIBS::get_num_threads();
+	subdatas.resize(nthreads);
+	bins.resize(nthreads);
+
+	std::vector<std::pair<std::string, std::string>> meta = {
+			{"number of candidates", std::to_string(candidates.size())},
+			{"number of dm", std::to_string(groups.size())},
+			{"number of bins", std::to_string(nbin)},
+			{"subint length", std::to_string(tsubint)},
+			{"knot interval", std::to_string(knot_interval)}
+		};
+	format_logging("Multi Fold Info", meta);
+}
+
+/**
+ * @brief unwrapped phase of candidate k at sample isample of the current block
+ */
+long double MultiFold::get_phase(size_t k, long int isample)
+{
+	FoldCandidate &cand = candidates[k];
+	FoldProfiles &f = folds[k];
+
+	long double t = (f.nsamples + isample) * (long double)f.tsamp;
+
+	if (!cand.predictor.empty())
+		return cand.predictor.get_phase(start_mjd.to_day() + t / 86400., f.fref);
+
+	if (cand.orbit.Pb > 0.)
+		return cand.orbit.f0 * (t - cand.orbit.get_roemer(start_mjd.to_day() + t / 86400.));
+
+	return cand.f0 * t + 0.5 * cand.f1 * t * t;
+}
+
+double MultiFold::get_period(size_t k, long int isample)
+{
+	FoldCandidate &cand = candidates[k];
+	FoldProfiles &f = folds[k];
+
+	long double t = (f.nsamples + isample) * (long double)f.tsamp;
+
+	if (!cand.predictor.empty())
+		return cand.predictor.get_pfold(start_mjd.to_day() + t / 86400., f.fref);
+
+	if (cand.orbit.Pb > 0.)
+		return 1. / cand.orbit.get_ffold(start_mjd.to_day() + t / 86400.);
+
+	return 1. / (cand.f0 + cand.f1 * t);
+}
+
+void MultiFold::fold(DataBuffer<float> &subdata, size_t g, int thread_id)
+{
+	size_t ndump = subdata.nsamples;
+	size_t nsub = subdata.nchans;
+
+	std::vector<int> &bin = bins[thread_id];
+	bin.resize(ndump);
+
+	for (auto k=groups[g].begin(); k!=groups[g].end(); ++k)
+	{
+		FoldProfiles &f = folds[*k];
+
+		if (f.nsubband == 0)
+		{
+			f.nsubband = nsub;
+			f.tsamp = subdata.tsamp;
+			f.frequencies = subdata.frequencies;
+			f.fref = *std::max_element(subdata.frequencies.begin(), subdata.frequencies.end());
+			f.nsamp_per_subint = std::max(1., std::round(tsubint / subdata.tsamp));
+			f.sums.resize(nbin * nsub, 0.);
+			f.hits.resize(nbin, 0);
+		}
+
+		/* exact phases at the knots, linear in between */
+		size_t step = std::max(1., std::round(knot_interval / f.tsamp));
+
+		long double phi1 = get_phase(*k, 0);
+		for (size_t i0=0; i0<ndump; i0+=step)
+		{
+			size_t i1 = std::min(ndump, i0 + step);
+
+			long double phi0 = phi1;
+			phi1 = get_phase(*k, i1);
+
+			double phi = phi0 - std::floor(phi0);
+			double dphi = (phi1 - phi0) / (i1 - i0);
+			PulsarX::simd_kernels().phase_bins(bin.data() + i0, phi, dphi, i1 - i0, nbin);
+		}
+
+		/* accumulate, flushing at the subint boundaries */
+		for (size_t i=0; i<ndump; i++)
+		{
+			accumulate_row(f.sums.data() + bin[i] * nsub, subdata.buffer.data() + i * nsub, nsub);
+			f.hits[bin[i]]++;
+
+			if (++f.isamp == f.nsamp_per_subint) flush(*k, i + 1);
+		}
+
+		f.nsamples += ndump;
+	}
+}
+
+/**
+ * @brief average the sums of the current subint into (nsubband, nbin) profiles,
+ * bins without hits take the mean of the subband, iend is the end of the subint in the current block
+ */
+void MultiFold::flush(size_t k, long int iend)
+{
+	FoldProfiles &f = folds[k];
+
+	size_t nsub = f.nsubband;
+
+	std::vector<double> means(nsub, 0.);
+	size_t nhits = 0;
+	for (long int b=0; b<nbin; b++)
+	{
+		for (size_t j=0; j<nsub; j++)
+		{
+			means[j] += f.sums[b * nsub + j];
+		}
+		nhits += f.hits[b];
+	}
+	for (size_t j=0; j<nsub; j++)
+	{
+		means[j] /= nhits;
+	}
+
+	size_t offset = f.profiles.size();
+	f.profiles.resize(offset + nsub * nbin, 0.);
+	for (long int b=0; b<nbin; b++)
+	{
+		for (size_t j=0; j<nsub; j++)
+		{
+			f.profiles[offset + j * nbin + b] = f.hits[b] ? f.sums[b * nsub + j] / f.hits[b] : means[j];
+		}
+	}
+
+	long int isubint = f.periods.size();
+	f.periods.push_back(get_period(k, iend - (long int)f.isamp / 2));
+	f.offs_subs.push_back((isubint + 0.5) * f.nsamp_per_subint * f.tsamp);
+
+	std::fill(f.sums.begin(), f.sums.end(), 0.);
+	std::fill(f.hits.begin(), f.hits.end(), 0);
+	f.isamp = 0;
+}
+
+void MultiFold::close()
+{
+	for (size_t k=0; k<folds.size(); k++)
+	{
+		if (folds[k].isamp > 0) flush(k, 0);
+	}
+}
+
+void MultiFold::write_archives()
+{
+	for (size_t k=0; k<candidates.size(); k++)
+	{
+		FoldProfiles &f = folds[k];
+		if (f.periods.empty()) continue;
+
+		DataBuffer<float> header;
+		header.nchans = f.nsubband;
+		header.tsamp = f.tsamp;
+		header.frequencies = f.frequencies;
+
+		PsrfitsWriter<float> writer;
+		writer.mode = Integration::FOLD;
+		writer.rootname = candidates[k].rootname;
+		writer.template_file = template_file;
+		writer.start_mjd = start_mjd;
+		writer.nsamp_per_subint = f.nsamp_per_subint;
+		writer.nbin = nbin;
+		writer.dm = candidates[k].dm;
+		writer.src_name = src_name;
+		writer.ra = ra;
+		writer.dec = dec;
+		writer.telescope = telescope;
+
+		writer.prepare(header);
+
+		for (size_t l=0; l<f.periods.size(); l++)
+		{
+			writer.write_fold(f.profiles.data() + l * f.nsubband * nbin, f.periods[l], f.offs_subs[l]);
+		}
+
+		writer.close();
+	}
+
+	BOOST_LOG_TRIVIAL(info)<<"wrote "<<candidates.size()<<" fold mode archives";
+}
@@ -11,9 +11,7 @@
 #include "utils.h"
 #include "logging.h"
 
-#ifdef __AVX2__
-#include "avx2.h"
-#endif
+#include "simd.h"
 
 Patch::Patch()
 {
@@ -21,6 +19,7 @@ Patch::Patch()
 	width = 0.1;
 	threshold = 5.;
 	killrate = 0.;
+	noise = NoiseFill(0, NoiseFill::salt("patch", 0));
 }
 
 Patch::Patch(nlohmann::json &config)
@@ -28,6 +27,7 @@ Patch::Patch(nlohmann::json &config)
 	filltype = config["filltype"];
 	width = config["width"];
 	threshold = config["threshold"];
+	noise = NoiseFill(config.value<uint64_t>("seed", 0), NoiseFill::salt("patch", config.value<uint64_t>("ibeam", 0)));
 }
 
 Patch::~Patch(){}
@@ -37,6 +37,7 @@ void Patch::read_config(nlohmann::json &config)
 	filltype = config["filltype"];
 	width = config["width"];
 	threshold = config["threshold"];
+	noise = NoiseFill(config.value<uint64_t>("seed", 0), NoiseFill::salt("patch", config.value<uint64_t>("ibeam", 0)));
 }
 
 void Patch::prepare(DataBuffer<float> &databuffer)
@@ -62,21 +63,13 @@ DataBuffer<float> * Patch::filter(DataBuffer<float> &databuffer)
 	std::vector<double> sstd(nsamples, 0);
 	std::vector<bool> mask(nsamples, false);
 
-	if (nchans % 8 == 0)
+	if (PulsarX::simd_enabled())
 	{
 		for (long int i=0; i<nsamples; i++)
 		{
 			float temp1 = 0.;
 			float temp2 = 0.;
-#ifndef __AVX2__
-			for (long int j=0; j<nchans; j++)
-			{
-				temp1 += databuffer.buffer[i*nchans+j];
-				temp2 += databuffer.buffer[i*nchans+j] * databuffer.buffer[i*nchans+j];
-			}
-#else
-			PulsarX::accumulate_mean_var3(temp1, temp2, databuffer.buffer.data() + i*nchans, nchans);
-#endif
+			PulsarX::simd_kernels().accumulate_mean_var3(temp1, temp2, databuffer.buffer.data() + i*nchans, nchans);
 			temp1 /= nchans;
 			temp2 /= nchans;
 			temp2 -= temp1 * temp1;
@@ -120,30 +113,17 @@ DataBuffer<float> * Patch::filter(DataBuffer<float> &databuffer)
 
 	killrate = kill_count * 1. / nsamples;
 
-#ifndef __AVX2__
-	std::vector<double> chvar(nchans, 0.);
-	std::vector<double> chmean(nchans, 0.);
-#else
-	std::vector<double, boost::alignment::aligned_allocator<double, 32>> chvar(nchans, 0.);
-	std::vector<double, boost::alignment::aligned_allocator<double, 32>> chmean(nchans, 0.);
-#endif
+	aligned_vector<double> chvar(nchans, 0.);
+	aligned_vector<double> chmean(nchans, 0.);
 	long int cnt = 0;
 
-	if (nchans % 4 == 0)
+	if (PulsarX::simd_enabled())
 	{
 		for (long int i=0; i<nsamples; i++)
 		{
 			if (mask[i]) continue;
 
-#ifndef __AVX2__
-			for (long int j=0; j<nchans; j++)
-			{
-				chmean[j] += databuffer.buffer[i*nchans+j];
-				chvar[j] += databuffer.buffer[i*nchans+j] * databuffer.buffer[i*nchans+j];
-			}
-#else
-			PulsarX::accumulate_mean_var(chmean.data(), chvar.data(), databuffer.buffer.data()+i*nchans, nchans);
-#endif
+			PulsarX::simd_kernels().accumulate_mean_var(chmean.data(), chvar.data(), databuffer.buffer.data()+i*nchans, nchans);
 			cnt++;
 		}
 	}
@@ -172,7 +152,7 @@ DataBuffer<float> * Patch::filter(DataBuffer<float> &databuffer)
 	if (filltype == "mean")
 	{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int i=0; i<nsamples; i++)
 		{
@@ -186,22 +166,21 @@ DataBuffer<float> * Patch::filter(DataBuffer<float> &databuffer)
 	}
 	else if (filltype == "rand")
 	{
-		std::vector<std::random_device> r(nchans);
-		std::vector<std::mt19937> generators;
-		std::vector<std::normal_distribution<float>> distributions;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
 		for (long int j=0; j<nchans; j++)
 		{
-			generators.emplace_back(std::mt19937(r[j]()));
-			distributions.emplace_back(std::normal_distribution<float>(chmean[j], std::sqrt(chvar[j])));
-		}
+			float chstd = std::sqrt(chvar[j]);
+			long int i = 0;
+			while (i < nsamples)
+			{
+				if (!mask[i]) {i++; continue;}
 
-		for (long int i=0; i<nsamples; i++)
-		{
-			if (!mask[i]) continue;
+				long int start = i;
+				while (i < nsamples and mask[i]) i++;
 
-			for (long int j=0; j<nchans; j++)
-			{
-				databuffer.buffer[i*nchans+j] = distributions[j](generators[j]);
+				noise.fill_strided(databuffer.buffer.data()+start*nchans+j, i-start, nchans, databuffer.counter, j, start, chmean[j], chstd);
 			}
 		}
 	}
@@ -229,19 +208,11 @@ DataBuffer<float> * Patch::filter2(DataBuffer<float> &databuffer)
 	std::vector<double> s(nsamples, 0);
 	std::vector<bool> mask(nsamples, false);
 
-	if (nchans % 8 == 0)
+	if (PulsarX::simd_enabled())
 	{
 		for (long int i=0; i<nsamples; i++)
 		{
-#ifndef __AVX2__
-			double temp = 0.;
-			for (long int j=0; j<nchans; j++)
-			{
-				temp += databuffer.buffer[i*nchans+j];
-			}
-#else
-			double temp = PulsarX::reduce(databuffer.buffer.data() + i*nchans, nchans);
-#endif
+			double temp = PulsarX::simd_kernels().reduce(databuffer.buffer.data() + i*nchans, nchans);
 			szero[i] = temp/nchans;
 		}
 	}
@@ -286,30 +257,17 @@ DataBuffer<float> * Patch::filter2(DataBuffer<float> &databuffer)
 
 	killrate = kill_count * 1. / nsamples;
 
-#ifndef __AVX2__
-	std::vector<double> chvar(nchans, 0.);
-	std::vector<double> chmean(nchans, 0.);
-#else
-	std::vector<double, boost::alignment::aligned_allocator<double, 32>> chvar(nchans, 0.);
-	std::vector<double, boost::alignment::aligned_allocator<double, 32>> chmean(nchans, 0.);
-#endif
+	aligned_vector<double> chvar(nchans, 0.);
+	aligned_vector<double> chmean(nchans, 0.);
 	long int cnt = 0;
 
-	if (nchans % 4 == 0)
+	if (PulsarX::simd_enabled())
 	{
 		for (long int i=0; i<nsamples; i++)
 		{
 			if (mask[i]) continue;
 
-#ifndef __AVX2__
-			for (long int j=0; j<nchans; j++)
-			{
-				chmean[j] += databuffer.buffer[i*nchans+j];
-				chvar[j] += databuffer.buffer[i*nchans+j] * databuffer.buffer[i*nchans+j];
-			}
-#else
-			PulsarX::accumulate_mean_var(chmean.data(), chvar.data(), databuffer.buffer.data()+i*nchans, nchans);
-#endif
+			PulsarX::simd_kernels().accumulate_mean_var(chmean.data(), chvar.data(), databuffer.buffer.data()+i*nchans, nchans);
 			cnt++;
 		}
 	}
@@ -338,7 +296,7 @@ DataBuffer<float> * Patch::filter2(DataBuffer<float> &databuffer)
 	if (filltype == "mean")
 	{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int i=0; i<nsamples; i++)
 		{
@@ -352,22 +310,21 @@ DataBuffer<float> * Patch::filter2(DataBuffer<float> &databuffer)
 	}
 	else if (filltype == "rand")
 	{
-		std::vector<std::random_device> r(nchans);
-		std::vector<std::mt19937> generators;
-		std::vector<std::normal_distribution<float>> distributions;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
 		for (long int j=0; j<nchans; j++)
 		{
-			generators.emplace_back(std::mt19937(r[j]()));
-			distributions.emplace_back(std::normal_distribution<float>(chmean[j], std::sqrt(chvar[j])));
-		}
+			float chstd = std::sqrt(chvar[j]);
+			long int i = 0;
+			while (i < nsamples)
+			{
+				if (!mask[i]) {i++; continue;}
 
-		for (long int i=0; i<nsamples; i++)
-		{
-			if (!mask[i]) continue;
+				long int start = i;
+				while (i < nsamples and mask[i]) i++;
 
-			for (long int j=0; j<nchans; j++)
-			{
-				databuffer.buffer[i*nchans+j] = distributions[j](generators[j]);
+				noise.fill_strided(databuffer.buffer.data()+start*nchans+j, i-start, nchans, databuffer.counter, j, start, chmean[j], chstd);
 			}
 		}
 	}
@@ -0,0 +1,303 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 16:10:31
+ * @modify date 2026-10-19 16:10:31
+ * @desc [description]
+ */
+
+#include <cmath>
+#include <algorithm>
+
+#include "periodicity.h"
+#include "dedisperse.h"
+#include "utils.h"
+
+#include "simd.h"
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+using namespace Pulsar;
+
+/* gaussian significance of the sum of nh unit exponential powers (Wilson-Hilferty) */
+static inline float gamma_sigma(float s, int nh)
+{
+	double v = 1. / (9. * nh);
+	return (std::cbrt(s / nh) - (1. - v)) / std::sqrt(v);
+}
+
+static inline float gamma_threshold(float sigma, int nh)
+{
+	double v = 1. / (9. * nh);
+	return nh * std::pow(1. - v + sigma * std::sqrt(v), 3);
+}
+
+PeriodicitySearch::PeriodicitySearch()
+{
+	nbatch = 16;
+	maxharm = 16;
+	threshold = 6.;
+	minfreq = 0.1;
+	rn_width = 6;
+	rn_growth = 1.1;
+	rn_maxwidth = 1000;
+	sift_tolerance = 1.1;
+	maxcands = 2000;
+	fftw_flags = FFTW_ESTIMATE;
+
+	ndm = 0;
+	nsamples = 0;
+	nbins = 0;
+	tsamp = 0.;
+	nthreads = 1;
+	plan = NULL;
+}
+
+PeriodicitySearch::~PeriodicitySearch()
+{
+	close();
+}
+
+void PeriodicitySearch::close()
+{
+	if (plan != NULL)
+	{
+		fftwf_destroy_plan(plan);
+		plan = NULL;
+	}
+
+	for (auto p=fftin.begin(); p!=fftin.end(); ++p) fftwf_free(*p);
+	for (auto p=fftout.begin(); p!=fftout.end(); ++p) fftwf_free(*p);
+	fftin.clear();
+	fftout.clear();
+}
+
+void PeriodicitySearch::prepare(size_t n, size_t ns, double ts)
+{
+	close();
+
+	ndm = n;
+	nsamples = ns;
+	tsamp = ts;
+	nbins = nsamples / 2 + 1;
+
+	if ((maxharm & (maxharm - 1)) != 0)
+	{
+		BOOST_LOG_TRIVIAL(error)<<"maximum number of harmonics should be a power of 2";
+		exit(-1);
+	}
+
+	if (!wisdomfile.empty())
+	{
+		if (!fftwf_import_wisdom_from_filename(wisdomfile.c_str()))
+			BOOST_LOG_TRIVIAL(warning)<<"can not import fftw wisdom from "<<wisdomfile;
+	}
+
+	nthreads = XLIBS::get_num_threads();
+
+	fftin.resize(nthreads, NULL);
+	fftout.resize(nthreads, NULL);
+	for (size_t t=0; t<nthreads; t++)
+	{
+		fftin[t] = fftwf_alloc_real(nbatch * nsamples);
+		fftout[t] = fftwf_alloc_complex(nbatch * nbins);
+	}
+
+	/* the batches of all threads share the plan through the new array execute */
+	int dims[1] = {(int)nsamples};
+	plan = fftwf_plan_many_dft_r2c(1, dims, nbatch, fftin[0], NULL, 1, nsamples, fftout[0], NULL, 1, nbins, fftw_flags);
+
+	if (!wisdomfile.empty())
+	{
+		if (!fftwf_export_wisdom_to_filename(wisdomfile.c_str()))
+			BOOST_LOG_TRIVIAL(warning)<<"can not export fftw wisdom to "<<wisdomfile;
+	}
+
+	powers.resize(nthreads * nbins, 0.);
+	sums.resize(nthreads * nbins, 0.);
+	scratch.resize(nthreads * rn_maxwidth, 0.);
+	rowcands.resize(ndm);
+
+	std::vector<std::pair<std::string, std::string>> meta = {
+			{"number of dm", std::to_string(ndm)},
+			{"number of samples", std::to_string(nsamples)},
+			{"frequency resolution", std::to_string(1. / (nsamples * tsamp))},
+			{"fft batch", std::to_string(nbatch)},
+			{"maximum harmonics", std::to_string(maxharm)},
+			{"threshold", std::to_string(threshold)}
+		};
+	format_logging("Periodicity Search Info", meta);
+}
+
+void PeriodicitySearch::run(const float *data, size_t ld)
+{
+	size_t nb = (ndm + nbatch - 1) / nbatch;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads)
+#endif
+	for (size_t ib=0; ib<nb; ib++)
+	{
+		int thread_id = omp_get_thread_num();
+
+		float *in = fftin[thread_id];
+		fftwf_complex *out = fftout[thread_id];
+
+		for (size_t r=0; r<nbatch; r++)
+		{
+			size_t k = ib * nbatch + r;
+			if (k >= ndm)
+			{
+				std::fill(in + r * nsamples, in + (r + 1) * nsamples, 0.);
+				continue;
+			}
+
+			const float *row = data + k * ld;
+			double mean = 0.;
+			for (size_t i=0; i<nsamples; i++) mean += row[i];
+			mean /= nsamples;
+			for (size_t i=0; i<nsamples; i++) in[r * nsamples + i] = row[i] - mean;
+		}
+
+		fftwf_execute_dft_r2c(plan, in, out);
+
+		float *power = powers.data() + thread_id * nbins;
+		for (size_t r=0; r<nbatch; r++)
+		{
+			size_t k = ib * nbatch + r;
+			if (k >= ndm) break;
+
+			for (size_t j=0; j<nbins; j++)
+			{
+				power[j] = out[r * nbins + j][0] * out[r * nbins + j][0] + out[r * nbins + j][1] * out[r * nbins + j][1];
+			}
+
+			whiten(power, scratch.data() + thread_id * rn_maxwidth);
+
+			rowcands[k].clear();
+			harmonic_sum(rowcands[k], sums.data() + thread_id * nbins, power, k);
+		}
+	}
+
+	sift();
+
+	BOOST_LOG_TRIVIAL(debug)<<"found "<<candidates.size()<<" periodicity candidates";
+}
+
+/**
+ * @brief divide the powers by the local median / ln2, the median of blocks of growing width
+ * is interpolated linearly between the block centers
+ */
+void PeriodicitySearch::whiten(float *power, float *scratch)
+{
+	std::vector<double> centers, medians;
+
+	size_t start = 1;
+	double w = rn_width;
+	while (start < nbins)
+	{
+		size_t width = std::min((size_t)w, nbins - start);
+		std::copy(power + start, power + start + width, scratch);
+		std::nth_element(scratch, scratch + width / 2, scratch + width);
+
+		centers.push_back(start + 0.5 * (width - 1));
+		medians.push_back(scratch[width / 2]);
+
+		start += width;
+		w = std::min(w * rn_growth, (double)rn_maxwidth);
+	}
+
+	power[0] = 0.;
+
+	size_t m = 0;
+	for (size_t j=1; j<nbins; j++)
+	{
+		while (m + 1 < centers.size() && centers[m + 1] <= j) m++;
+
+		double med = medians[m];
+		if (m + 1 < centers.size() && j > centers[m])
+		{
+			double x = (j - centers[m]) / (centers[m + 1] - centers[m]);
+			med = (1. - x) * medians[m] + x * medians[m + 1];
+		}
+
+		power[j] = med > 0. ? power[j] * M_LN2 / med : 0.;
+	}
+}
+
+void PeriodicitySearch::harmonic_sum(std::vector<PeriodicityCandidate> &cands, float *sum, const float *power, uint32_t idm)
+{
+	double T = nsamples * tsamp;
+
+	for (uint32_t nh=1; nh<=maxharm; nh*=2)
+	{
+		PulsarX::simd_kernels().harmonic_sum(sum, power, nbins, nh);
+
+		float thre = gamma_threshold(threshold, nh);
+		size_t kmin = std::max(1., std::ceil(minfreq * T * nh));
+
+		/* one candidate per run above threshold */
+		bool inrun = false;
+		size_t kpeak = 0;
+		for (size_t k=kmin; k<=nbins; k++)
+		{
+			if (k < nbins && sum[k] >= thre)
+			{
+				if (!inrun || sum[k] > sum[kpeak]) kpeak = k;
+				inrun = true;
+			}
+			else if (inrun)
+			{
+				PeriodicityCandidate cand;
+				cand.idm = idm;
+				cand.dm = vdm.empty() ? idm : vdm[idm];
+				cand.nh = nh;
+				cand.freq = kpeak / (nh * T);
+				cand.power = sum[kpeak];
+				cand.sigma = gamma_sigma(sum[kpeak], nh);
+				cand.nhits = 1;
+				cands.push_back(cand);
+				inrun = false;
+			}
+		}
+	}
+}
+
+/**
+ * @brief merge the candidates of neighbouring dms and of harmonically related frequencies
+ * (harmonics and subharmonics up to maxharm) into the strongest one
+ */
+void PeriodicitySearch::sift()
+{
+	std::vector<PeriodicityCandidate> all;
+	for (size_t k=0; k<ndm; k++)
+	{
+		all.insert(all.end(), rowcands[k].begin(), rowcands[k].end());
+	}
+
+	std::sort(all.begin(), all.end(), [](const PeriodicityCandidate &a, const PeriodicityCandidate &b){return a.sigma > b.sigma;});
+	if (all.size() > maxcands) all.resize(maxcands);
+
+	double tol = sift_tolerance / (nsamples * tsamp);
+
+	candidates.clear();
+	for (auto c=all.begin(); c!=all.end(); ++c)
+	{
+		bool matched = false;
+		for (auto s=candidates.begin(); s!=candidates.end() && !matched; ++s)
+		{
+			for (uint32_t n=1; n<=maxharm && !matched; n++)
+			{
+				if (std::abs(c->freq - s->freq * n) < tol * n || std::abs(c->freq * n - s->freq) < tol * n)
+				{
+					s->nhits++;
+					matched = true;
+				}
+			}
+		}
+
+		if (!matched) candidates.push_back(*c);
+	}
+}
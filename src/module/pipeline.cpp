@@ -21,6 +21,8 @@ Pipeline::~Pipeline()
 
 void Pipeline::prepare(DataBuffer<float> &databuffer)
 {
+	ExecutionContext::Scope scope(context);
+
 	downsample.prepare(databuffer);
 
 	equalize.prepare(downsample);
@@ -52,7 +54,12 @@ void Pipeline::prepare(DataBuffer<float> &databuffer)
 
 DataBuffer<float> * Pipeline::run(DataBuffer<float> &databuffer)
 {
+	ExecutionContext::Scope scope(context);
+
 	DataBuffer<float> *data = downsample.run(databuffer);
+
+	/* sk needs the power data */
+	data = rfi.prerun(*data);
 	
 	data = equalize.filter(*data);
 
@@ -63,4 +70,22 @@ DataBuffer<float> * Pipeline::run(DataBuffer<float> &databuffer)
 	if (!databuffer.isbusy && mode == MEMORY) data->closable = true;
 
 	return DataBuffer<float>::filter(*data);
+}
+
+void Pipeline::save_state(Checkpoint &checkpoint, const std::string &prefix) const
+{
+	DataBuffer<float>::save_state(checkpoint, prefix);
+	downsample.save_state(checkpoint, prefix + ".downsample");
+	equalize.save_state(checkpoint, prefix + ".equalize");
+	baseline.save_state(checkpoint, prefix + ".baseline");
+	rfi.save_state(checkpoint, prefix + ".rfi");
+}
+
+bool Pipeline::load_state(const Checkpoint &checkpoint, const std::string &prefix)
+{
+	return DataBuffer<float>::load_state(checkpoint, prefix) and
+		downsample.load_state(checkpoint, prefix + ".downsample") and
+		equalize.load_state(checkpoint, prefix + ".equalize") and
+		baseline.load_state(checkpoint, prefix + ".baseline") and
+		rfi.load_state(checkpoint, prefix + ".rfi");
 }
\ No newline at end of file
@@ -49,7 +49,7 @@ DataBuffer<float> * Preprocess::run(DataBuffer<short> &databuffer)
 	nwin = nwin/2*2+1;
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int j=0; j<databuffer.nchans; j++)
 	{
@@ -334,7 +334,7 @@ DataBuffer<float> * Preprocess::run(DataBuffer<short> &databuffer)
 	for (long int l=0; l<fd; l++)
 	{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int j=0; j<nchans; j++)
 		{
@@ -383,7 +383,7 @@ void Preprocess::get_stat(DataBuffer<short> &databuffer)
 	nwin = nwin/2*2+1;
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int j=0; j<databuffer.nchans; j++)
 	{
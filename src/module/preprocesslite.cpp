@@ -7,15 +7,12 @@
  */
 
 #include <limits>
-#include <random>
 #include "preprocesslite.h"
 #include "utils.h"
 #include "dedisperse.h"
 #include "logging.h"
 
-#ifdef __AVX2__
-#include "avx2.h"
-#endif
+#include "simd.h"
 
 void PreprocessLite::prepare(DataBuffer<float> &databuffer)
 {
@@ -60,58 +57,13 @@ DataBuffer<float> * PreprocessLite::run(DataBuffer<float> &databuffer)
 
 	std::vector<float> chkurtosis(databuffer.nchans, 0.), chskewness(databuffer.nchans, 0.), chmean(databuffer.nchans, 0.), chstd(databuffer.nchans, 0.);
 
-#ifndef __AVX2__
-	std::vector<double> chmean1(databuffer.nchans, 0.), chmean2(databuffer.nchans, 0.), chmean3(databuffer.nchans, 0.), chmean4(databuffer.nchans, 0.), chcorr(databuffer.nchans, 0.), last_data(databuffer.nchans, 0.);
-	for (long int i=0; i<databuffer.nsamples; i++)
-	{
-		for (long int j=0; j<databuffer.nchans; j++)
-		{
-			double tmp1 = databuffer.buffer[i*databuffer.nchans+j];
-			double tmp2 = tmp1*tmp1;
-			double tmp3 = tmp2*tmp1;
-			double tmp4 = tmp2*tmp2;
-			chmean1[j] += tmp1;
-			chmean2[j] += tmp2;
-			chmean3[j] += tmp3;
-			chmean4[j] += tmp4;
-			
-			chcorr[j] += tmp1*last_data[j];
-			last_data[j] = tmp1;
-		}
-	}
-#else
-	std::vector<double, boost::alignment::aligned_allocator<double, 32>> chmean1(databuffer.nchans, 0.), chmean2(databuffer.nchans, 0.), chmean3(databuffer.nchans, 0.), chmean4(databuffer.nchans, 0.), chcorr(databuffer.nchans, 0.), last_data(databuffer.nchans, 0.);
+	aligned_vector<double> chmean1(databuffer.nchans, 0.), chmean2(databuffer.nchans, 0.), chmean3(databuffer.nchans, 0.), chmean4(databuffer.nchans, 0.), chcorr(databuffer.nchans, 0.), last_data(databuffer.nchans, 0.);
 
-	if (databuffer.nchans % 4 == 0)
-	{
-		for (long int i=0; i<databuffer.nsamples; i++)
-		{
-			PulsarX::accumulate_mean1_mean2_mean3_mean4_corr1(chmean1.data(), chmean2.data(), chmean3.data(), chmean4.data(), chcorr.data(), last_data.data(), databuffer.buffer.data()+i*databuffer.nchans, databuffer.nchans);
-		}
-	}
-	else
+	for (long int i=0; i<databuffer.nsamples; i++)
 	{
-		for (long int i=0; i<databuffer.nsamples; i++)
-		{
-			for (long int j=0; j<databuffer.nchans; j++)
-			{
-				double tmp1 = databuffer.buffer[i*databuffer.nchans+j];
-				double tmp2 = tmp1*tmp1;
-				double tmp3 = tmp2*tmp1;
-				double tmp4 = tmp2*tmp2;
-				chmean1[j] += tmp1;
-				chmean2[j] += tmp2;
-				chmean3[j] += tmp3;
-				chmean4[j] += tmp4;
-				
-				chcorr[j] += tmp1*last_data[j];
-				last_data[j] = tmp1;
-			}
-		}
+		PulsarX::simd_kernels().accumulate_moments(chmean1.data(), chmean2.data(), chmean3.data(), chmean4.data(), chcorr.data(), last_data.data(), databuffer.buffer.data()+i*databuffer.nchans, databuffer.nchans);
 	}
 
-#endif
-
 	for (long int j=0; j<databuffer.nchans; j++)
 	{
 		chmean1[j] /= databuffer.nsamples;
@@ -211,7 +163,7 @@ DataBuffer<float> * PreprocessLite::run(DataBuffer<float> &databuffer)
 	if (td == 1 && fd == 1)
 	{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int i=0; i<nsamples; i++)
 		{
@@ -262,39 +214,24 @@ DataBuffer<float> * PreprocessLite::run(DataBuffer<float> &databuffer)
 		}
 	}
 
+	/* zero weight channels are zero filled, unless replaced by noise below */
+	chmask.resize(nchans, 0);
+	for (long int j=0; j<nchans; j++)
+	{
+		chmask[j] = (weights[j] == 0. and filltype != "rand") ? 1 : 0;
+	}
+
 	double stddev = std::sqrt(td*fd);
 	if (filltype == "rand")
 	{
 #ifdef _OPENMP
-		std::vector<std::random_device> r(num_threads);
-		std::vector<std::mt19937> generators;
-		for (long int k=0; k<num_threads; k++) generators.emplace_back(std::mt19937(r[k]()));
-		std::vector<std::normal_distribution<float>> distributions(num_threads, std::normal_distribution<float>(0., stddev));
-
-		#pragma omp parallel for num_threads(num_threads)
-		for (long int i=0; i<nsamples; i++)
-		{
-			int thread_id = omp_get_thread_num();
-			for (long int j=0; j<nchans; j++)
-			{
-				if (weights[j] == 0.)
-					buffer[i*nchans+j] = distributions[thread_id](generators[thread_id]);
-			}
-		}
-#else
-		std::random_device r;
-		std::mt19937 generator(r());
-		std::normal_distribution<float> distribution(0., stddev);
-
-		for (long int i=0; i<nsamples; i++)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+		for (long int j=0; j<nchans; j++)
 		{
-			for (long int j=0; j<nchans; j++)
-			{
-				if (weights[j] == 0.)
-					buffer[i*nchans+j] = distribution(generator);
-			}
+			if (weights[j] == 0.)
+				noise.fill_strided(buffer.data()+j, nsamples, nchans, counter, j, 0, 0., stddev);
 		}
-#endif
 		std::fill(weights.begin(), weights.end(), 1.);
 	}
 
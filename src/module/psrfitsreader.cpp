@@ -77,6 +77,35 @@ void PsrfitsReader::check()
 }
 
 void PsrfitsReader::skip_head()
+{
+	skip_to(skip_start);
+}
+
+void PsrfitsReader::seek(size_t isample)
+{
+	/* release the file being read, the position is counted from the first file again */
+	if (!update_file and ifile_cur < (long int)psf.size()) psf[idmap[ifile_cur]].close();
+
+	ntot = 0;
+	count = 0;
+	ns_psfn = 0;
+
+	ifile_cur = 0;
+	isubint_cur = 0;
+	isample_cur = 0;
+
+	update_file = true;
+	update_subint = true;
+
+	is_end = false;
+
+	skip_to(isample);
+
+	ntot = count - std::min(count, skip_start);
+	if (count >= nsamples - skip_end) is_end = true;
+}
+
+void PsrfitsReader::skip_to(size_t isample)
 {
 	size_t npsf = fnames.size();
 
@@ -96,7 +125,7 @@ void PsrfitsReader::skip_head()
 		{
 			for (size_t i=0; i<psf[n].subint.nsblk; i++)
 			{
-				if (count == skip_start)
+				if (count == isample)
 				{
 					ifile_cur = idxn;
 					isubint_cur = s;
@@ -10,9 +10,9 @@
 #include <sstream>
 #include <iomanip>
 #include <math.h>
-#include <immintrin.h>
 
 #include "psrfitswriter.h"
+#include "simd.h"
 
 using namespace std;
 
@@ -31,6 +31,8 @@ PsrfitsWriter<T>::PsrfitsWriter()
     ichunk = 0;
     ibeam = 1;
     npol = 1;
+    nbin = 0;
+    dm = 0.;
 
 	obs_mode = "SEARCH";
 }
@@ -47,6 +49,46 @@ PsrfitsWriter<T>::~PsrfitsWriter()
 template <typename T>
 void PsrfitsWriter<T>::prepare(DataBuffer<float> &databuffer)
 {
+    if (mode == Integration::FOLD)
+    {
+        DataBuffer<T>::nchans = databuffer.nchans;
+        DataBuffer<T>::nsamples = 0;
+        DataBuffer<T>::frequencies = databuffer.frequencies;
+        DataBuffer<T>::tsamp = databuffer.tsamp;
+
+        int nchans_real = databuffer.nchans/npol;
+
+        fits.primary.start_mjd = start_mjd;
+        strcpy(fits.primary.src_name, src_name.c_str());
+        strcpy(fits.primary.ra, ra.c_str());
+        strcpy(fits.primary.dec, dec.c_str());
+        strcpy(fits.primary.telesop, telescope.c_str());
+        strcpy(fits.primary.ibeam, to_string(ibeam).c_str());
+
+        fits.filename = rootname + ".fits";
+        strcpy(fits.primary.obs_mode, "PSR");
+
+        fits.subint.mode = Integration::FOLD;
+        fits.subint.dtype = Integration::SHORT;
+        fits.subint.npol = npol;
+        fits.subint.nchan = nchans_real;
+        fits.subint.nbin = nbin;
+        fits.subint.tbin = DataBuffer<T>::tsamp;
+        fits.subint.dm = dm;
+
+        fits.parse_template(template_file);
+        fits.primary.unload(fits.fptr);
+        fits.subint.unload_header(fits.fptr);
+
+        it.mode = Integration::FOLD;
+        it.dtype = Integration::SHORT;
+        it.tsubint = DataBuffer<T>::tsamp*nsamp_per_subint;
+        it.aux_dm = dm;
+
+        isubint = 0;
+        return;
+    }
+
     assert(nsamp_per_subint%databuffer.nsamples == 0);
 
 	int nbits = 8;
@@ -153,77 +195,17 @@ DataBuffer<T> * PsrfitsWriter<T>::run(DataBuffer<float> &databuffer)
 
         if (dtype == Integration::UINT8)
         {
-#ifndef __AVX2__
-            for (long int i=0; i<databuffer.nsamples; i++)
-            {
-                for (long int k=0; k<npol; k++)
-                {
-                    if (k<2)
-                    {
-                        for (long int j=0; j<nchans_real; j++)
-                        {
-							float tmp = std::round((databuffer.buffer[i*npol*nchans_real+k*nchans_real+j]-offs)*gain+128); 
-                            DataBuffer<T>::buffer[ichunk*databuffer.nsamples*npol*nchans_real+i*npol*nchans_real+k*nchans_real+j] = tmp>255? 255:tmp;
-                        }
-                    }
-                    else
-                    {
-                        for (long int j=0; j<nchans_real; j++)
-                        {
-							float tmp = std::round(databuffer.buffer[i*npol*nchans_real+k*nchans_real+j]*gain+128);
-                            DataBuffer<T>::buffer[ichunk*databuffer.nsamples*npol*nchans_real+i*npol*nchans_real+k*nchans_real+j] = tmp>255? 255:tmp;
-                        }
-                    }
-                }
-            }
-#else
-            assert(nchans_real%8 == 0);
-            __m256 avx_a;
-            __m256 avx_min = _mm256_setr_ps(0.,0.,0.,0.,0.,0.,0.,0.);
-            __m256 avx_max = _mm256_setr_ps(255.,255.,255.,255.,255.,255.,255.,255.);
-            __m256 avx_gain = _mm256_setr_ps(gain,gain,gain,gain,gain,gain,gain,gain);
-            __m256 avx_offs = _mm256_setr_ps(offs,offs,offs,offs,offs,offs,offs,offs);
-            __m256 avx_128 = _mm256_setr_ps(128,128,128,128,128,128,128,128);
-            float *temp = (float *)_mm_malloc(sizeof(float)*nchans_real, 32);
             for (long int i=0; i<databuffer.nsamples; i++)
             {
                 for (long int k=0; k<npol; k++)
                 {
                     unsigned char *pb = (unsigned char *)(&DataBuffer<T>::buffer[0])+ichunk*databuffer.nsamples*npol*nchans_real+i*npol*nchans_real+k*nchans_real;
-                    float *pbuffer = &(databuffer.buffer[0])+i*npol*nchans_real+k*nchans_real;
-                    if (k<2)
-                    {
-                        for (long int j=0; j<nchans_real/8; j++)
-                        {
-                            avx_a = _mm256_load_ps(pbuffer+j*8);
-                            avx_a = _mm256_sub_ps(avx_a, avx_offs);
-                            avx_a = _mm256_fmadd_ps(avx_a, avx_gain, avx_128);
-							avx_a = _mm256_round_ps(avx_a, 0);
-                            avx_a = _mm256_max_ps(avx_a, avx_min);
-                            avx_a = _mm256_min_ps(avx_a, avx_max);
-                            _mm256_store_ps(temp+j*8, avx_a);
-                        }
-                    }
-                    else
-                    {
-                        for (long int j=0; j<nchans_real/8; j++)
-                        {
-                            avx_a = _mm256_load_ps(pbuffer+j*8);
-                            avx_a = _mm256_fmadd_ps(avx_a, avx_gain, avx_128);
-							avx_a = _mm256_round_ps(avx_a, 0);
-                            avx_a = _mm256_max_ps(avx_a, avx_min);
-                            avx_a = _mm256_min_ps(avx_a, avx_max);
-                            _mm256_store_ps(temp+j*8, avx_a);
-                        }
-                    }
-                    for (long int j=0; j<nchans_real; j++)
-                    {
-                        pb[j] = temp[j];
-                    }
+                    const float *pbuffer = &(databuffer.buffer[0])+i*npol*nchans_real+k*nchans_real;
+                    /* (x-offs)*gain+128, without offset for the cross terms, rounded and clipped to 0..255 */
+                    float offs_k = k<2 ? 128.-offs*gain : 128.;
+                    PulsarX::simd_kernels().scale(pb, pbuffer, gain, offs_k, 8, nchans_real);
                 }
             }
-            _mm_free(temp);
-#endif
         }
 		else if (dtype == Integration::UINT4)
 		{
@@ -327,5 +309,21 @@ DataBuffer<T> * PsrfitsWriter<T>::run(DataBuffer<float> &databuffer)
     return this;
 }
 
+template <typename T>
+void PsrfitsWriter<T>::write_fold(float *profiles, double folding_period, double offs_sub)
+{
+    long int nchans_real = DataBuffer<T>::nchans/npol;
+
+    it.load_data(profiles, npol, nchans_real, nbin);
+    it.load_frequencies(&DataBuffer<T>::frequencies[0], nchans_real);
+
+    it.folding_period = folding_period;
+    it.offs_sub = offs_sub;
+
+    fits.subint.unload_integration(fits.fptr, it);
+
+    isubint++;
+}
+
 template class PsrfitsWriter<unsigned char>;
 template class PsrfitsWriter<float>;
@@ -0,0 +1,242 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 17:31:35
+ * @modify date 2026-10-19 17:31:35
+ * @desc [description]
+ */
+
+#include <cmath>
+#include <algorithm>
+
+#include "resample.h"
+#include "dedisperse.h"
+#include "constants.h"
+#include "utils.h"
+
+#include "simd.h"
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+using namespace Pulsar;
+
+Resampler::Resampler()
+{
+	epoch = -1.;
+	tobs = 0.;
+
+	nforward = 0;
+	nbackward = 0;
+	blockstart = -1;
+}
+
+Resampler::~Resampler()
+{
+}
+
+/**
+ * @brief line of sight delay of template t at ti seconds since start_mjd, an acceleration
+ * is measured from te, subtract get_delay(t, te, te) for an orbit
+ */
+double Resampler::get_delay(size_t t, double ti, double te)
+{
+	if (t < accs.size())
+		return accs[t] * (ti - te) * (ti - te) / (2. * CONST_C);
+	else
+		return orbits[t - accs.size()].get_roemer(start_mjd.to_day() + ti / 86400.);
+}
+
+/**
+ * @brief index maps of series of nsamples since start_mjd
+ */
+void Resampler::make_maps(std::vector<int> &map, size_t nsamples, double tsamp)
+{
+	size_t ntemplate = get_ntemplate();
+	map.resize(ntemplate * nsamples, 0);
+
+	double te = epoch >= 0. ? epoch : 0.5 * nsamples * tsamp;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+	for (size_t t=0; t<ntemplate; t++)
+	{
+		int *idx = map.data() + t * nsamples;
+
+		double R0 = get_delay(t, te, te);
+		for (size_t i=0; i<nsamples; i++)
+		{
+			long int j = i + std::lround((get_delay(t, i * tsamp, te) - R0) / tsamp);
+			idx[i] = std::min(std::max(j, 0L), (long int)nsamples - 1);
+		}
+	}
+}
+
+/**
+ * @brief bound the delays of the stream to get the samples to carry between blocks,
+ * an acceleration over [0, tobs] and an orbit over a full orbit
+ */
+void Resampler::prepare_stream(double tsamp)
+{
+	double te = epoch >= 0. ? epoch : 0.5 * tobs;
+
+	double dmin = 0., dmax = 0.;
+	for (size_t t=0; t<accs.size(); t++)
+	{
+		for (auto ti : {0., tobs, std::min(std::max(te, 0.), tobs)})
+		{
+			double d = get_delay(t, ti, te);
+			dmin = std::min(dmin, d);
+			dmax = std::max(dmax, d);
+		}
+	}
+	for (size_t k=0; k<orbits.size(); k++)
+	{
+		const Kepler &orbit = orbits[k];
+		double center = -orbit.a1 * orbit.ecc * std::sin(orbit.om);
+		double amplitude = orbit.a1 * std::sqrt(std::sin(orbit.om) * std::sin(orbit.om) + (1. - orbit.ecc * orbit.ecc) * std::cos(orbit.om) * std::cos(orbit.om));
+		double R0 = get_delay(accs.size() + k, te, te);
+		dmin = std::min(dmin, center - amplitude - R0);
+		dmax = std::max(dmax, center + amplitude - R0);
+	}
+
+	nforward = std::ceil(dmax / tsamp) + 1;
+	nbackward = std::ceil(-dmin / tsamp) + 1;
+
+	if (!accs.empty() && tobs <= 0.)
+		BOOST_LOG_TRIVIAL(warning)<<"length of the stream not set, the acceleration delays are clamped";
+
+	std::vector<std::pair<std::string, std::string>> meta = {
+			{"number of accelerations", std::to_string(accs.size())},
+			{"number of orbits", std::to_string(orbits.size())},
+			{"samples read ahead", std::to_string(nforward)},
+			{"samples read behind", std::to_string(nbackward)},
+			{"sampling time", std::to_string(tsamp)}
+		};
+	format_logging("Resampler Info", meta);
+}
+
+void Resampler::prepare(size_t nsamples, double tsamp)
+{
+	std::pair<size_t, double> key(nsamples, tsamp);
+	if (maps.find(key) != maps.end()) return;
+
+	make_maps(maps[key], nsamples, tsamp);
+
+	std::vector<std::pair<std::string, std::string>> meta = {
+			{"number of accelerations", std::to_string(accs.size())},
+			{"number of orbits", std::to_string(orbits.size())},
+			{"number of samples", std::to_string(nsamples)},
+			{"sampling time", std::to_string(tsamp)}
+		};
+	format_logging("Resampler Info", meta);
+}
+
+const std::vector<int> & Resampler::get_maps(size_t nsamples, double tsamp)
+{
+	prepare(nsamples, tsamp);
+	return maps[std::make_pair(nsamples, tsamp)];
+}
+
+void Resampler::run(float *out, size_t ldout, const float *data, size_t ld, size_t ndm, size_t nsamples, double tsamp)
+{
+	const std::vector<int> &map = get_maps(nsamples, tsamp);
+
+	size_t ntemplate = get_ntemplate();
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+	for (size_t m=0; m<ndm*ntemplate; m++)
+	{
+		size_t k = m / ntemplate;
+		size_t t = m % ntemplate;
+
+		const float *in = data + k * ld;
+		const int *idx = map.data() + t * nsamples;
+		float *o = out + m * ldout;
+
+		PulsarX::simd_kernels().gather(o, in, idx, nsamples);
+	}
+}
+
+void Resampler::run(DataBuffer<float> &out, DataBuffer<float> &databuffer, size_t t)
+{
+	long int nsamples = databuffer.nsamples;
+	long int nchans = databuffer.nchans;
+	double tsamp = databuffer.tsamp;
+
+	/* counter includes the block, a buffer counted less than one block is the start of the stream */
+	long int start = std::max(0L, databuffer.counter - nsamples);
+
+	if (start != blockstart)
+	{
+		if (start == 0 || blockstart < 0)
+		{
+			prepare_stream(tsamp);
+			/* the samples before the start of the stream */
+			history.assign((nbackward + nforward) * nchans, 0.);
+		}
+
+		/* keep the carried samples and append the block, row r of history is sample start - ncarry + r */
+		long int ncarry = nbackward + nforward;
+		std::copy(history.end() - ncarry * nchans, history.end(), history.begin());
+		history.resize((ncarry + nsamples) * nchans);
+		std::copy(databuffer.buffer.begin(), databuffer.buffer.begin() + nsamples * nchans, history.begin() + ncarry * nchans);
+
+		size_t ntemplate = get_ntemplate();
+		blockmap.resize(ntemplate * nsamples);
+
+		double te = epoch >= 0. ? epoch : 0.5 * tobs;
+		long int rowmin = std::max(0L, ncarry - start);
+		long int rowmax = ncarry + nsamples - 1;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+		for (size_t k=0; k<ntemplate; k++)
+		{
+			int *idx = blockmap.data() + k * nsamples;
+
+			double R0 = get_delay(k, te, te);
+			for (long int i=0; i<nsamples; i++)
+			{
+				long int n = start - nforward + i;
+				if (n < 0)
+				{
+					idx[i] = -1;
+					continue;
+				}
+
+				long int r = i + nbackward + std::lround((get_delay(k, n * tsamp, te) - R0) / tsamp);
+				idx[i] = std::min(std::max(r, rowmin), rowmax);
+			}
+		}
+
+		blockstart = start;
+	}
+
+	out.resize(nsamples, nchans);
+	out.tsamp = tsamp;
+	out.frequencies = databuffer.frequencies;
+	out.means = databuffer.means;
+	out.vars = databuffer.vars;
+	out.mean_var_ready = databuffer.mean_var_ready;
+
+	const int *idx = blockmap.data() + t * nsamples;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+	for (long int i=0; i<nsamples; i++)
+	{
+		if (idx[i] < 0)
+			std::fill(out.buffer.begin() + i * nchans, out.buffer.begin() + (i + 1) * nchans, 0.);
+		else
+			std::copy(history.begin() + (long int)idx[i] * nchans, history.begin() + ((long int)idx[i] + 1) * nchans, out.buffer.begin() + i * nchans);
+	}
+
+	out.counter += nsamples;
+}
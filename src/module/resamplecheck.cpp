@@ -0,0 +1,103 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 21:02:47
+ * @modify date 2026-10-19 21:02:47
+ * @desc [check that a stream resampled block by block is the concatenated series resampled at once, run by make check]
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "resample.h"
+
+using namespace std;
+using namespace Pulsar;
+
+/* defined by the applications, libxutils needs it */
+unsigned int num_threads = 1;
+
+static long int check(double epoch, long int nblock, long int nsamples)
+{
+	long int nchans = 3;
+	double tsamp = 1e-5;
+	long int ntotal = nblock * nsamples;
+
+	/* delays of tens of samples, both signs */
+	Resampler stream, whole;
+	for (auto r : {&stream, &whole})
+	{
+		r->accs = {-1e10, 3e9};
+		r->orbits.push_back(Kepler(100., 0.5 / 86400., 4e-4, 60000. + 0.1 / 86400., 0.7, 0.3));
+		r->orbits.push_back(Kepler(100., 0.3 / 86400., 2e-4, 60000., 2.1, 0.));
+		r->start_mjd = MJD(60000, 0, 0.);
+		r->epoch = epoch;
+		r->tobs = ntotal * tsamp;
+	}
+	size_t ntemplate = whole.get_ntemplate();
+
+	vector<float> series(nchans * ntotal);
+	for (auto &v : series) v = rand() / (RAND_MAX + 1.);
+
+	vector<float> out(nchans * ntemplate * ntotal);
+	whole.run(out.data(), ntotal, series.data(), ntotal, nchans, ntotal, tsamp);
+
+	long int nfail = 0;
+
+	DataBuffer<float> databuffer(nsamples, nchans);
+	databuffer.tsamp = tsamp;
+	vector<DataBuffer<float>> outs(ntemplate);
+	for (long int k=0; k<nblock; k++)
+	{
+		for (long int i=0; i<nsamples; i++)
+		{
+			for (long int j=0; j<nchans; j++)
+				databuffer.buffer[i * nchans + j] = series[j * ntotal + k * nsamples + i];
+		}
+		databuffer.counter += nsamples;
+
+		for (size_t t=0; t<ntemplate; t++)
+		{
+			stream.run(outs[t], databuffer, t);
+
+			for (long int i=0; i<nsamples; i++)
+			{
+				long int n = k * nsamples - stream.get_nlead() + i;
+				for (long int j=0; j<nchans; j++)
+				{
+					float expect = n < 0 ? 0. : out[(j * ntemplate + t) * ntotal + n];
+					if (outs[t].buffer[i * nchans + j] != expect)
+					{
+						if (nfail < 20)
+							cerr<<"epoch="<<epoch<<" nsamples="<<nsamples<<" template="<<t<<" sample="<<n<<" channel="<<j<<": "<<outs[t].buffer[i * nchans + j]<<" != "<<expect<<endl;
+						nfail++;
+					}
+				}
+			}
+		}
+	}
+
+	return nfail;
+}
+
+int main(int argc, char *argv[])
+{
+	srand(1);
+
+	long int nfail = 0;
+	for (double epoch : {-1., 0., 0.137})
+	{
+		nfail += check(epoch, 8, 4096);
+		/* blocks shorter than the carried samples */
+		nfail += check(epoch, 64, 37);
+	}
+
+	if (nfail)
+	{
+		cerr<<nfail<<" mismatches"<<endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -48,7 +48,7 @@ DataBuffer<float> * Rescale::filter(DataBuffer<float> &databuffer)
 	BOOST_LOG_TRIVIAL(debug)<<"perform rescale";
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<databuffer.nsamples; i++)
 	{
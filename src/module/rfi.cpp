@@ -7,15 +7,13 @@
 
 #include "string.h"
 
-#ifdef __AVX2__
-#include "avx2.h"
-#endif
+#include "simd.h"
 
 #include "rfi.h"
 #include "kdtree.h"
+#include "partitioner.h"
 #include "dedisperse.h"
 #include "logging.h"
-#include <random>
 
 using namespace std;
 
@@ -27,6 +25,11 @@ RFI::RFI()
 	threKadaneT = 7;
 	widthlimit = 10e-3;
 	bandlimitKT = 10;
+	threSK = 5;
+	skgate = false;
+	skflagged = -1;
+	nprerun = -1;
+	noise = NoiseFill(0, NoiseFill::salt("rfi", 0));
 }
 
 RFI::RFI(nlohmann::json &config)
@@ -37,6 +40,11 @@ RFI::RFI(nlohmann::json &config)
 	threKadaneT = config["threKadaneT"];
 	widthlimit = config["widthlimit"];
 	bandlimitKT = config["bandlimitKT"];
+	threSK = config.value("threSK", 5.);
+	skgate = config.value("skgate", false);
+	skflagged = -1;
+	noise = NoiseFill(config.value<uint64_t>("seed", 0), NoiseFill::salt("rfi", config.value<uint64_t>("ibeam", 0)));
+	nprerun = -1;
 
 	// parse zaplist
 	auto config_zaplist = config["zaplist"];
@@ -51,7 +59,7 @@ RFI::RFI(nlohmann::json &config)
 	{
 		for (auto item=r->begin(); item!=r->end(); ++item)
 		{
-			if ((*item)=="mask" or (*item)=="kadaneF" or (*item)=="kadaneT")
+			if ((*item)=="mask" or (*item)=="kadaneF" or (*item)=="kadaneT" or (*item)=="sk")
 			{
 				rfilist.push_back(std::vector<std::string>{*item, *(++item), *(++item)});
 			}
@@ -71,6 +79,11 @@ RFI::RFI(const RFI &rfi) : DataBuffer<float>(rfi)
 	threKadaneT = rfi.threKadaneT;
 	widthlimit = rfi.widthlimit;
 	bandlimitKT = rfi.bandlimitKT;
+	threSK = rfi.threSK;
+	skgate = rfi.skgate;
+	skflagged = rfi.skflagged;
+	noise = rfi.noise;
+	nprerun = rfi.nprerun;
 }
 
 RFI & RFI::operator=(const RFI &rfi)
@@ -83,6 +96,11 @@ RFI & RFI::operator=(const RFI &rfi)
 	threKadaneT = rfi.threKadaneT;
 	widthlimit = rfi.widthlimit;
 	bandlimitKT = rfi.bandlimitKT;
+	threSK = rfi.threSK;
+	skgate = rfi.skgate;
+	skflagged = rfi.skflagged;
+	noise = rfi.noise;
+	nprerun = rfi.nprerun;
 
 	return *this;  
 }
@@ -97,6 +115,10 @@ void RFI::read_config(nlohmann::json &config)
 	threKadaneT = config["threKadaneT"];
 	widthlimit = config["widthlimit"];
 	bandlimitKT = config["bandlimitKT"];
+	threSK = config.value("threSK", 5.);
+	skgate = config.value("skgate", false);
+	skflagged = -1;
+	noise = NoiseFill(config.value<uint64_t>("seed", 0), NoiseFill::salt("rfi", config.value<uint64_t>("ibeam", 0)));
 
 	// parse zaplist
 	auto config_zaplist = config["zaplist"];
@@ -111,7 +133,7 @@ void RFI::read_config(nlohmann::json &config)
 	{
 		for (auto item=r->begin(); item!=r->end(); ++item)
 		{
-			if ((*item)=="mask" or (*item)=="kadaneF" or (*item)=="kadaneT")
+			if ((*item)=="mask" or (*item)=="kadaneF" or (*item)=="kadaneT" or (*item)=="sk")
 			{
 				rfilist.push_back(std::vector<std::string>{*item, *(++item), *(++item)});
 			}
@@ -141,13 +163,71 @@ void RFI::prepare(DataBuffer<float> &databuffer)
 	weights.resize(nchans, 0.);
 }
 
+DataBuffer<float> * RFI::prerun(DataBuffer<float> &databuffer)
+{
+	DataBuffer<float> *data = zap(databuffer, zaplist);
+	if (isbusy) closable = false;
+
+	/* unknown until a sk step is run on this block */
+	skflagged = -1;
+
+	nprerun = 0;
+	while (nprerun < (long int)rfilist.size() and rfilist[nprerun][0] == "sk") nprerun++;
+
+	return run(*data, 0, nprerun);
+}
+
 DataBuffer<float> * RFI::run(DataBuffer<float> &databuffer)
 {
+	if (nprerun >= 0)
+	{
+		long int first = nprerun;
+		nprerun = -1;
+		return run(databuffer, first, rfilist.size());
+	}
+
 	DataBuffer<float> *data = zap(databuffer, zaplist);
 	if (isbusy) closable = false;
-	
-	for (auto irfi = rfilist.begin(); irfi!=rfilist.end(); ++irfi)
+
+	/* unknown until a sk step is run on this block */
+	skflagged = -1;
+
+	return run(*data, 0, rfilist.size());
+}
+
+DataBuffer<float> * RFI::run(DataBuffer<float> &databuffer, long int first, long int last)
+{
+	DataBuffer<float> *data = databuffer.get();
+
+	for (auto irfi = rfilist.begin()+first; irfi!=rfilist.begin()+last; ++irfi)
 	{
+		size_t step = irfi-rfilist.begin();
+		bool maskable = (*irfi)[0] == "mask" or (*irfi)[0] == "kadaneF" or (*irfi)[0] == "kadaneT" or (*irfi)[0] == "sk";
+
+		if (skgate and skflagged == 0 and ((*irfi)[0] == "kadaneF" or (*irfi)[0] == "kadaneT"))
+		{
+			BOOST_LOG_TRIVIAL(debug)<<"skip "<<(*irfi)[0]<<", no rfi found by sk";
+			continue;
+		}
+
+		if (maskable and maskstream.is_reading())
+		{
+			DataBuffer<float> *replayed = replay(*data, step);
+			if (replayed != nullptr)
+			{
+				data = replayed;
+				if (isbusy) closable = false;
+				continue;
+			}
+		}
+
+		uint64_t blockcounter = data->counter;
+		if (maskable and maskstream.is_writing())
+		{
+			maskcells.assign(nsamples*nchans, 0);
+			maskfill = 0.;
+		}
+
 		if ((*irfi)[0] == "mask")
 		{
 			data = mask(*data, thremask, stoi((*irfi)[1]), stoi((*irfi)[2]));
@@ -163,6 +243,11 @@ DataBuffer<float> * RFI::run(DataBuffer<float> &databuffer)
 			data = kadaneT(*data, threKadaneT*threKadaneT, bandlimitKT, stoi((*irfi)[1]), stoi((*irfi)[2]));
 			if (isbusy) closable = false;
 		}
+		else if ((*irfi)[0] == "sk")
+		{
+			data = sk(*data, threSK, stoi((*irfi)[1]), stoi((*irfi)[2]));
+			if (isbusy) closable = false;
+		}
 		else if ((*irfi)[0] == "zdot")
 		{
 			data = zdot(*data);
@@ -173,6 +258,12 @@ DataBuffer<float> * RFI::run(DataBuffer<float> &databuffer)
 			data = zero(*data);
 			if (isbusy) closable = false;
 		}
+
+		if (maskable and maskstream.is_writing())
+		{
+			maskstream.write(blockcounter, step, maskfill, maskcells, nsamples, nchans);
+			maskcells.clear();
+		}
 	}
 
 	return data;
@@ -187,12 +278,15 @@ DataBuffer<float> * RFI::zap(DataBuffer<float> &databuffer, const vector<pair<do
 
 	BOOST_LOG_TRIVIAL(debug)<<"zapping channels";
 
+	databuffer.chmask.resize(nchans, 0);
+
 	for (long int j=0; j<nchans; j++)
 	{
 		for (auto k=zaplist.begin(); k!=zaplist.end(); ++k)
 		{
 			if (frequencies[j]>=(*k).first and frequencies[j]<=(*k).second)
 			{
+				databuffer.chmask[j] = 1;
 				databuffer.weights[j] = 0.;
 				databuffer.means[j] = 0.;
 				databuffer.vars[j] = 0.;
@@ -201,7 +295,7 @@ DataBuffer<float> * RFI::zap(DataBuffer<float> &databuffer, const vector<pair<do
 	}
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<nsamples; i++)
 	{   
@@ -224,92 +318,71 @@ DataBuffer<float> * RFI::zdot(DataBuffer<float> &databuffer)
 {
 	BOOST_LOG_TRIVIAL(debug)<<"perform zero-dm matched filter";
 
-#ifndef __AVX2__
-	vector<double> xe(nchans, 0.);
-	vector<double> xs(nchans, 0.);
-	vector<double> alpha(nchans, 0.);
-	vector<double> beta(nchans, 0.);
-	vector<double> s(nsamples, 0.);
+	aligned_vector<double> xe(nchans, 0.);
+	aligned_vector<double> xs(nchans, 0.);
+	aligned_vector<float> alpha(nchans, 0.);
+	aligned_vector<float> beta(nchans, 0.);
+	aligned_vector<float> s(nsamples, 0.);
 	double se = 0.;
 	double ss = 0.;
 
-	for (long int i=0; i<nsamples; i++)
-	{
-		double temp = 0.;
-		for (long int j=0; j<nchans; j++)
-		{
-			temp += databuffer.buffer[i*nchans+j];
-		}
+	/* the sub-bands are processed concurrently, the zero-dm time series is the sum of their partial sums */
+	DataView<float> data = databuffer.view();
+	XLIBS::ChannelPartitioner partitioner;
+	partitioner.prepare(nchans);
 
-		for (long int j=0; j<nchans; j++)
+	std::vector<double> zdm;
+	partitioner.reduce(data, zdm, nsamples, [&](size_t k, const DataView<float> &sub, double *out)
+	{
+		for (long int i=0; i<sub.nsamples; i++)
 		{
-			xe[j] += databuffer.buffer[i*nchans+j];
+			if (PulsarX::simd_enabled())
+			{
+				out[i] = PulsarX::simd_kernels().reduce(sub.row(i), sub.nchans);
+			}
+			else
+			{
+				double temp = 0.;
+				for (long int j=0; j<sub.nchans; j++)
+				{
+					temp += sub(i, j);
+				}
+				out[i] = temp;
+			}
 		}
+	});
 
-		temp /= nchans;
+	for (long int i=0; i<nsamples; i++)
+	{
+		double temp = zdm[i] / nchans;
+		zdm[i] = temp;
 		se += temp;
 		ss += temp*temp;
-		
-		for (long int j=0; j<nchans; j++)
-		{
-			xs[j] += databuffer.buffer[i*nchans+j]*temp;
-		}
-
 		s[i] = temp;
 	}
-#else
-	vector<double, boost::alignment::aligned_allocator<double, 32>> xe(nchans, 0.);
-	vector<double, boost::alignment::aligned_allocator<double, 32>> xs(nchans, 0.);
-	vector<float, boost::alignment::aligned_allocator<float, 32>> alpha(nchans, 0.);
-	vector<float, boost::alignment::aligned_allocator<float, 32>> beta(nchans, 0.);
-	vector<float, boost::alignment::aligned_allocator<float, 32>> s(nsamples, 0.);
-	double se = 0.;
-	double ss = 0.;
 
-	if (nchans % 4 == 0)
+	/* each sub-band accumulates its own channels */
+	partitioner.map(data, [&](size_t k, const DataView<float> &sub)
 	{
-		for (long int i=0; i<nsamples; i++)
-		{
-			double temp = PulsarX::reduce(databuffer.buffer.data()+i*nchans, nchans);
-
-			temp /= nchans;
+		double *xek = xe.data() + partitioner.get_start(k);
+		double *xsk = xs.data() + partitioner.get_start(k);
 
-			PulsarX::accumulate_mean(xe.data(), xs.data(), temp, databuffer.buffer.data()+i*nchans, nchans);
-
-			se += temp;
-			ss += temp*temp;
-
-			s[i] = temp;
-		}
-	}
-	else
-	{
-		for (long int i=0; i<nsamples; i++)
+		for (long int i=0; i<sub.nsamples; i++)
 		{
-			double temp = 0.;
-			for (long int j=0; j<nchans; j++)
+			if (PulsarX::simd_enabled())
 			{
-				temp += databuffer.buffer[i*nchans+j];
+				PulsarX::simd_kernels().accumulate_mean(xek, xsk, zdm[i], sub.row(i), sub.nchans);
 			}
-
-			for (long int j=0; j<nchans; j++)
-			{
-				xe[j] += databuffer.buffer[i*nchans+j];
-			}
-
-			temp /= nchans;
-			se += temp;
-			ss += temp*temp;
-			
-			for (long int j=0; j<nchans; j++)
+			else
 			{
-				xs[j] += databuffer.buffer[i*nchans+j]*temp;
+				for (long int j=0; j<sub.nchans; j++)
+				{
+					xek[j] += sub(i, j);
+					xsk[j] += sub(i, j)*zdm[i];
+				}
 			}
-
-			s[i] = temp;
 		}
-	}
-#endif
+	});
 
 	double tmp = se*se-ss*nsamples;
 	if (tmp != 0)
@@ -321,34 +394,20 @@ DataBuffer<float> * RFI::zdot(DataBuffer<float> &databuffer)
 		}
 	}
 
-#ifndef __AVX2__
-
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
-#endif
-	for (long int i=0; i<nsamples; i++)
-	{
-		for (long int j=0; j<nchans; j++)
-		{
-			databuffer.buffer[i*nchans+j] = databuffer.buffer[i*nchans+j]-alpha[j]*s[i]-beta[j];
-		}
-	}
-
-#else
-	if (nchans % 8 == 0)
+	if (PulsarX::simd_enabled())
 	{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int i=0; i<nsamples; i++)
 		{
-			PulsarX::remove_baseline(databuffer.buffer.data()+i*nchans, databuffer.buffer.data()+i*nchans, alpha.data(), beta.data(), s[i], nchans);
+			PulsarX::simd_kernels().remove_baseline(databuffer.buffer.data()+i*nchans, databuffer.buffer.data()+i*nchans, alpha.data(), beta.data(), s[i], nchans);
 		}
 	}
 	else
 	{
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int i=0; i<nsamples; i++)
 		{
@@ -358,7 +417,6 @@ DataBuffer<float> * RFI::zdot(DataBuffer<float> &databuffer)
 			}
 		}
 	}
-#endif
 
 	std::fill(databuffer.means.begin(), databuffer.means.end(), 0.);
 
@@ -376,7 +434,7 @@ DataBuffer<float> * RFI::zero(DataBuffer<float> &databuffer)
 	if (closable) open();
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<nsamples; i++)
 	{
@@ -393,6 +451,7 @@ DataBuffer<float> * RFI::zero(DataBuffer<float> &databuffer)
 		}
 	}
 
+	chmask = databuffer.chmask;
 	mean_var_ready = false;
 
 	equalized = false;
@@ -409,8 +468,6 @@ DataBuffer<float> * RFI::zero(DataBuffer<float> &databuffer)
 
 DataBuffer<float> * RFI::mask(DataBuffer<float> &databuffer, float threRFI2, int td, int fd)
 {
-	if (closable) open();
-
 	long int nsamples_ds = nsamples/td;
 	long int nchans_ds = nchans/fd;
 
@@ -418,7 +475,7 @@ DataBuffer<float> * RFI::mask(DataBuffer<float> &databuffer, float threRFI2, int
 
 	//downsample
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<nsamples_ds; i++)
 	{
@@ -434,22 +491,23 @@ DataBuffer<float> * RFI::mask(DataBuffer<float> &databuffer, float threRFI2, int
 		}
 	}
 
-	buffer = databuffer.buffer;
+	take(databuffer);
 
-	vector<float> buffer_dscopy = buffer_ds;
-	std::nth_element(buffer_dscopy.begin(), buffer_dscopy.begin()+nsamples_ds*nchans_ds/4, buffer_dscopy.end(), std::less<float>());
-	float Q1 = buffer_dscopy[nsamples_ds*nchans_ds/4];
-	std::nth_element(buffer_dscopy.begin(), buffer_dscopy.begin()+nsamples_ds*nchans_ds/2, buffer_dscopy.end(), std::less<float>());
-	float Q2 = buffer_dscopy[nsamples_ds*nchans_ds/2];
-	std::nth_element(buffer_dscopy.begin(), buffer_dscopy.begin()+nsamples_ds*nchans_ds/4, buffer_dscopy.end(), std::greater<float>());
-	float Q3 = buffer_dscopy[nsamples_ds*nchans_ds/4];
+	size_t size_ds = nsamples_ds*nchans_ds;
+	std::vector<float> quartiles;
+	parallel_nth_element(quartiles, buffer_ds.data(), size_ds, {size_ds/4, size_ds/2, size_ds-1-size_ds/4});
+	float Q1 = quartiles[0];
+	float Q2 = quartiles[1];
+	float Q3 = quartiles[2];
 
 	float mean = Q2;
 	float var = ((Q3-Q1)/1.349)*((Q3-Q1)/1.349);
 	float thre = threRFI2*var;
 
+	maskfill = mean;
+
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<nsamples_ds; i++)
 	{
@@ -460,7 +518,10 @@ DataBuffer<float> * RFI::mask(DataBuffer<float> &databuffer, float threRFI2, int
 				for (long int k=0; k<fd; k++)
 				{
 					if ((buffer_ds[i*nchans_ds+j]-mean)*(buffer_ds[i*nchans_ds+j]-mean)>thre)
+					{
 						buffer[(i*td+n)*nchans+j*fd+k] = mean;
+						mark(i*td+n, i*td+n+1, j*fd+k, j*fd+k+1);
+					}
 				}
 			}
 		}
@@ -469,6 +530,7 @@ DataBuffer<float> * RFI::mask(DataBuffer<float> &databuffer, float threRFI2, int
 	means = databuffer.means;
 	vars = databuffer.vars;
 	weights = databuffer.weights;
+	chmask = databuffer.chmask;
 	mean_var_ready = databuffer.mean_var_ready;
 
 	equalized = databuffer.equalized;
@@ -485,200 +547,7 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 {
 	equalize.filter(databuffer);
 
-#ifndef __AVX2__
-	if (!databuffer.equalized)
-	{
-		BOOST_LOG_TRIVIAL(warning)<<"Warning: data is not equalize, kadaneF filter will not be performed"<<endl;
-		return databuffer.get();
-	}
-
-	BOOST_LOG_TRIVIAL(debug)<<"perform kadane filter";
-
-	if (closable) open();
-
-	vector<float> bufferT(nchans*nsamples, 0.);
-
-	transpose_pad<float>(&bufferT[0], &databuffer.buffer[0], nsamples, nchans);
-
-	long int nsamples_ds = nsamples/td;
-	long int nchans_ds = nchans/fd;
-
-	vector<float> bufferT_ds(nchans_ds*nsamples_ds, 0.);
-
-	//downsample
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
-#endif
-	for (long int j=0; j<nchans_ds; j++)
-	{
-		for (long int k=0; k<fd; k++)
-		{
-			for (long int n=0; n<td; n++)
-			{
-				for (long int i=0; i<nsamples_ds; i++)       
-				{
-					bufferT_ds[j*nsamples_ds+i] += bufferT[(j*fd+k)*nsamples+(i*td+n)];
-				}
-			}
-		}
-	}
-
-#ifdef _OPENMP
-	float *chdata_t = new float [num_threads*nsamples_ds];
-	memset(chdata_t, 0, sizeof(float)*num_threads*nsamples_ds);
-
-	std::vector<std::random_device> r(num_threads);
-	std::vector<std::mt19937> generators;
-	for (long int k=0; k<num_threads; k++) generators.emplace_back(std::mt19937(r[k]()));
-	std::vector<std::normal_distribution<float>> distributions(num_threads, std::normal_distribution<float>(0., 1.));
-#else
-	float *chdata_t = new float [nsamples_ds];
-	memset(chdata_t, 0, sizeof(float)*nsamples_ds);
-
-	std::random_device r;
-	std::mt19937 generator(r());
-	std::normal_distribution<float> distribution(0., 1.);
-#endif
-
-	int wnlimit = widthlimit/tsamp/td;
-
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
-#endif
-	for (long int j=0; j<nchans_ds; j++)
-	{
-#ifdef _OPENMP
-		int thread_id = omp_get_thread_num();
-		float *chdata = chdata_t+thread_id*nsamples_ds;
-#else
-		float *chdata = chdata_t;
-#endif
-
-		for (long int i=0; i<nsamples_ds; i++)
-		{
-			chdata[i] = bufferT_ds[j*nsamples_ds+i];
-		}
-
-		long int start, end;
-		float snr2=0.;
-		float boxsum = kadane<float>(chdata, nsamples_ds, &start, &end);
-		long int wn = end-start+1;
-
-		float mean = 0.;
-		float var = td*fd;    
-		if (wn > wnlimit)
-		{
-			snr2 = boxsum*boxsum/(wn*var);
-		}
-		else
-		{
-			snr2 = 0.;
-		}
-
-		start *= td;
-		end += 1;
-		end *= td;
-		if (snr2 > threRFI2)
-		{
-			if (filltype == "mean")
-			{
-				for (long int k=0; k<fd; k++)
-				{
-					for (long int i=start; i<end; i++)
-					{
-						bufferT[(j*fd+k)*nsamples+i] = 0.;
-					}
-				}
-			}
-			else
-			{
-				for (long int k=0; k<fd; k++)
-				{
-					for (long int i=start; i<end; i++)
-					{
-#ifdef _OPENMP
-						bufferT[(j*fd+k)*nsamples+i] = distributions[thread_id](generators[thread_id]);
-#else
-						bufferT[(j*fd+k)*nsamples+i] = distribution(generator);
-#endif
-					}
-				}
-			}
-		}
-
-		//<0
-		for (long int i=0; i<nsamples_ds; i++)
-		{
-			chdata[i] = -chdata[i];
-		}
-
-		snr2=0.;
-		boxsum = kadane<float>(chdata, nsamples_ds, &start, &end);
-		wn = end-start+1;
-
-		if (wn > wnlimit)
-		{
-			snr2 = boxsum*boxsum/(wn*var);
-		}
-		else
-		{
-			snr2 = 0.;
-		}
-
-		start *= td;
-		end += 1;
-		end *= td;
-		if (snr2 > threRFI2)
-		{
-			if (filltype == "mean")
-			{
-				for (long int k=0; k<fd; k++)
-				{
-					for (long int i=start; i<end; i++)
-					{
-						bufferT[(j*fd+k)*nsamples+i] = 0.;
-					}
-				}
-			}
-			else
-			{
-				for (long int k=0; k<fd; k++)
-				{
-					for (long int i=start; i<end; i++)
-					{
-#ifdef _OPENMP
-						bufferT[(j*fd+k)*nsamples+i] = distributions[thread_id](generators[thread_id]);
-#else
-						bufferT[(j*fd+k)*nsamples+i] = distribution(generator);
-#endif
-					}
-				}
-			}
-		}
-		
-	}
-
-	transpose_pad<float>(&buffer[0], &bufferT[0], nchans, nsamples);
-
-	means = databuffer.means;
-	vars = databuffer.vars;
-	weights = databuffer.weights;
-	mean_var_ready = databuffer.mean_var_ready;
-
-	equalized = databuffer.equalized;
-
-	databuffer.isbusy = false;
-	isbusy = true;
-
-	if (databuffer.closable) databuffer.close();
-
-	delete [] chdata_t;
-
-	BOOST_LOG_TRIVIAL(debug)<<"finished";
-
-	return this;
-#else
-	if (nchans % 8 == 0 && (nchans/fd) % 8 == 0)
+	if (PulsarX::simd_enabled())
 	{
 		if (!databuffer.equalized)
 		{
@@ -693,10 +562,10 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 		long int nsamples_ds = nsamples/td;
 		long int nchans_ds = nchans/fd;
 
-		std::vector<float, boost::alignment::aligned_allocator<float, 32>> buffer_ds(nchans_ds*nsamples_ds, 0.);
+		aligned_vector<float> buffer_ds(nchans_ds*nsamples_ds, 0.);
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int i=0; i<nsamples_ds; i++)
 		{
@@ -712,11 +581,11 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 			}
 		}
 
-		std::vector<float, boost::alignment::aligned_allocator<float, 32>> boxsum(nchans_ds, 0.), snr2(nchans_ds, 0.);
-		std::vector<int, boost::alignment::aligned_allocator<int, 32>> start(nchans_ds, 0), end(nchans_ds, 0);
-		std::vector<int, boost::alignment::aligned_allocator<int, 32>> wn(nchans_ds, 0);
+		aligned_vector<float> boxsum(nchans_ds, 0.), snr2(nchans_ds, 0.);
+		aligned_vector<int> start(nchans_ds, 0), end(nchans_ds, 0);
+		aligned_vector<int> wn(nchans_ds, 0);
 
-		PulsarX::kadane2D(boxsum.data(), start.data(), end.data(), buffer_ds.data(), nsamples_ds, nchans_ds);
+		PulsarX::simd_kernels().kadane2D(boxsum.data(), start.data(), end.data(), buffer_ds.data(), nsamples_ds, nchans_ds);
 
 		for (long int j=0; j<nchans_ds; j++)
 		{
@@ -739,20 +608,22 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 			end[j] *= td;
 		}
 
-		std::random_device r;
-		std::mt19937 generator(r());
-		std::normal_distribution<float> distribution(0., 1.);
-
 		for (long int j=0; j<nchans; j++)
 		{
 			if (snr2[j/fd] > threRFI2)
 			{
-				for (long int i=start[j/fd]; i<end[j/fd]; i++)
+				mark(start[j/fd], end[j/fd], j, j+1);
+
+				if (filltype == "mean")
 				{
-					if (filltype == "mean")
+					for (long int i=start[j/fd]; i<end[j/fd]; i++)
+					{
 						databuffer.buffer[i*nchans+j] = 0.;
-					else
-						databuffer.buffer[i*nchans+j] = distribution(generator);
+					}
+				}
+				else
+				{
+					noise.fill_strided(databuffer.buffer.data()+start[j/fd]*nchans+j, end[j/fd]-start[j/fd], nchans, databuffer.counter, j, start[j/fd]);
 				}
 			}
 		}
@@ -766,7 +637,7 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 			}
 		}
 
-		PulsarX::kadane2D(boxsum.data(), start.data(), end.data(), buffer_ds.data(), nsamples_ds, nchans_ds);
+		PulsarX::simd_kernels().kadane2D(boxsum.data(), start.data(), end.data(), buffer_ds.data(), nsamples_ds, nchans_ds);
 
 		for (long int j=0; j<nchans_ds; j++)
 		{
@@ -793,12 +664,18 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 		{
 			if (snr2[j/fd] > threRFI2)
 			{
-				for (long int i=start[j/fd]; i<end[j/fd]; i++)
+				mark(start[j/fd], end[j/fd], j, j+1);
+
+				if (filltype == "mean")
 				{
-					if (filltype == "mean")
+					for (long int i=start[j/fd]; i<end[j/fd]; i++)
+					{
 						databuffer.buffer[i*nchans+j] = 0.;
-					else
-						databuffer.buffer[i*nchans+j] = distribution(generator);
+					}
+				}
+				else
+				{
+					noise.fill_strided(databuffer.buffer.data()+start[j/fd]*nchans+j, end[j/fd]-start[j/fd], nchans, databuffer.counter, j, start[j/fd]);
 				}
 			}
 		}
@@ -834,7 +711,7 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 
 		//downsample
 	#ifdef _OPENMP
-	#pragma omp parallel for num_threads(num_threads)
+	#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 	#endif
 		for (long int j=0; j<nchans_ds; j++)
 		{
@@ -850,27 +727,20 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 			}
 		}
 
-	#ifdef _OPENMP
-		float *chdata_t = new float [num_threads*nsamples_ds];
-		memset(chdata_t, 0, sizeof(float)*num_threads*nsamples_ds);
+		unsigned int nthreads = XLIBS::get_num_threads();
 
-		std::vector<std::random_device> r(num_threads);
-		std::vector<std::mt19937> generators;
-		for (long int k=0; k<num_threads; k++) generators.emplace_back(std::mt19937(r[k]()));
-		std::vector<std::normal_distribution<float>> distributions(num_threads, std::normal_distribution<float>(0., 1.));
+	#ifdef _OPENMP
+		float *chdata_t = new float [nthreads*nsamples_ds];
+		memset(chdata_t, 0, sizeof(float)*nthreads*nsamples_ds);
 	#else
 		float *chdata_t = new float [nsamples_ds];
 		memset(chdata_t, 0, sizeof(float)*nsamples_ds);
-
-		std::random_device r;
-		std::mt19937 generator(r());
-		std::normal_distribution<float> distribution(0., 1.);
 	#endif
 
 		int wnlimit = widthlimit/tsamp/td;
 
 	#ifdef _OPENMP
-	#pragma omp parallel for num_threads(num_threads)
+	#pragma omp parallel for num_threads(nthreads)
 	#endif
 		for (long int j=0; j<nchans_ds; j++)
 		{
@@ -907,6 +777,8 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 			end *= td;
 			if (snr2 > threRFI2)
 			{
+				mark(start, end, j*fd, (j+1)*fd);
+
 				if (filltype == "mean")
 				{
 					for (long int k=0; k<fd; k++)
@@ -921,14 +793,7 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 				{
 					for (long int k=0; k<fd; k++)
 					{
-						for (long int i=start; i<end; i++)
-						{
-	#ifdef _OPENMP
-							bufferT[(j*fd+k)*nsamples+i] = distributions[thread_id](generators[thread_id]);
-	#else
-							bufferT[(j*fd+k)*nsamples+i] = distribution(generator);
-	#endif
-						}
+						noise.fill(&bufferT[(j*fd+k)*nsamples+start], end-start, databuffer.counter, j*fd+k, start);
 					}
 				}
 			}
@@ -957,6 +822,8 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 			end *= td;
 			if (snr2 > threRFI2)
 			{
+				mark(start, end, j*fd, (j+1)*fd);
+
 				if (filltype == "mean")
 				{
 					for (long int k=0; k<fd; k++)
@@ -971,14 +838,7 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 				{
 					for (long int k=0; k<fd; k++)
 					{
-						for (long int i=start; i<end; i++)
-						{
-	#ifdef _OPENMP
-							bufferT[(j*fd+k)*nsamples+i] = distributions[thread_id](generators[thread_id]);
-	#else
-							bufferT[(j*fd+k)*nsamples+i] = distribution(generator);
-	#endif
-						}
+						noise.fill(&bufferT[(j*fd+k)*nsamples+start], end-start, databuffer.counter, j*fd+k, start);
 					}
 				}
 			}
@@ -990,6 +850,7 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 		means = databuffer.means;
 		vars = databuffer.vars;
 		weights = databuffer.weights;
+	chmask = databuffer.chmask;
 		mean_var_ready = databuffer.mean_var_ready;
 
 		equalized = databuffer.equalized;
@@ -1005,7 +866,6 @@ DataBuffer<float> * RFI::kadaneF(DataBuffer<float> &databuffer, float threRFI2,
 
 		return this;		
 	}
-#endif
 }
 
 DataBuffer<float> * RFI::kadaneT(DataBuffer<float> &databuffer, float threRFI2, double bandlimit, int td, int fd)
@@ -1016,16 +876,22 @@ DataBuffer<float> * RFI::kadaneT(DataBuffer<float> &databuffer, float threRFI2,
 		return databuffer.get();
 	}
 
-	if (closable) open();
-
 	long int nsamples_ds = nsamples/td;
 	long int nchans_ds = nchans/fd;
 
-	vector<float> buffer_ds(nsamples_ds*nchans_ds, 0.);
+	int chnlimit = abs(bandlimit/(frequencies[1]-frequencies[0])/fd);
+
+	// transposed, lanes are samples
+	long int nsamples_ds_pad = (nsamples_ds+7)/8*8;
+
+	std::vector<float, boost::alignment::aligned_allocator<float, 32>> bufferT_ds(nchans_ds*nsamples_ds_pad, 0.);
+	std::vector<float, boost::alignment::aligned_allocator<float, 32>> boxsum_p(nsamples_ds_pad, 0.), boxsum_n(nsamples_ds_pad, 0.);
+	std::vector<int, boost::alignment::aligned_allocator<int, 32>> start_p(nsamples_ds_pad, 0), end_p(nsamples_ds_pad, 0);
+	std::vector<int, boost::alignment::aligned_allocator<int, 32>> start_n(nsamples_ds_pad, 0), end_n(nsamples_ds_pad, 0);
 
 	//downsample
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<nsamples_ds; i++)
 	{
@@ -1035,131 +901,347 @@ DataBuffer<float> * RFI::kadaneT(DataBuffer<float> &databuffer, float threRFI2,
 			{
 				for (long int j=0; j<nchans_ds; j++)
 				{
-					buffer_ds[i*nchans_ds+j] += databuffer.buffer[(i*td+n)*nchans+j*fd+k];
+					bufferT_ds[j*nsamples_ds_pad+i] += databuffer.buffer[(i*td+n)*nchans+j*fd+k];
 				}
 			}
 		}
 	}
 
-	buffer = databuffer.buffer;
-
 #ifdef _OPENMP
-	float *tsdata_t = new float [num_threads*nchans_ds];
-	memset(tsdata_t, 0, sizeof(float)*num_threads*nchans_ds);
-#else
-	float *tsdata_t = new float [nchans_ds];
-	memset(tsdata_t, 0, sizeof(float)*nchans_ds);
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
+	for (long int i=0; i<nsamples_ds_pad; i+=8)
+	{
+		PulsarX::simd_kernels().kadane2D_pn(boxsum_p.data()+i, start_p.data()+i, end_p.data()+i, boxsum_n.data()+i, start_n.data()+i, end_n.data()+i, bufferT_ds.data()+i, nchans_ds, 8, nsamples_ds_pad);
+	}
 
-	int chnlimit = abs(bandlimit/(frequencies[1]-frequencies[0])/fd);
+	take(databuffer);
+
+	float var = td*fd;
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (long int i=0; i<nsamples_ds; i++)
+	{
+		for (long int s=0; s<2; s++)
+		{
+			float boxsum = s==0 ? boxsum_p[i] : boxsum_n[i];
+			long int start = s==0 ? start_p[i] : start_n[i];
+			long int end = s==0 ? end_p[i] : end_n[i];
+
+			long int chn = end-start+1;
+
+			float snr2 = 0.;
+			if (chn > chnlimit)
+			{
+				snr2 = boxsum*boxsum/(chn*var);
+			}
+
+			start *= fd;
+			end += 1;
+			end *= fd;
+			if (chn > nchans_ds*0.8)
+			{
+				start = 0;
+				end = nchans-1;
+			}
+
+			if (snr2 > threRFI2)
+			{
+				mark(i*td, (i+1)*td, start, end);
+
+				for (long int k=0; k<td; k++)
+				{
+					for (long int j=start; j<end; j++)
+					{
+						buffer[(i*td+k)*nchans+j] = 0.;
+					}
+				}
+			}
+		}
+	}
+
+	means = databuffer.means;
+	vars = databuffer.vars;
+	weights = databuffer.weights;
+	chmask = databuffer.chmask;
+	mean_var_ready = databuffer.mean_var_ready;
+
+	equalized = databuffer.equalized;
+
+	databuffer.isbusy = false;
+	isbusy = true;
+
+	if (databuffer.closable) databuffer.close();
+
+	return this;
+}
+
+DataBuffer<float> * RFI::sk(DataBuffer<float> &databuffer, float threRFI, int td, int fd)
+{
+	if (databuffer.equalized)
+	{
+		BOOST_LOG_TRIVIAL(warning)<<"Warning: data is equalized, sk filter will not be performed"<<endl;
+		return databuffer.get();
+	}
+
+	BOOST_LOG_TRIVIAL(debug)<<"perform spectral kurtosis filter";
+
+	long int nwins = nsamples/td;
+	long int nchans_ds = nchans/fd;
+
+	/* S1 and S2 of each window and channel group */
+	aligned_vector<double> s1(nwins*nchans_ds, 0.), s2(nwins*nchans_ds, 0.);
+	unsigned int nthreads = XLIBS::get_num_threads();
+	aligned_vector<float> chdata_t(nthreads*nchans_ds, 0.);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads)
+#endif
+	for (long int w=0; w<nwins; w++)
 	{
 #ifdef _OPENMP
-		float *tsdata = tsdata_t+omp_get_thread_num()*nchans_ds;
+		float *chdata = chdata_t.data()+omp_get_thread_num()*nchans_ds;
 #else
-		float *tsdata = tsdata_t;
+		float *chdata = chdata_t.data();
 #endif
+		double *ps1 = s1.data()+w*nchans_ds;
+		double *ps2 = s2.data()+w*nchans_ds;
 
-		for (long int j=0; j<nchans_ds; j++)
+		for (long int i=w*td; i<(w+1)*td; i++)
 		{
-			tsdata[j] = buffer_ds[i*nchans_ds+j];
-		}
-
-		long int start, end;
-		float snr2=0.;
-		float boxsum = kadane<float>(tsdata, nchans_ds, &start, &end);
-		long int chn = end-start+1;
+			float *row = databuffer.buffer.data()+i*nchans;
+			if (fd != 1)
+			{
+				for (long int j=0; j<nchans_ds; j++)
+				{
+					float tmp = 0.;
+					for (long int k=0; k<fd; k++)
+					{
+						tmp += row[j*fd+k];
+					}
+					chdata[j] = tmp;
+				}
+				row = chdata;
+			}
 
-		float mean = 0.;
-		float var = td*fd;    
+			if (PulsarX::simd_enabled())
+			{
+				PulsarX::simd_kernels().accumulate_mean_var(ps1, ps2, row, nchans_ds);
+				continue;
+			}
+			for (long int j=0; j<nchans_ds; j++)
+			{
+				ps1[j] += row[j];
+				ps2[j] += row[j]*row[j];
+			}
+		}
+	}
 
-		if (chn > chnlimit)
+	/* SK = (M*N*d+1)/(M-1)*(M*S2/S1^2-1), N*d is unknown for the scaled power, so the deviation is measured
+	 * from the quartiles of M*S2/S1^2-1 over the block */
+	long int M = td;
+	std::vector<float> sk(nwins*nchans_ds, 0.);
+	std::vector<float> skvalid;
+	skvalid.reserve(nwins*nchans_ds);
+	for (long int k=0; k<nwins*nchans_ds; k++)
+	{
+		if (s1[k] > 0.)
 		{
-			snr2 = boxsum*boxsum/(chn*var);
+			sk[k] = M*s2[k]/(s1[k]*s1[k])-1.;
+			skvalid.push_back(sk[k]);
 		}
 		else
 		{
-			snr2 = 0.;
+			sk[k] = std::numeric_limits<float>::quiet_NaN();
 		}
+	}
 
-		start *= fd;
-		end += 1;
-		end *= fd;
-		if (chn > nchans_ds*0.8)
-		{
-			start = 0;
-			end = nchans-1;
-		}
+	skflagged = 0;
+
+	if (skvalid.size() >= 4)
+	{
+		size_t size = skvalid.size();
+		std::vector<float> quartiles;
+		parallel_nth_element(quartiles, skvalid.data(), size, {size/4, size/2, size-1-size/4});
+		float Q1 = quartiles[0];
+		float Q2 = quartiles[1];
+		float Q3 = quartiles[2];
+
+		float thre = threRFI*(Q3-Q1)/1.349;
+
+		BOOST_LOG_TRIVIAL(debug)<<"sk median "<<Q2<<", effective N*d "<<(Q2 > 0. ? 1./Q2 : 0.);
+
+		long int nflag = 0;
 
-		if (snr2 > threRFI2)
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads()) reduction(+:nflag)
+#endif
+		for (long int w=0; w<nwins; w++)
 		{
-			for (long int k=0; k<td; k++)
+			for (long int j=0; j<nchans_ds; j++)
 			{
-				for (long int j=start; j<end; j++)
+				float dev = sk[w*nchans_ds+j]-Q2;
+				if (!(std::abs(dev) > thre)) continue;
+
+				nflag++;
+
+				float fill = s1[w*nchans_ds+j]/(M*fd);
+				for (long int i=w*td; i<(w+1)*td; i++)
 				{
-					buffer[(i*td+k)*nchans+j] = 0.;
+					for (long int k=0; k<fd; k++)
+					{
+						databuffer.buffer[i*nchans+j*fd+k] = fill;
+					}
 				}
+				mark(w*td, (w+1)*td, j*fd, (j+1)*fd);
 			}
 		}
 
-		//<0
-		for (long int j=0; j<nchans_ds; j++)
-		{
-			tsdata[j] = -tsdata[j];
-		}
+		skflagged = nflag;
+	}
+
+	databuffer.isbusy = true;
+
+	BOOST_LOG_TRIVIAL(debug)<<"finished"<<"("<<"flagged = "<<skflagged<<")";
+
+	return databuffer.get();
+}
+
+DataBuffer<float> * RFI::replay(DataBuffer<float> &databuffer, size_t step)
+{
+	uint64_t rcounter;
+	uint32_t rstep;
+	float fill;
+	size_t rnsamples, rnchans;
+
+	if (!maskstream.read(rcounter, rstep, fill, maskcells, rnsamples, rnchans) or rstep != step or rcounter != (uint64_t)databuffer.counter or rnsamples != (size_t)nsamples or rnchans != (size_t)nchans)
+	{
+		BOOST_LOG_TRIVIAL(warning)<<"Warning: rfi mask stream does not match the data, stop replaying "<<maskstream.filename;
+		maskstream.close();
+		maskcells.clear();
+		return nullptr;
+	}
+
+	/* the kadane steps only fill equalized data, as in kadaneF and kadaneT */
+	if (rfilist[step][0] == "kadaneF") equalize.filter(databuffer);
+	if ((rfilist[step][0] == "kadaneF" or rfilist[step][0] == "kadaneT") and !databuffer.equalized)
+	{
+		BOOST_LOG_TRIVIAL(warning)<<"Warning: data is not equalize, "<<rfilist[step][0]<<" mask will not be replayed"<<endl;
+		maskcells.clear();
+		return databuffer.get();
+	}
+
+	BOOST_LOG_TRIVIAL(debug)<<"replay rfi mask of step "<<step<<" ("<<rfilist[step][0]<<")";
+
+	/* the output goes where the computed step puts it, so that the next steps see the same buffer and counter */
+	bool copied = rfilist[step][0] == "mask" or rfilist[step][0] == "kadaneT" or (rfilist[step][0] == "kadaneF" and !PulsarX::simd_enabled());
+	DataBuffer<float> *out = databuffer.get();
+	if (copied)
+	{
+		take(databuffer);
+		out = this;
+	}
+
+	if (rfilist[step][0] == "sk")
+	{
+		skflagged = std::count(maskcells.begin(), maskcells.end(), 1);
 
-		snr2=0.;
-		boxsum = kadane<float>(tsdata, nchans_ds, &start, &end);
-		chn = end-start+1;
+		int td = stoi(rfilist[step][1]);
+		int fd = stoi(rfilist[step][2]);
+		long int nwins = nsamples/td;
+		long int nchans_ds = nchans/fd;
 
-		if (chn > chnlimit)
+		/* the fill value is the window mean, which is recomputed */
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+		for (long int w=0; w<nwins; w++)
 		{
-			snr2 = boxsum*boxsum/(chn*var);
+			for (long int j=0; j<nchans_ds; j++)
+			{
+				if (!maskcells[w*td*nchans+j*fd]) continue;
+
+				double tmp = 0.;
+				for (long int i=w*td; i<(w+1)*td; i++)
+				{
+					for (long int k=0; k<fd; k++)
+					{
+						tmp += out->buffer[i*nchans+j*fd+k];
+					}
+				}
+
+				float fill = tmp/(td*fd);
+				for (long int i=w*td; i<(w+1)*td; i++)
+				{
+					for (long int k=0; k<fd; k++)
+					{
+						out->buffer[i*nchans+j*fd+k] = fill;
+					}
+				}
+			}
 		}
-		else
+	}
+	else if (rfilist[step][0] == "kadaneF" and filltype != "mean")
+	{
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+		for (long int j=0; j<nchans; j++)
 		{
-			snr2 = 0.;
-		}
+			long int i = 0;
+			while (i < nsamples)
+			{
+				if (!maskcells[i*nchans+j]) {i++; continue;}
 
-		start *= fd;
-		end += 1;
-		end *= fd;
-		
-		if (chn > nchans_ds*0.8)
-		{
-			start = 0;
-			end = nchans-1;
-		}
+				long int start = i;
+				while (i < nsamples and maskcells[i*nchans+j]) i++;
 
-		if (snr2 > threRFI2)
+				noise.fill_strided(out->buffer.data()+start*nchans+j, i-start, nchans, databuffer.counter, j, start);
+			}
+		}
+	}
+	else
+	{
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+		for (long int i=0; i<nsamples; i++)
 		{
-			for (long int k=0; k<td; k++)
+			for (long int j=0; j<nchans; j++)
 			{
-				for (long int j=start; j<end; j++)
-				{
-					buffer[(i*td+k)*nchans+j] = 0.;
-				}
+				if (maskcells[i*nchans+j])
+					out->buffer[i*nchans+j] = fill;
 			}
 		}
 	}
 
-	means = databuffer.means;
-	vars = databuffer.vars;
-	weights = databuffer.weights;
-	mean_var_ready = databuffer.mean_var_ready;
+	maskcells.clear();
 
-	equalized = databuffer.equalized;
+	if (copied)
+	{
+		means = databuffer.means;
+		vars = databuffer.vars;
+		weights = databuffer.weights;
+		chmask = databuffer.chmask;
+		mean_var_ready = databuffer.mean_var_ready;
 
-	databuffer.isbusy = false;
-	isbusy = true;
+		equalized = databuffer.equalized;
 
-	if (databuffer.closable) databuffer.close();
+		databuffer.isbusy = false;
+		isbusy = true;
 
-	delete [] tsdata_t;
+		if (databuffer.closable) databuffer.close();
 
-	return this;
+		BOOST_LOG_TRIVIAL(debug)<<"finished";
+
+		return this;
+	}
+
+	databuffer.isbusy = true;
+
+	BOOST_LOG_TRIVIAL(debug)<<"finished";
+
+	return databuffer.get();
 }
@@ -0,0 +1,228 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 15:41:40
+ * @modify date 2026-10-19 15:41:40
+ * @desc [description]
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "singlepulse.h"
+#include "dedisperse.h"
+#include "utils.h"
+
+#include "simd.h"
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+using namespace Pulsar;
+
+/* samples used for the statistics of a row */
+#define SINGLEPULSE_NSTAT 4096
+
+SinglePulseSearch::SinglePulseSearch()
+{
+	threshold = 7.;
+	maxwidth = 256;
+	width_step = 1.5;
+	alpha = 0.5;
+
+	counter = 0;
+
+	ndm = 0;
+	ndump = 0;
+	tsamp = 0.;
+	ntail = 0;
+	nthreads = 1;
+	stats_ready = false;
+}
+
+SinglePulseSearch::~SinglePulseSearch()
+{
+}
+
+void SinglePulseSearch::prepare(size_t n, size_t nd, double ts)
+{
+	ndm = n;
+	ndump = nd;
+	tsamp = ts;
+
+	widths.clear();
+	double w = 1.;
+	while (std::round(w) <= maxwidth)
+	{
+		if (widths.empty() || std::round(w) > widths.back())
+			widths.push_back(std::round(w));
+		w *= width_step;
+	}
+
+	ntail = maxwidth - 1;
+
+	medians.resize(ndm, 0.);
+	sigmas.resize(ndm, 1.);
+	tails.resize(ndm * ntail, 0.);
+	nthreads = XLIBS::get_num_threads();
+	prefix.resize(nthreads * (ntail + ndump + 1), 0.);
+	best.resize(nthreads * ndump, 0.);
+	bestw.resize(nthreads * ndump, 0);
+	scratch.resize(nthreads * std::min(ndump, (size_t)SINGLEPULSE_NSTAT), 0.);
+	rowcands.resize(ndm);
+	openruns.assign(ndm, 0);
+	opencands.resize(ndm);
+
+	stats_ready = false;
+
+	std::vector<std::pair<std::string, std::string>> meta = {
+			{"number of dm", std::to_string(ndm)},
+			{"dump size", std::to_string(ndump)},
+			{"number of widths", std::to_string(widths.size())},
+			{"maximum width", std::to_string(widths.back())},
+			{"threshold", std::to_string(threshold)}
+		};
+	format_logging("Single Pulse Search Info", meta);
+}
+
+/**
+ * @brief median and interquartile range of a strided subset of the row, mixed into the running values
+ */
+void SinglePulseSearch::update_stats(size_t k, const float *row, float *scratch)
+{
+	size_t stride = (ndump + SINGLEPULSE_NSTAT - 1) / SINGLEPULSE_NSTAT;
+	size_t n = 0;
+	for (size_t i=0; i<ndump; i+=stride)
+	{
+		scratch[n++] = row[i];
+	}
+
+	std::nth_element(scratch, scratch + n / 4, scratch + n);
+	float q1 = scratch[n / 4];
+	std::nth_element(scratch + n / 4, scratch + n / 2, scratch + n);
+	float q2 = scratch[n / 2];
+	std::nth_element(scratch + n / 2, scratch + 3 * n / 4, scratch + n);
+	float q3 = scratch[3 * n / 4];
+
+	float sigma = (q3 - q1) / 1.349;
+
+	if (!stats_ready)
+	{
+		medians[k] = q2;
+		sigmas[k] = sigma;
+	}
+	else
+	{
+		medians[k] = (1. - alpha) * medians[k] + alpha * q2;
+		sigmas[k] = (1. - alpha) * sigmas[k] + alpha * sigma;
+	}
+}
+
+void SinglePulseSearch::run(const float *data, size_t ld)
+{
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads)
+#endif
+	for (size_t k=0; k<ndm; k++)
+	{
+		int thread_id = omp_get_thread_num();
+
+		const float *row = data + k * ld;
+		float *tail = tails.data() + k * ntail;
+		float *pre = prefix.data() + thread_id * (ntail + ndump + 1);
+		float *pbest = best.data() + thread_id * ndump;
+		int *pbestw = bestw.data() + thread_id * ndump;
+
+		update_stats(k, row, scratch.data() + thread_id * std::min(ndump, (size_t)SINGLEPULSE_NSTAT));
+
+		float median = medians[k];
+		float scl = sigmas[k] > 0. ? 1. / sigmas[k] : 0.;
+
+		/* prefix sum of the normalized tail and block */
+		pre[0] = 0.;
+		for (size_t i=0; i<ntail; i++)
+		{
+			pre[i + 1] = pre[i] + tail[i];
+		}
+		for (size_t i=0; i<ndump; i++)
+		{
+			pre[ntail + i + 1] = pre[ntail + i] + (row[i] - median) * scl;
+		}
+
+		/* boxcars ending in this block */
+		std::fill(pbest, pbest + ndump, -std::numeric_limits<float>::infinity());
+		std::fill(pbestw, pbestw + ndump, 0);
+
+		const float *a = pre + ntail + 1;
+		for (auto w=widths.begin(); w!=widths.end(); ++w)
+		{
+			PulsarX::simd_kernels().boxcar_max(pbest, pbestw, a, ndump, *w, 1. / std::sqrt(*w));
+		}
+
+		/* one candidate per run above threshold, a run open at the end of the previous block continues */
+		std::vector<SinglePulseCandidate> &cands = rowcands[k];
+		cands.clear();
+
+		bool inrun = openruns[k];
+		SinglePulseCandidate cand = opencands[k];
+		for (size_t i=0; i<ndump; i++)
+		{
+			if (pbest[i] >= threshold)
+			{
+				if (!inrun || pbest[i] > cand.snr)
+				{
+					cand.idm = k;
+					cand.width = pbestw[i];
+					cand.sample = counter + (long int)i - pbestw[i] + 1;
+					cand.snr = pbest[i];
+				}
+				inrun = true;
+			}
+			else if (inrun)
+			{
+				cands.push_back(cand);
+				inrun = false;
+			}
+		}
+		openruns[k] = inrun;
+		opencands[k] = cand;
+
+		/* carry the normalized end of the block */
+		for (size_t i=0; i<ntail; i++)
+		{
+			tail[i] = a[(long int)ndump - (long int)ntail + (long int)i] - a[(long int)ndump - (long int)ntail + (long int)i - 1];
+		}
+	}
+
+	stats_ready = true;
+
+	candidates.clear();
+	for (size_t k=0; k<ndm; k++)
+	{
+		candidates.insert(candidates.end(), rowcands[k].begin(), rowcands[k].end());
+	}
+
+	counter += ndump;
+
+	BOOST_LOG_TRIVIAL(debug)<<"found "<<candidates.size()<<" single pulse candidates";
+}
+
+void SinglePulseSearch::flush()
+{
+	candidates.clear();
+	for (size_t k=0; k<ndm; k++)
+	{
+		if (openruns[k]) candidates.push_back(opencands[k]);
+		openruns[k] = 0;
+	}
+}
+
+void SinglePulseSearch::run(DataBuffer<float> &databuffer)
+{
+	bufferT.resize(ndm * ndump, 0.);
+	transpose_pad<float>(bufferT.data(), databuffer.buffer.data(), ndump, ndm);
+
+	run(bufferT.data(), ndump);
+}
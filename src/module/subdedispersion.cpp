@@ -8,6 +8,7 @@
 
 #include <iomanip>
 #include <algorithm>
+#include <limits>
 #include <assert.h>
 #include <sys/time.h>
 #include <sys/resource.h> 
@@ -57,6 +58,9 @@ void Subband::prepare()
 	buffertim.resize(nsub*ndm_per_sub*ndump, 0.);
 	cachetim.resize(nsub*ndm_per_sub*noverlap, 0.);
 	cachesub.resize(nsub*nchans*(noverlap+(nsamples-ndump)), 0.);
+
+	ndead.resize(nchans, std::numeric_limits<int>::max());
+	dead.resize(nchans, true);
 }
 
 void Subband::run(vector<float> &data)
@@ -78,13 +82,17 @@ void Subband::run(vector<float> &data)
 		transpose_pad<float>(&bufferT[0]+k*nchans*nsamples, &buffer[0]+k*nsamples*nchans, nsamples, nchans);
 	}
 
+	update_dead_channels(ndead, dead, chmask, nchans, nsamples/ndump);
+
 	fill(buffertim.begin(), buffertim.end(), 0.);
 	for (long int k=0; k<nsub; k++)
 	{
 		for (long int j=0; j<nchans; j++)
 		{
+			if (dead[j]) continue;
+
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 			for (long int l=0; l<ndm_per_sub; l++)
 			{
@@ -135,6 +143,55 @@ void Subband::cache()
 	}
 }
 
+void Subband::save_state(Checkpoint &checkpoint, const string &prefix) const
+{
+	checkpoint.put(prefix + ".counter", counter);
+	checkpoint.put(prefix + ".ndead", ndead);
+	checkpoint.put(prefix + ".dead", dead);
+
+	/* the first nsamples-ndump rows of each subband are kept for the next block */
+	long int nspace = nsamples-ndump;
+	vector<float> overlap(nsub*nspace*nchans, 0.);
+	for (long int k=0; k<nsub; k++)
+	{
+		std::copy(buffer.begin()+k*nsamples*nchans, buffer.begin()+k*nsamples*nchans+nspace*nchans, overlap.begin()+k*nspace*nchans);
+	}
+	checkpoint.put(prefix + ".overlap", overlap);
+
+	checkpoint.put(prefix + ".cachetim", cachetim);
+	checkpoint.put(prefix + ".cachesub", cachesub);
+}
+
+bool Subband::load_state(const Checkpoint &checkpoint, const string &prefix)
+{
+	long int counter_chk = 0;
+	vector<int> ndead_chk;
+	vector<bool> dead_chk;
+	long int nspace = nsamples-ndump;
+	vector<float> overlap(nsub*nspace*nchans, 0.);
+
+	if (!checkpoint.get(prefix + ".counter", counter_chk) or
+		!checkpoint.get(prefix + ".ndead", ndead_chk) or
+		!checkpoint.get(prefix + ".dead", dead_chk) or
+		!checkpoint.get(prefix + ".overlap", overlap.data(), overlap.size()) or
+		!checkpoint.get(prefix + ".cachetim", cachetim.data(), cachetim.size()) or
+		!checkpoint.get(prefix + ".cachesub", cachesub.data(), cachesub.size()))
+		return false;
+
+	if (ndead_chk.size() != ndead.size()) return false;
+
+	for (long int k=0; k<nsub; k++)
+	{
+		std::copy(overlap.begin()+k*nspace*nchans, overlap.begin()+(k+1)*nspace*nchans, buffer.begin()+k*nsamples*nchans);
+	}
+
+	counter = counter_chk;
+	ndead.swap(ndead_chk);
+	dead.swap(dead_chk);
+
+	return true;
+}
+
 void Subband::get_subdata(vector<float> &subdata, int idm, bool overlaped) const
 {
 	if (!overlaped)
@@ -292,7 +349,7 @@ SubbandDedispersion::SubbandDedispersion(nlohmann::json &config)
 	counter = 0;
 	offset = 0;
 	noverlap = 0;
-	nsubband = 0;
+	nsubband = config.value("nsubband", 0);
 	
 	rootname = config["rootname"];
 	ndump = 0;
@@ -329,6 +386,8 @@ SubbandDedispersion::SubbandDedispersion(const SubbandDedispersion &dedisp)
 	tsamp = dedisp.tsamp;
 	frequencies = dedisp.frequencies;
 	mxdelayn = dedisp.mxdelayn;
+	ndead = dedisp.ndead;
+	dead = dedisp.dead;
 	fmap = dedisp.fmap;
 	fcnt = dedisp.fcnt;
 	frefsub = dedisp.frefsub;
@@ -366,6 +425,8 @@ SubbandDedispersion & SubbandDedispersion::operator=(const SubbandDedispersion &
 	tsamp = dedisp.tsamp;
 	frequencies = dedisp.frequencies;
 	mxdelayn = dedisp.mxdelayn;
+	ndead = dedisp.ndead;
+	dead = dedisp.dead;
 	fmap = dedisp.fmap;
 	fcnt = dedisp.fcnt;
 	frefsub = dedisp.frefsub;
@@ -401,7 +462,7 @@ void SubbandDedispersion::read_config(nlohmann::json &config)
 	counter = 0;
 	offset = 0;
 	noverlap = 0;
-	nsubband = 0;
+	nsubband = config.value("nsubband", 0);
 	
 	rootname = config["rootname"];
 	ndump = 0;
@@ -424,7 +485,7 @@ void SubbandDedispersion::prepare(DataBuffer<float> &databuffer)
 	tsamp = databuffer.tsamp;
 	frequencies = databuffer.frequencies;
 
-	nsubband = round(sqrt(nchans));
+	if (nsubband <= 0 || nsubband > nchans) nsubband = round(sqrt(nchans));
 
 	double fmin = 1e6;
 	double fmax = 0.;
@@ -519,6 +580,9 @@ void SubbandDedispersion::prepare(DataBuffer<float> &databuffer)
 
 	offset = (nsamples-ndump)+(sub.nsamples-sub.ndump)+sub.noverlap;
 
+	ndead.resize(nchans, std::numeric_limits<int>::max());
+	dead.resize(nchans, true);
+
 	std::vector<std::pair<std::string, std::string>> meta = {
 		{"nsamples", std::to_string(nsamples)},
 		{"ndump", std::to_string(ndump)},
@@ -545,14 +609,24 @@ void SubbandDedispersion::run(DataBuffer<float> &databuffer, long int ns)
 
 	int nspace = nsamples-ns;
 
+	update_dead_channels(ndead, dead, databuffer.chmask, nchans, nsamples/ndump);
+
 	for (long int i=0; i<ns; i++)
 	{
 		for (long int j=0; j<nchans; j++)
 		{
-			buffer[(i+nspace)*nchans+j] = databuffer.buffer[i*nchans+j];
+			buffer[(i+nspace)*nchans+j] = (databuffer.chmask.empty() or !databuffer.chmask[j]) ? databuffer.buffer[i*nchans+j] : 0.;
 		}
 	}
 
+	/* a subband is flagged if all its channels are dead */
+	sub.chmask.resize(nsubband, 1);
+	std::fill(sub.chmask.begin(), sub.chmask.end(), 1);
+	for (long int j=0; j<nchans; j++)
+	{
+		if (!dead[j]) sub.chmask[fmap[j]] = 0;
+	}
+
 	databuffer.isbusy = false;
 	if (databuffer.closable) databuffer.close();
 
@@ -561,8 +635,10 @@ void SubbandDedispersion::run(DataBuffer<float> &databuffer, long int ns)
 	fill(buffersub.begin(), buffersub.end(), 0);
 	for (long int j=0; j<nchans; j++)
 	{
+		if (dead[j]) continue;
+
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 		for (long int k=0; k<nsub; k++)
 		{
@@ -871,6 +947,56 @@ void SubbandDedispersion::makeinf(long double tstart, std::string telescope, std
 	}
 }
 
+void SubbandDedispersion::save_state(Checkpoint &checkpoint, const string &prefix) const
+{
+	checkpoint.put(prefix + ".counter", counter);
+	checkpoint.put(prefix + ".ntot", ntot);
+	checkpoint.put(prefix + ".mean", mean);
+	checkpoint.put(prefix + ".var", var);
+	checkpoint.put(prefix + ".mean_var_ready", mean_var_ready);
+	checkpoint.put(prefix + ".ndead", ndead);
+	checkpoint.put(prefix + ".dead", dead);
+
+	/* the first nsamples-ndump rows are kept for the next block */
+	checkpoint.put(prefix + ".overlap", buffer.data(), (nsamples-ndump)*nchans);
+
+	sub.save_state(checkpoint, prefix + ".subband");
+}
+
+bool SubbandDedispersion::load_state(const Checkpoint &checkpoint, const string &prefix)
+{
+	long int counter_chk = 0, ntot_chk = 0;
+	double mean_chk = 0., var_chk = 0.;
+	bool mean_var_ready_chk = false;
+	vector<int> ndead_chk;
+	vector<bool> dead_chk;
+
+	if (!checkpoint.get(prefix + ".counter", counter_chk) or
+		!checkpoint.get(prefix + ".ntot", ntot_chk) or
+		!checkpoint.get(prefix + ".mean", mean_chk) or
+		!checkpoint.get(prefix + ".var", var_chk) or
+		!checkpoint.get(prefix + ".mean_var_ready", mean_var_ready_chk) or
+		!checkpoint.get(prefix + ".ndead", ndead_chk) or
+		!checkpoint.get(prefix + ".dead", dead_chk))
+		return false;
+
+	if (ndead_chk.size() != ndead.size()) return false;
+
+	if (!checkpoint.get(prefix + ".overlap", buffer.data(), (nsamples-ndump)*nchans) or
+		!sub.load_state(checkpoint, prefix + ".subband"))
+		return false;
+
+	counter = counter_chk;
+	ntot = ntot_chk;
+	mean = mean_chk;
+	var = var_chk;
+	mean_var_ready = mean_var_ready_chk;
+	ndead.swap(ndead_chk);
+	dead.swap(dead_chk);
+
+	return true;
+}
+
 void SubbandDedispersion::rundump(float mean, float std, int nbits, const string &format)
 {
 	if (counter < offset-noverlap+ndump) return;
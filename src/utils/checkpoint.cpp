@@ -0,0 +1,81 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 22:41:26
+ * @modify date 2026-10-19 22:41:26
+ * @desc [description]
+ */
+
+#include <cstdio>
+#include <fstream>
+
+#include "checkpoint.h"
+
+static const char checkpoint_magic[8] = {'X', 'C', 'H', 'K', 'P', 'N', 'T', '1'};
+
+bool Checkpoint::save(const std::string &fname) const
+{
+	std::string tmpname = fname + ".tmp";
+
+	std::ofstream file(tmpname, std::ios::out|std::ios::binary|std::ios::trunc);
+	if (!file.is_open()) return false;
+
+	file.write(checkpoint_magic, 8);
+
+	uint64_t nrecords = records.size();
+	file.write((char *)&nrecords, sizeof(nrecords));
+
+	for (auto r=records.begin(); r!=records.end(); ++r)
+	{
+		uint32_t keysize = r->first.size();
+		uint64_t size = r->second.size();
+
+		file.write((char *)&keysize, sizeof(keysize));
+		file.write(r->first.data(), keysize);
+		file.write((char *)&size, sizeof(size));
+		file.write(r->second.data(), size);
+	}
+
+	file.close();
+	if (!file) return false;
+
+	return std::rename(tmpname.c_str(), fname.c_str()) == 0;
+}
+
+bool Checkpoint::load(const std::string &fname)
+{
+	std::ifstream file(fname, std::ios::in|std::ios::binary);
+	if (!file.is_open()) return false;
+
+	char magic[8];
+	file.read(magic, 8);
+	if (!file or memcmp(magic, checkpoint_magic, 8) != 0) return false;
+
+	uint64_t nrecords = 0;
+	file.read((char *)&nrecords, sizeof(nrecords));
+	if (!file) return false;
+
+	std::map<std::string, std::string> temp;
+	for (uint64_t k=0; k<nrecords; k++)
+	{
+		uint32_t keysize = 0;
+		uint64_t size = 0;
+
+		file.read((char *)&keysize, sizeof(keysize));
+		if (!file) return false;
+		std::string key(keysize, '\0');
+		file.read(&key[0], keysize);
+
+		file.read((char *)&size, sizeof(size));
+		if (!file) return false;
+		std::string value(size, '\0');
+		file.read(&value[0], size);
+		if (!file) return false;
+
+		temp[key].swap(value);
+	}
+
+	records.swap(temp);
+
+	return true;
+}
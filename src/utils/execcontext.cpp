@@ -0,0 +1,229 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 21:02:44
+ * @modify date 2026-10-19 21:02:44
+ * @desc [description]
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <sched.h>
+#include <pthread.h>
+
+#include <boost/log/trivial.hpp>
+
+#include "execcontext.h"
+#include "numautils.h"
+#include "dedisperse.h"
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+using namespace XLIBS;
+
+/* "0-15,32-47" */
+static std::vector<int> parse_cpulist(const std::string &list)
+{
+	std::vector<int> cpus;
+	size_t pos = 0;
+	while (pos < list.size())
+	{
+		size_t next = list.find(',', pos);
+		if (next == std::string::npos) next = list.size();
+
+		std::string range = list.substr(pos, next - pos);
+		int first = 0, last = 0;
+		int n = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+		if (n == 1) last = first;
+		if (n >= 1)
+		{
+			for (int cpu=first; cpu<=last; cpu++) cpus.push_back(cpu);
+		}
+
+		pos = next + 1;
+	}
+	return cpus;
+}
+
+static std::vector<std::vector<int>> read_node_cpus()
+{
+	std::vector<std::vector<int>> nodes;
+
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return nodes;
+
+	for (int node=0; ; node++)
+	{
+		std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		if (!f.is_open()) break;
+
+		std::string list;
+		std::getline(f, list);
+
+		std::vector<int> cpus;
+		for (auto cpu : parse_cpulist(list))
+		{
+			if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+		}
+		if (!cpus.empty()) nodes.push_back(cpus);
+	}
+
+	/* topology unknown, one node */
+	if (nodes.empty())
+	{
+		std::vector<int> cpus;
+		for (int cpu=0; cpu<CPU_SETSIZE; cpu++)
+		{
+			if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+		}
+		if (!cpus.empty()) nodes.push_back(cpus);
+	}
+
+	return nodes;
+}
+
+const std::vector<std::vector<int>> & XLIBS::get_node_cpus()
+{
+	static std::vector<std::vector<int>> nodes = read_node_cpus();
+	return nodes;
+}
+
+/* cpus of the default context from the affinity policy */
+static std::vector<int> get_policy_cpus(PulsarX::AffinityPolicy affinity)
+{
+	const std::vector<std::vector<int>> &nodes = get_node_cpus();
+
+	std::vector<int> order;
+	if (affinity == PulsarX::AFFINITY_COMPACT)
+	{
+		for (auto &cpus : nodes) order.insert(order.end(), cpus.begin(), cpus.end());
+	}
+	else if (affinity == PulsarX::AFFINITY_SPREAD)
+	{
+		size_t maxsize = 0;
+		for (auto &cpus : nodes) maxsize = std::max(maxsize, cpus.size());
+		for (size_t k=0; k<maxsize; k++)
+		{
+			for (auto &cpus : nodes)
+			{
+				if (k < cpus.size()) order.push_back(cpus[k]);
+			}
+		}
+	}
+	return order;
+}
+
+static const ExecutionContext & default_context()
+{
+	static ExecutionContext context;
+	return context;
+}
+
+static thread_local const ExecutionContext *current_context = NULL;
+
+ExecutionContext::ExecutionContext()
+{
+	nthreads = 0;
+}
+
+ExecutionContext::ExecutionContext(unsigned int n, const std::vector<int> &c)
+{
+	nthreads = n;
+	cpus = c;
+}
+
+unsigned int ExecutionContext::get_num_threads() const
+{
+	return nthreads != 0 ? nthreads : std::max(1U, num_threads);
+}
+
+void ExecutionContext::bind() const
+{
+#ifdef _OPENMP
+	if (omp_in_parallel()) return;
+
+	std::vector<int> order = cpus;
+	if (order.empty())
+	{
+		/* the OpenMP runtime already places the threads */
+		if (std::getenv("OMP_PROC_BIND") != NULL || std::getenv("OMP_PLACES") != NULL) return;
+		order = get_policy_cpus(PulsarX::get_memory_policy().affinity);
+	}
+	if (order.empty()) return;
+
+	/* each master thread has its own team, so the binding is kept per thread */
+	static thread_local std::vector<int> bound_cpus;
+	static thread_local unsigned int nbound = 0;
+
+	unsigned int n = get_num_threads();
+	if (n <= nbound && order == bound_cpus) return;
+
+#pragma omp parallel num_threads(n)
+	{
+		cpu_set_t cpuset;
+		CPU_ZERO(&cpuset);
+		CPU_SET(order[omp_get_thread_num() % order.size()], &cpuset);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+	}
+
+	bound_cpus = order;
+	nbound = n;
+
+	BOOST_LOG_TRIVIAL(debug)<<"bind "<<n<<" threads to "<<order.size()<<" cpus";
+#endif
+}
+
+const ExecutionContext & ExecutionContext::current()
+{
+	return current_context != NULL ? *current_context : default_context();
+}
+
+std::vector<ExecutionContext> ExecutionContext::partition(size_t nparts)
+{
+	std::vector<int> all;
+	for (auto &cpus : get_node_cpus()) all.insert(all.end(), cpus.begin(), cpus.end());
+
+	std::vector<ExecutionContext> contexts;
+	if (nparts == 0 || all.empty()) return contexts;
+
+	size_t ncpus = std::max(all.size(), nparts);
+	for (size_t k=0; k<nparts; k++)
+	{
+		size_t first = k * ncpus / nparts;
+		size_t last = (k + 1) * ncpus / nparts;
+
+		std::vector<int> cpus;
+		for (size_t i=first; i<last; i++) cpus.push_back(all[i % all.size()]);
+
+		contexts.push_back(ExecutionContext(cpus.size(), cpus));
+	}
+
+	return contexts;
+}
+
+ExecutionContext::Scope::Scope(const ExecutionContext &context)
+{
+	previous = current_context;
+	current_context = &context;
+	context.bind();
+}
+
+ExecutionContext::Scope::~Scope()
+{
+	current_context = previous;
+}
+
+unsigned int XLIBS::get_num_threads()
+{
+#ifdef _OPENMP
+	if (omp_in_parallel()) return 1;
+#endif
+	return ExecutionContext::current().get_num_threads();
+}
@@ -0,0 +1,66 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 10:12:45
+ * @modify date 2026-10-19 10:12:45
+ * @desc [description]
+ */
+
+#include <cmath>
+#include <algorithm>
+#include "noisefill.h"
+
+#include "simd.h"
+
+/**
+ * stream index i is mapped to block b=i/32, component (i%32)/8 and lane i%8,
+ * the philox counter of the lane is (b*8+lane, channel, counter_lo, counter_hi),
+ * component 0,1 and 2,3 are the two Box-Muller pairs of the philox output
+ */
+void NoiseFill::generate(float *out, uint64_t block, uint64_t counter, uint32_t channel) const
+{
+	PulsarX::simd_kernels().normal32(out, block, counter, channel, seed);
+}
+
+static inline uint64_t splitmix64(uint64_t x)
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+/* FNV-1a of the module name */
+uint64_t NoiseFill::salt(const std::string &module, uint64_t ibeam)
+{
+	uint64_t h = 0xCBF29CE484222325ULL;
+	for (auto c : module)
+	{
+		h ^= (unsigned char)c;
+		h *= 0x100000001B3ULL;
+	}
+	return splitmix64(h ^ splitmix64(ibeam));
+}
+
+void NoiseFill::fill_strided(float *data, size_t n, size_t stride, uint64_t counter, uint32_t channel, uint64_t offset, float mean, float stddev) const
+{
+	if (n == 0) return;
+
+	alignas(32) float tmp[32];
+
+	uint64_t bstart = offset / 32;
+	uint64_t bend = (offset + n - 1) / 32;
+	for (uint64_t b=bstart; b<=bend; b++)
+	{
+		generate(tmp, b, counter, channel);
+
+		uint64_t i0 = std::max(offset, b * 32);
+		uint64_t i1 = std::min(offset + n, b * 32 + 32);
+		float *pd = data + (i0 - offset) * stride;
+		for (uint64_t i=i0; i<i1; i++)
+		{
+			*pd = mean + stddev * tmp[i - b * 32];
+			pd += stride;
+		}
+	}
+}
@@ -0,0 +1,197 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 20:41:05
+ * @modify date 2026-10-19 20:41:05
+ * @desc [description]
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <boost/log/trivial.hpp>
+
+#include "numautils.h"
+#include "execcontext.h"
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+using namespace PulsarX;
+
+#define XLIBS_MMAP_THRESHOLD (1UL << 20)
+#define XLIBS_HUGEPAGE_SIZE (2UL << 20)
+/* freed mappings kept per length for reuse */
+#define XLIBS_MMAP_CACHE 2
+
+static MemoryPolicy default_policy()
+{
+	MemoryPolicy policy;
+	policy.first_touch = true;
+	policy.hugepages = false;
+	policy.affinity = AFFINITY_NONE;
+
+	const char *env = std::getenv("XLIBS_FIRST_TOUCH");
+	if (env != NULL) policy.first_touch = std::atoi(env) != 0;
+
+	env = std::getenv("XLIBS_HUGEPAGES");
+	if (env != NULL) policy.hugepages = std::atoi(env) != 0;
+
+	env = std::getenv("XLIBS_AFFINITY");
+	if (env != NULL)
+	{
+		if (strcmp(env, "compact") == 0)
+			policy.affinity = AFFINITY_COMPACT;
+		else if (strcmp(env, "spread") == 0)
+			policy.affinity = AFFINITY_SPREAD;
+		else if (strcmp(env, "none") != 0)
+			BOOST_LOG_TRIVIAL(warning)<<"unknown XLIBS_AFFINITY="<<env<<", expected none, compact or spread";
+	}
+
+	return policy;
+}
+
+/* function static, the buffers may be allocated during static initialization */
+static MemoryPolicy & memory_policy()
+{
+	static MemoryPolicy policy = default_policy();
+	return policy;
+}
+
+const MemoryPolicy & PulsarX::get_memory_policy()
+{
+	return memory_policy();
+}
+
+void PulsarX::set_memory_policy(const MemoryPolicy &policy)
+{
+	memory_policy() = policy;
+}
+
+void PulsarX::bind_threads()
+{
+	XLIBS::ExecutionContext::current().bind();
+}
+
+/**
+ * @brief write one byte per page, thread i gets the i-th contiguous part like
+ * "omp parallel for" over the rows of a row-major buffer
+ */
+static void first_touch(char *p, size_t size)
+{
+#ifdef _OPENMP
+	if (omp_in_parallel()) return;
+
+	bind_threads();
+
+	long int pagesize = sysconf(_SC_PAGESIZE);
+	long int npages = (size + pagesize - 1) / pagesize;
+
+#pragma omp parallel for num_threads(XLIBS::get_num_threads()) schedule(static)
+	for (long int i=0; i<npages; i++)
+	{
+		p[i * pagesize] = 0;
+	}
+#endif
+}
+
+/**
+ * @brief the freed mappings, the stages closed and opened again every block (Pipeline in
+ * MEMORY mode) get back mappings whose pages are already placed. Never destroyed, the
+ * buffers may be freed during static destruction.
+ */
+static std::mutex & cache_mutex()
+{
+	static std::mutex *mutex = new std::mutex;
+	return *mutex;
+}
+
+static std::map<size_t, std::vector<void *>> & mmap_cache()
+{
+	static std::map<size_t, std::vector<void *>> *cache = new std::map<size_t, std::vector<void *>>;
+	return *cache;
+}
+
+void * PulsarX::numa_alloc(size_t size, size_t alignment)
+{
+	if (size < XLIBS_MMAP_THRESHOLD)
+	{
+		void *p = NULL;
+		if (posix_memalign(&p, std::max(alignment, sizeof(void *)), std::max(size, (size_t)1)) != 0) throw std::bad_alloc();
+		return p;
+	}
+
+	size_t len = (size + XLIBS_HUGEPAGE_SIZE - 1) / XLIBS_HUGEPAGE_SIZE * XLIBS_HUGEPAGE_SIZE;
+
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex());
+		std::vector<void *> &cached = mmap_cache()[len];
+		if (!cached.empty())
+		{
+			void *p = cached.back();
+			cached.pop_back();
+			return p;
+		}
+	}
+
+	/* over map by one huge page and trim to 2 MB alignment */
+	void *base = mmap(NULL, len + XLIBS_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) throw std::bad_alloc();
+
+	uintptr_t start = ((uintptr_t)base + XLIBS_HUGEPAGE_SIZE - 1) / XLIBS_HUGEPAGE_SIZE * XLIBS_HUGEPAGE_SIZE;
+	size_t head = start - (uintptr_t)base;
+	if (head != 0) munmap(base, head);
+	if (XLIBS_HUGEPAGE_SIZE - head != 0) munmap((char *)start + len, XLIBS_HUGEPAGE_SIZE - head);
+
+	char *p = (char *)start;
+
+	const MemoryPolicy &policy = get_memory_policy();
+#ifdef MADV_HUGEPAGE
+	if (policy.hugepages) madvise(p, len, MADV_HUGEPAGE);
+#endif
+	if (policy.first_touch) first_touch(p, size);
+
+	return p;
+}
+
+void PulsarX::numa_free(void *p, size_t size)
+{
+	if (p == NULL) return;
+
+	if (size < XLIBS_MMAP_THRESHOLD)
+	{
+		free(p);
+		return;
+	}
+
+	size_t len = (size + XLIBS_HUGEPAGE_SIZE - 1) / XLIBS_HUGEPAGE_SIZE * XLIBS_HUGEPAGE_SIZE;
+
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex());
+		std::vector<void *> &cached = mmap_cache()[len];
+		if (cached.size() < XLIBS_MMAP_CACHE)
+		{
+			cached.push_back(p);
+			return;
+		}
+	}
+
+	munmap(p, len);
+}
+
+void PulsarX::numa_trim()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex());
+	for (auto &cached : mmap_cache())
+	{
+		for (auto p : cached.second) munmap(p, cached.first);
+	}
+	mmap_cache().clear();
+}
@@ -0,0 +1,583 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 19:06:12
+ * @modify date 2026-10-19 19:06:12
+ * @desc [description]
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+
+#include "simd.h"
+#include "noisefill.h"
+
+using namespace PulsarX;
+
+static float reduce_scalar(const float *data, size_t size)
+{
+	float sum = 0.;
+	for (size_t i=0; i<size; i++)
+	{
+		sum += data[i];
+	}
+	return sum;
+}
+
+static void accumulate_mean_scalar(double *mean, double *mean_scale, double scale, const float *data, size_t size)
+{
+	for (size_t i=0; i<size; i++)
+	{
+		mean[i] += data[i];
+		mean_scale[i] += data[i] * scale;
+	}
+}
+
+static void accumulate_mean_var_scalar(double *mean, double *var, const float *data, size_t size)
+{
+	for (size_t i=0; i<size; i++)
+	{
+		mean[i] += data[i];
+		var[i] += (double)data[i] * data[i];
+	}
+}
+
+static void accumulate_mean_var2_scalar(double &mean, double &var, const float *data, size_t size)
+{
+	mean = 0.;
+	var = 0.;
+	for (size_t i=0; i<size; i++)
+	{
+		mean += data[i];
+		var += (double)data[i] * data[i];
+	}
+}
+
+static void remove_baseline_scalar(float *data_out, const float *data_in, const float *a, const float *b, float s, size_t size)
+{
+	for (size_t i=0; i<size; i++)
+	{
+		data_out[i] = data_in[i] - (a[i] * s + b[i]);
+	}
+}
+
+static float remove_baseline_reduce_scalar(float *data_out, const float *data_in, const float *a, const float *b, float s, size_t size)
+{
+	float sum = 0.;
+	for (size_t i=0; i<size; i++)
+	{
+		data_out[i] = data_in[i] - (a[i] * s + b[i]);
+		sum += data_out[i] * data_out[i];
+	}
+	return sum;
+}
+
+/* rounds half to even like the vector code */
+static void scale_scalar(unsigned char *data_out, const float *data_in, float scl, float offs, unsigned int nbits, size_t size)
+{
+	float max = std::pow(2, nbits) - 1.;
+	size_t nsamp_per_byte = 8 / nbits;
+
+	for (size_t i=0; i<size/nsamp_per_byte; i++)
+	{
+		unsigned char byte = 0;
+		for (size_t k=0; k<nsamp_per_byte; k++)
+		{
+			float tmp = std::nearbyint(data_in[i * nsamp_per_byte + k] * scl + offs);
+			tmp = std::min(max, std::max(0.f, tmp));
+			byte |= ((unsigned char)tmp) << (k * nbits);
+		}
+		data_out[i] = byte;
+	}
+}
+
+static void accumulate_mean_var3_scalar(float &mean, float &var, const float *data, size_t size)
+{
+	mean = 0.;
+	var = 0.;
+	for (size_t i=0; i<size; i++)
+	{
+		mean += data[i];
+		var += data[i] * data[i];
+	}
+}
+
+static void normalize2_scalar(float *data_out, const float *data_in, const float *mean, const float *stddev_inv, size_t size)
+{
+	for (size_t i=0; i<size; i++)
+	{
+		data_out[i] = (data_in[i] - mean[i]) * stddev_inv[i];
+	}
+}
+
+static void accumulate_moments_scalar(double *mean1, double *mean2, double *mean3, double *mean4, double *corr1, double *last_data, const float *data, size_t size)
+{
+	for (size_t i=0; i<size; i++)
+	{
+		double tmp1 = data[i];
+		double tmp2 = tmp1 * tmp1;
+		mean1[i] += tmp1;
+		mean2[i] += tmp2;
+		mean3[i] += tmp2 * tmp1;
+		mean4[i] += tmp2 * tmp2;
+		corr1[i] += tmp1 * last_data[i];
+		last_data[i] = tmp1;
+	}
+}
+
+/* same conventions as PulsarX::kadane2D, a column without positive sum gets the first row */
+static void kadane2D_scalar(float *maxSum, int *start, int *end, const float *arr, size_t nrow, size_t ncol)
+{
+	std::vector<float> sum(ncol, 0.);
+	std::vector<int> local_start(ncol, 0);
+	for (size_t j=0; j<ncol; j++)
+	{
+		maxSum[j] = -std::numeric_limits<float>::infinity();
+		start[j] = 0;
+		end[j] = -1;
+	}
+
+	for (size_t i=0; i<nrow; i++)
+	{
+		for (size_t j=0; j<ncol; j++)
+		{
+			float s = sum[j] + arr[i * ncol + j];
+			if (s < 0.)
+			{
+				sum[j] = 0.;
+				local_start[j] = i + 1;
+			}
+			else
+			{
+				sum[j] = s;
+				if (s > maxSum[j])
+				{
+					maxSum[j] = s;
+					start[j] = local_start[j];
+					end[j] = i;
+				}
+			}
+		}
+	}
+
+	for (size_t j=0; j<ncol; j++)
+	{
+		if (end[j] == -1)
+		{
+			maxSum[j] = arr[j];
+			start[j] = 0;
+			end[j] = 0;
+		}
+	}
+}
+
+static void kadane2D_pn_scalar(float *maxSum_p, int *start_p, int *end_p, float *maxSum_n, int *start_n, int *end_n, const float *arr, size_t nrow, size_t ncol, size_t ld)
+{
+	for (size_t j=0; j<ncol; j++)
+	{
+		float sum_p = 0., sum_n = 0.;
+		int local_start_p = 0, local_start_n = 0;
+		maxSum_p[j] = -std::numeric_limits<float>::infinity();
+		maxSum_n[j] = -std::numeric_limits<float>::infinity();
+		start_p[j] = 0;
+		start_n[j] = 0;
+		end_p[j] = -1;
+		end_n[j] = -1;
+
+		for (size_t i=0; i<nrow; i++)
+		{
+			sum_p += arr[i * ld + j];
+			sum_n -= arr[i * ld + j];
+
+			if (sum_p < 0.)
+			{
+				sum_p = 0.;
+				local_start_p = i + 1;
+			}
+			else if (sum_p > maxSum_p[j])
+			{
+				maxSum_p[j] = sum_p;
+				start_p[j] = local_start_p;
+				end_p[j] = i;
+			}
+
+			if (sum_n < 0.)
+			{
+				sum_n = 0.;
+				local_start_n = i + 1;
+			}
+			else if (sum_n > maxSum_n[j])
+			{
+				maxSum_n[j] = sum_n;
+				start_n[j] = local_start_n;
+				end_n[j] = i;
+			}
+		}
+
+		if (end_p[j] == -1)
+		{
+			maxSum_p[j] = arr[j];
+			start_p[j] = 0;
+			end_p[j] = 0;
+		}
+		if (end_n[j] == -1)
+		{
+			maxSum_n[j] = -arr[j];
+			start_n[j] = 0;
+			end_n[j] = 0;
+		}
+	}
+}
+
+static void boxcar_max_scalar(float *best, int *bestw, const float *a, size_t size, int w, float scl)
+{
+	for (size_t i=0; i<size; i++)
+	{
+		float box = (a[i] - a[(long int)i - w]) * scl;
+		if (box > best[i])
+		{
+			best[i] = box;
+			bestw[i] = w;
+		}
+	}
+}
+
+static void harmonic_sum_scalar(float *sum, const float *power, size_t size, int nh)
+{
+	int sh = 0;
+	while ((1 << sh) < nh) sh++;
+
+	for (size_t k=0; k<size; k++)
+	{
+		float s = 0.;
+		for (int m=1; m<=nh; m++)
+		{
+			s += power[(m * k + nh / 2) >> sh];
+		}
+		sum[k] = s;
+	}
+}
+
+static void phase_bins_scalar(int *bins, double phi0, double dphi, size_t size, int nbin)
+{
+	for (size_t i=0; i<size; i++)
+	{
+		double phi = phi0 + i * dphi;
+		int bin = (phi - std::floor(phi)) * nbin;
+		bins[i] = bin < nbin ? bin : nbin - 1;
+	}
+}
+
+static void gather_scalar(float *out, const float *in, const int *idx, size_t size)
+{
+	for (size_t i=0; i<size; i++)
+	{
+		out[i] = in[idx[i]];
+	}
+}
+
+static inline void philox4x32_10(uint32_t ctr[4], uint32_t key[2])
+{
+	for (int r=0; r<10; r++)
+	{
+		uint64_t p0 = (uint64_t)PHILOX_M0 * ctr[0];
+		uint64_t p1 = (uint64_t)PHILOX_M1 * ctr[2];
+		uint32_t c0 = (uint32_t)(p1 >> 32) ^ ctr[1] ^ key[0];
+		uint32_t c1 = (uint32_t)p1;
+		uint32_t c2 = (uint32_t)(p0 >> 32) ^ ctr[3] ^ key[1];
+		uint32_t c3 = (uint32_t)p0;
+		ctr[0] = c0;
+		ctr[1] = c1;
+		ctr[2] = c2;
+		ctr[3] = c3;
+		key[0] += PHILOX_W0;
+		key[1] += PHILOX_W1;
+	}
+}
+
+static inline float uniform(uint32_t x)
+{
+	return ((x >> 8) + 0.5f) * (1.f / 16777216.f);
+}
+
+XLIBS_EXACT_FP_BEGIN
+
+static inline uint32_t float_bits(float x)
+{
+	uint32_t u;
+	memcpy(&u, &x, sizeof(u));
+	return u;
+}
+
+static inline float bits_float(uint32_t u)
+{
+	float x;
+	memcpy(&x, &u, sizeof(x));
+	return x;
+}
+
+/**
+ * @brief log256_ps and sincos256_ps of avx_mathfun.h for one lane, the same float
+ * operations in the same order, so that the noise does not depend on the kernel table
+ */
+static inline float log_cephes(float x)
+{
+	bool invalid = x <= 0.f;
+
+	x = x > bits_float(0x00800000) ? x : bits_float(0x00800000);
+
+	int32_t imm0 = float_bits(x) >> 23;
+
+	x = bits_float((float_bits(x) & ~0x7f800000U) | float_bits(0.5f));
+
+	imm0 = imm0 - 0x7f;
+	float e = (float)imm0;
+
+	e = e + 1.f;
+
+	bool mask = x < 0.707106781186547524f;
+	float tmp = mask ? x : 0.f;
+	x = x - 1.f;
+	e = e - (mask ? 1.f : 0.f);
+	x = x + tmp;
+
+	float z = x * x;
+
+	float y = 7.0376836292E-2f;
+	y = y * x;
+	y = y + -1.1514610310E-1f;
+	y = y * x;
+	y = y + 1.1676998740E-1f;
+	y = y * x;
+	y = y + -1.2420140846E-1f;
+	y = y * x;
+	y = y + 1.4249322787E-1f;
+	y = y * x;
+	y = y + -1.6668057665E-1f;
+	y = y * x;
+	y = y + 2.0000714765E-1f;
+	y = y * x;
+	y = y + -2.4999993993E-1f;
+	y = y * x;
+	y = y + 3.3333331174E-1f;
+	y = y * x;
+
+	y = y * z;
+
+	tmp = e * -2.12194440e-4f;
+	y = y + tmp;
+
+	tmp = z * 0.5f;
+	y = y - tmp;
+
+	tmp = e * 0.693359375f;
+	x = x + y;
+	x = x + tmp;
+
+	return invalid ? bits_float(0xffffffffU) : x;
+}
+
+static inline void sincos_cephes(float x, float &s, float &c)
+{
+	uint32_t sign_bit_sin = float_bits(x) & 0x80000000U;
+	x = bits_float(float_bits(x) & 0x7fffffffU);
+
+	float y = x * 1.27323954473516f;
+
+	int32_t imm2 = (int32_t)y;
+	imm2 = (imm2 + 1) & ~1;
+
+	y = (float)imm2;
+	int32_t imm4 = imm2;
+
+	uint32_t swap_sign_bit_sin = ((uint32_t)imm2 & 4) << 29;
+	bool poly_mask = (imm2 & 2) == 0;
+
+	float xmm1 = y * -0.78515625f;
+	float xmm2 = y * -2.4187564849853515625e-4f;
+	float xmm3 = y * -3.77489497744594108e-8f;
+	x = x + xmm1;
+	x = x + xmm2;
+	x = x + xmm3;
+
+	imm4 = imm4 - 2;
+	uint32_t sign_bit_cos = (~(uint32_t)imm4 & 4) << 29;
+
+	sign_bit_sin = sign_bit_sin ^ swap_sign_bit_sin;
+
+	float z = x * x;
+	y = 2.443315711809948E-005f;
+
+	y = y * z;
+	y = y + -1.388731625493765E-003f;
+	y = y * z;
+	y = y + 4.166664568298827E-002f;
+	y = y * z;
+	y = y * z;
+	float tmp = z * 0.5f;
+	y = y - tmp;
+	y = y + 1.f;
+
+	float y2 = -1.9515295891E-4f;
+	y2 = y2 * z;
+	y2 = y2 + 8.3321608736E-3f;
+	y2 = y2 * z;
+	y2 = y2 + -1.6666654611E-1f;
+	y2 = y2 * z;
+	y2 = y2 * x;
+	y2 = y2 + x;
+
+	float ysin2 = poly_mask ? y2 : 0.f;
+	float ysin1 = poly_mask ? 0.f : y;
+	y2 = y2 - ysin2;
+	y = y - ysin1;
+
+	xmm1 = ysin1 + ysin2;
+	xmm2 = y + y2;
+
+	s = bits_float(float_bits(xmm1) ^ sign_bit_sin);
+	c = bits_float(float_bits(xmm2) ^ sign_bit_cos);
+}
+
+static void normal32_scalar(float *out, uint64_t block, uint64_t counter, uint32_t channel, uint64_t seed)
+{
+	for (uint32_t lane=0; lane<8; lane++)
+	{
+		uint32_t ctr[4] = {(uint32_t)(block * 8 + lane), channel, (uint32_t)counter, (uint32_t)(counter >> 32)};
+		uint32_t key[2] = {(uint32_t)seed, (uint32_t)(seed >> 32)};
+
+		philox4x32_10(ctr, key);
+
+		float r0 = std::sqrt(-2.f * log_cephes(uniform(ctr[0])));
+		float theta0 = 2.f * (float)M_PI * uniform(ctr[1]);
+		float r1 = std::sqrt(-2.f * log_cephes(uniform(ctr[2])));
+		float theta1 = 2.f * (float)M_PI * uniform(ctr[3]);
+
+		float s0, c0, s1, c1;
+		sincos_cephes(theta0, s0, c0);
+		sincos_cephes(theta1, s1, c1);
+
+		out[lane] = r0 * c0;
+		out[8 + lane] = r0 * s0;
+		out[16 + lane] = r1 * c1;
+		out[24 + lane] = r1 * s1;
+	}
+}
+
+XLIBS_EXACT_FP_END
+
+static void transpose16_scalar(float *out, long int ldo, const float *in, long int ldi, long int nrow, long int ncol, bool stream)
+{
+	for (long int i=0; i<nrow; i++)
+	{
+		for (long int j=0; j<ncol; j++)
+		{
+			out[j * ldo + i] = in[i * ldi + j];
+		}
+	}
+}
+
+static const SIMDKernels scalar_kernels = {
+	reduce_scalar,
+	accumulate_mean_scalar,
+	accumulate_mean_var_scalar,
+	accumulate_mean_var2_scalar,
+	remove_baseline_scalar,
+	remove_baseline_reduce_scalar,
+	scale_scalar,
+	accumulate_mean_var3_scalar,
+	normalize2_scalar,
+	accumulate_moments_scalar,
+	kadane2D_scalar,
+	kadane2D_pn_scalar,
+	boxcar_max_scalar,
+	harmonic_sum_scalar,
+	phase_bins_scalar,
+	gather_scalar,
+	normal32_scalar,
+	transpose16_scalar
+};
+
+const SIMDKernels & PulsarX::get_scalar_kernels()
+{
+	return scalar_kernels;
+}
+
+static SIMDLevel detect_simd_level()
+{
+	SIMDLevel level = SIMD_SCALAR;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+	{
+		level = SIMD_AVX2;
+		if (__builtin_cpu_supports("avx512f")) level = SIMD_AVX512;
+	}
+#endif
+
+	const char *env = std::getenv("XLIBS_SIMD");
+	if (env != NULL)
+	{
+		if (strcmp(env, "scalar") == 0)
+			level = std::min(level, SIMD_SCALAR);
+		else if (strcmp(env, "avx2") == 0)
+			level = std::min(level, SIMD_AVX2);
+		else if (strcmp(env, "avx512") != 0)
+			BOOST_LOG_TRIVIAL(warning)<<"unknown XLIBS_SIMD="<<env<<", expected scalar, avx2 or avx512";
+	}
+
+	return level;
+}
+
+static const SIMDKernels * select_kernels(SIMDLevel level)
+{
+	switch (level)
+	{
+	case SIMD_AVX512: return &get_avx512_kernels();
+	case SIMD_AVX2: return &get_avx2_kernels();
+	default: return &scalar_kernels;
+	}
+}
+
+/* function statics, the kernels may be needed during static initialization */
+static std::atomic<const SIMDKernels *> & current_kernels()
+{
+	static std::atomic<const SIMDKernels *> kernels(select_kernels(get_simd_level()));
+	return kernels;
+}
+
+SIMDLevel PulsarX::get_simd_level()
+{
+	static SIMDLevel level = detect_simd_level();
+	return level;
+}
+
+void PulsarX::set_simd_level(SIMDLevel level)
+{
+	level = std::min(level, get_simd_level());
+	current_kernels().store(select_kernels(level));
+
+	BOOST_LOG_TRIVIAL(debug)<<"vector kernels "<<get_simd_name(level);
+}
+
+const char * PulsarX::get_simd_name(SIMDLevel level)
+{
+	switch (level)
+	{
+	case SIMD_AVX512: return "avx512";
+	case SIMD_AVX2: return "avx2";
+	default: return "scalar";
+	}
+}
+
+const SIMDKernels & PulsarX::simd_kernels()
+{
+	return *current_kernels().load(std::memory_order_relaxed);
+}
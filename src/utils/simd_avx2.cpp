@@ -0,0 +1,363 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 19:07:48
+ * @modify date 2026-10-19 19:07:48
+ * @desc [description]
+ */
+
+/* built with -mavx2 -mfma, only reached after the cpu check in simd.cpp */
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits>
+#include <cmath>
+#include <immintrin.h>
+
+#include "simd.h"
+#include "noisefill.h"
+
+/**
+ * the inline kernels get internal linkage here, so that the linker can not
+ * pick these AVX2 copies for the other translation units of the library
+ */
+namespace
+{
+namespace kernels
+{
+#include "avx2.h"
+}
+XLIBS_EXACT_FP_BEGIN
+namespace mathfun
+{
+#include "avx_mathfun.h"
+}
+XLIBS_EXACT_FP_END
+}
+
+using namespace PulsarX;
+namespace avx2 = kernels::PulsarX;
+
+static inline bool is_aligned(const void *p, size_t alignment)
+{
+	return ((uintptr_t)p & (alignment - 1)) == 0;
+}
+
+static float reduce_avx2(const float *data, size_t size)
+{
+	if (!is_aligned(data, 32)) return get_scalar_kernels().reduce(data, size);
+
+	size_t n = size / 8 * 8;
+	return avx2::reduce(data, n) + get_scalar_kernels().reduce(data + n, size - n);
+}
+
+static void accumulate_mean_avx2(double *mean, double *mean_scale, double scale, const float *data, size_t size)
+{
+	size_t n = 0;
+	if (is_aligned(mean, 32) && is_aligned(mean_scale, 32) && is_aligned(data, 16))
+	{
+		n = size / 4 * 4;
+		avx2::accumulate_mean(mean, mean_scale, scale, data, n);
+	}
+	get_scalar_kernels().accumulate_mean(mean + n, mean_scale + n, scale, data + n, size - n);
+}
+
+static void accumulate_mean_var_avx2(double *mean, double *var, const float *data, size_t size)
+{
+	size_t n = 0;
+	if (is_aligned(mean, 32) && is_aligned(var, 32) && is_aligned(data, 16))
+	{
+		n = size / 4 * 4;
+		avx2::accumulate_mean_var(mean, var, data, n);
+	}
+	get_scalar_kernels().accumulate_mean_var(mean + n, var + n, data + n, size - n);
+}
+
+static void accumulate_mean_var2_avx2(double &mean, double &var, const float *data, size_t size)
+{
+	if (!is_aligned(data, 16)) return get_scalar_kernels().accumulate_mean_var2(mean, var, data, size);
+
+	size_t n = size / 4 * 4;
+	avx2::accumulate_mean_var2(mean, var, data, n);
+
+	double tail_mean = 0., tail_var = 0.;
+	get_scalar_kernels().accumulate_mean_var2(tail_mean, tail_var, data + n, size - n);
+	mean += tail_mean;
+	var += tail_var;
+}
+
+static void remove_baseline_avx2(float *data_out, const float *data_in, const float *a, const float *b, float s, size_t size)
+{
+	size_t n = 0;
+	if (is_aligned(data_out, 32) && is_aligned(data_in, 32) && is_aligned(a, 32) && is_aligned(b, 32))
+	{
+		n = size / 8 * 8;
+		avx2::remove_baseline(data_out, data_in, a, b, s, n);
+	}
+	get_scalar_kernels().remove_baseline(data_out + n, data_in + n, a + n, b + n, s, size - n);
+}
+
+static float remove_baseline_reduce_avx2(float *data_out, const float *data_in, const float *a, const float *b, float s, size_t size)
+{
+	if (!(is_aligned(data_out, 32) && is_aligned(data_in, 32) && is_aligned(a, 32) && is_aligned(b, 32)))
+		return get_scalar_kernels().remove_baseline_reduce(data_out, data_in, a, b, s, size);
+
+	size_t n = size / 8 * 8;
+	float sum = avx2::remove_baseline_reduce(data_out, data_in, a, b, s, n);
+	return sum + get_scalar_kernels().remove_baseline_reduce(data_out + n, data_in + n, a + n, b + n, s, size - n);
+}
+
+static void scale_avx2(unsigned char *data_out, const float *data_in, float scl, float offs, unsigned int nbits, size_t size)
+{
+	size_t n = 0;
+	if (is_aligned(data_in, 32))
+	{
+		n = size / 8 * 8;
+		avx2::scale(data_out, data_in, scl, offs, nbits, n);
+	}
+	get_scalar_kernels().scale(data_out + n * nbits / 8, data_in + n, scl, offs, nbits, size - n);
+}
+
+static void accumulate_mean_var3_avx2(float &mean, float &var, const float *data, size_t size)
+{
+	if (!is_aligned(data, 32)) return get_scalar_kernels().accumulate_mean_var3(mean, var, data, size);
+
+	size_t n = size / 8 * 8;
+	avx2::accumulate_mean_var3(mean, var, data, n);
+
+	float tail_mean = 0., tail_var = 0.;
+	get_scalar_kernels().accumulate_mean_var3(tail_mean, tail_var, data + n, size - n);
+	mean += tail_mean;
+	var += tail_var;
+}
+
+static void normalize2_avx2(float *data_out, const float *data_in, const float *mean, const float *stddev_inv, size_t size)
+{
+	size_t n = 0;
+	if (is_aligned(data_out, 32) && is_aligned(data_in, 32) && is_aligned(mean, 32) && is_aligned(stddev_inv, 32))
+	{
+		n = size / 8 * 8;
+		avx2::normalize2(data_out, data_in, mean, stddev_inv, n);
+	}
+	get_scalar_kernels().normalize2(data_out + n, data_in + n, mean + n, stddev_inv + n, size - n);
+}
+
+static void accumulate_moments_avx2(double *mean1, double *mean2, double *mean3, double *mean4, double *corr1, double *last_data, const float *data, size_t size)
+{
+	size_t n = 0;
+	if (is_aligned(mean1, 32) && is_aligned(mean2, 32) && is_aligned(mean3, 32) && is_aligned(mean4, 32) && is_aligned(corr1, 32) && is_aligned(last_data, 32) && is_aligned(data, 16))
+	{
+		n = size / 4 * 4;
+		avx2::accumulate_mean1_mean2_mean3_mean4_corr1(mean1, mean2, mean3, mean4, corr1, last_data, data, n);
+	}
+	get_scalar_kernels().accumulate_moments(mean1 + n, mean2 + n, mean3 + n, mean4 + n, corr1 + n, last_data + n, data + n, size - n);
+}
+
+/* the rows are not split, odd numbers of columns go to the scalar code */
+static void kadane2D_avx2(float *maxSum, int *start, int *end, const float *arr, size_t nrow, size_t ncol)
+{
+	if (ncol % 8 != 0 || !(is_aligned(maxSum, 32) && is_aligned(start, 32) && is_aligned(end, 32) && is_aligned(arr, 32)))
+		return get_scalar_kernels().kadane2D(maxSum, start, end, arr, nrow, ncol);
+
+	avx2::kadane2D(maxSum, start, end, arr, nrow, ncol);
+}
+
+static void kadane2D_pn_avx2(float *maxSum_p, int *start_p, int *end_p, float *maxSum_n, int *start_n, int *end_n, const float *arr, size_t nrow, size_t ncol, size_t ld)
+{
+	if (ncol % 8 != 0 || ld % 8 != 0 || !(is_aligned(maxSum_p, 32) && is_aligned(start_p, 32) && is_aligned(end_p, 32) && is_aligned(maxSum_n, 32) && is_aligned(start_n, 32) && is_aligned(end_n, 32) && is_aligned(arr, 32)))
+		return get_scalar_kernels().kadane2D_pn(maxSum_p, start_p, end_p, maxSum_n, start_n, end_n, arr, nrow, ncol, ld);
+
+	avx2::kadane2D_pn(maxSum_p, start_p, end_p, maxSum_n, start_n, end_n, arr, nrow, ncol, ld);
+}
+
+static void boxcar_max_avx2(float *best, int *bestw, const float *a, size_t size, int w, float scl)
+{
+	avx2::boxcar_max(best, bestw, a, size, w, scl);
+}
+
+static void harmonic_sum_avx2(float *sum, const float *power, size_t size, int nh)
+{
+	avx2::harmonic_sum(sum, power, size, nh);
+}
+
+static void phase_bins_avx2(int *bins, double phi0, double dphi, size_t size, int nbin)
+{
+	avx2::phase_bins(bins, phi0, dphi, size, nbin);
+}
+
+static void gather_avx2(float *out, const float *in, const int *idx, size_t size)
+{
+	avx2::gather(out, in, idx, size);
+}
+
+static inline void mulhilo_epu32(__m256i a, __m256i b, __m256i &hi, __m256i &lo)
+{
+	__m256i pe = _mm256_mul_epu32(a, b);
+	__m256i po = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+	lo = _mm256_blend_epi32(pe, _mm256_slli_epi64(po, 32), 0xAA);
+	hi = _mm256_blend_epi32(_mm256_srli_epi64(pe, 32), po, 0xAA);
+}
+
+XLIBS_EXACT_FP_BEGIN
+
+static inline __m256 uniform(__m256i x)
+{
+	__m256 avx_scale = _mm256_set1_ps(1.f / 16777216.f);
+	__m256 avx_half = _mm256_set1_ps(0.5f / 16777216.f);
+	return _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), avx_scale), avx_half);
+}
+
+/* the 8 lanes of normal32_scalar at once */
+static void normal32_avx2(float *out, uint64_t block, uint64_t counter, uint32_t channel, uint64_t seed)
+{
+	__m256i c0 = _mm256_add_epi32(_mm256_set1_epi32((uint32_t)(block * 8)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	__m256i c1 = _mm256_set1_epi32(channel);
+	__m256i c2 = _mm256_set1_epi32((uint32_t)counter);
+	__m256i c3 = _mm256_set1_epi32((uint32_t)(counter >> 32));
+	__m256i k0 = _mm256_set1_epi32((uint32_t)seed);
+	__m256i k1 = _mm256_set1_epi32((uint32_t)(seed >> 32));
+
+	__m256i m0 = _mm256_set1_epi32(PHILOX_M0);
+	__m256i m1 = _mm256_set1_epi32(PHILOX_M1);
+	__m256i w0 = _mm256_set1_epi32(PHILOX_W0);
+	__m256i w1 = _mm256_set1_epi32(PHILOX_W1);
+
+	for (int r=0; r<10; r++)
+	{
+		__m256i hi0, lo0, hi1, lo1;
+		mulhilo_epu32(c0, m0, hi0, lo0);
+		mulhilo_epu32(c2, m1, hi1, lo1);
+		c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), k0);
+		c1 = lo1;
+		c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), k1);
+		c3 = lo0;
+		k0 = _mm256_add_epi32(k0, w0);
+		k1 = _mm256_add_epi32(k1, w1);
+	}
+
+	__m256 avx_m2 = _mm256_set1_ps(-2.f);
+	__m256 avx_2pi = _mm256_set1_ps(2.f * (float)M_PI);
+
+	__m256 r0 = _mm256_sqrt_ps(_mm256_mul_ps(avx_m2, mathfun::log256_ps(uniform(c0))));
+	__m256 theta0 = _mm256_mul_ps(avx_2pi, uniform(c1));
+	__m256 r1 = _mm256_sqrt_ps(_mm256_mul_ps(avx_m2, mathfun::log256_ps(uniform(c2))));
+	__m256 theta1 = _mm256_mul_ps(avx_2pi, uniform(c3));
+
+	__m256 s0, cs0, s1, cs1;
+	mathfun::sincos256_ps(theta0, &s0, &cs0);
+	mathfun::sincos256_ps(theta1, &s1, &cs1);
+
+	_mm256_storeu_ps(out, _mm256_mul_ps(r0, cs0));
+	_mm256_storeu_ps(out + 8, _mm256_mul_ps(r0, s0));
+	_mm256_storeu_ps(out + 16, _mm256_mul_ps(r1, cs1));
+	_mm256_storeu_ps(out + 24, _mm256_mul_ps(r1, s1));
+}
+
+XLIBS_EXACT_FP_END
+
+static inline void transpose_regs(__m256 t[8], const float *in, long int ldi)
+{
+	__m256 r[8];
+	for (int k=0; k<8; k++) r[k] = _mm256_loadu_ps(in + k * ldi);
+
+	for (int k=0; k<4; k++)
+	{
+		t[2 * k] = _mm256_unpacklo_ps(r[2 * k], r[2 * k + 1]);
+		t[2 * k + 1] = _mm256_unpackhi_ps(r[2 * k], r[2 * k + 1]);
+	}
+	for (int k=0; k<2; k++)
+	{
+		r[4 * k + 0] = _mm256_shuffle_ps(t[4 * k + 0], t[4 * k + 2], _MM_SHUFFLE(1,0,1,0));
+		r[4 * k + 1] = _mm256_shuffle_ps(t[4 * k + 0], t[4 * k + 2], _MM_SHUFFLE(3,2,3,2));
+		r[4 * k + 2] = _mm256_shuffle_ps(t[4 * k + 1], t[4 * k + 3], _MM_SHUFFLE(1,0,1,0));
+		r[4 * k + 3] = _mm256_shuffle_ps(t[4 * k + 1], t[4 * k + 3], _MM_SHUFFLE(3,2,3,2));
+	}
+	for (int k=0; k<4; k++)
+	{
+		t[k] = _mm256_permute2f128_ps(r[k], r[k + 4], 0x20);
+		t[k + 4] = _mm256_permute2f128_ps(r[k], r[k + 4], 0x31);
+	}
+}
+
+template <bool stream>
+static inline void store_row(float *out, __m256 v)
+{
+	if (stream)
+		_mm256_stream_ps(out, v);
+	else
+		_mm256_storeu_ps(out, v);
+}
+
+/**
+ * @brief 16x16 as four 8x8 blocks, so that each input and output row is one full 64 byte line
+ */
+template <bool stream>
+static inline void transpose_kernel(float *out, long int ldo, const float *in, long int ldi)
+{
+	__m256 a[8], b[8];
+	for (int h=0; h<2; h++)
+	{
+		transpose_regs(a, in + h * 8, ldi);
+		transpose_regs(b, in + 8 * ldi + h * 8, ldi);
+
+		for (int k=0; k<8; k++)
+		{
+			store_row<stream>(out + (h * 8 + k) * ldo, a[k]);
+			store_row<stream>(out + (h * 8 + k) * ldo + 8, b[k]);
+		}
+	}
+}
+
+/* strips of input rows are the outer loop, so that the input is read sequentially */
+template <bool stream>
+static inline void transpose16_tiles(float *out, long int ldo, const float *in, long int ldi, long int nrow, long int ncol)
+{
+	for (long int i=0; i<nrow; i+=16)
+	{
+		for (long int j=0; j<ncol; j+=16)
+		{
+			transpose_kernel<stream>(out + j * ldo + i, ldo, in + i * ldi + j, ldi);
+		}
+	}
+}
+
+static void transpose16_avx2(float *out, long int ldo, const float *in, long int ldi, long int nrow, long int ncol, bool stream)
+{
+	if (stream)
+	{
+		transpose16_tiles<true>(out, ldo, in, ldi, nrow, ncol);
+		_mm_sfence();
+	}
+	else
+	{
+		transpose16_tiles<false>(out, ldo, in, ldi, nrow, ncol);
+	}
+}
+
+static const SIMDKernels avx2_kernels = {
+	reduce_avx2,
+	accumulate_mean_avx2,
+	accumulate_mean_var_avx2,
+	accumulate_mean_var2_avx2,
+	remove_baseline_avx2,
+	remove_baseline_reduce_avx2,
+	scale_avx2,
+	accumulate_mean_var3_avx2,
+	normalize2_avx2,
+	accumulate_moments_avx2,
+	kadane2D_avx2,
+	kadane2D_pn_avx2,
+	boxcar_max_avx2,
+	harmonic_sum_avx2,
+	phase_bins_avx2,
+	gather_avx2,
+	normal32_avx2,
+	transpose16_avx2
+};
+
+const SIMDKernels & PulsarX::get_avx2_kernels()
+{
+	return avx2_kernels;
+}
@@ -0,0 +1,401 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 20:12:31
+ * @modify date 2026-10-19 20:12:31
+ * @desc [description]
+ */
+
+/* built with -mavx512f -mavx2 -mfma, only reached after the cpu check in simd.cpp.
+ * AVX-512F only, the tails are done with masked loads and stores */
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <limits>
+#include <cmath>
+#include <vector>
+
+/* the unmasked intrinsics of gcc < 13 pass _mm512_undefined_*() as the unused source,
+ * which -Wuninitialized reports at each use (gcc bug 105593) */
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ < 13)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#else
+#include <immintrin.h>
+#endif
+
+#include "simd.h"
+
+using namespace PulsarX;
+
+static inline __mmask16 tail_mask16(size_t n)
+{
+	return n >= 16 ? 0xFFFF : (__mmask16)((1U << n) - 1);
+}
+
+static inline __mmask8 tail_mask8(size_t n)
+{
+	return n >= 8 ? 0xFF : (__mmask8)((1U << n) - 1);
+}
+
+/* 8 floats converted to double */
+static inline __m512d load_pd_from_ps(const float *data, __mmask8 k)
+{
+	__m512 tmp = _mm512_maskz_loadu_ps(k, data);
+	return _mm512_cvtps_pd(_mm512_castps512_ps256(tmp));
+}
+
+static float reduce_avx512(const float *data, size_t size)
+{
+	__m512 avx_acc = _mm512_setzero_ps();
+	for (size_t i=0; i<size; i+=16)
+	{
+		__m512 avx_data = _mm512_maskz_loadu_ps(tail_mask16(size - i), data + i);
+		avx_acc = _mm512_add_ps(avx_acc, avx_data);
+	}
+
+	return _mm512_reduce_add_ps(avx_acc);
+}
+
+static void accumulate_mean_avx512(double *mean, double *mean_scale, double scale, const float *data, size_t size)
+{
+	__m512d avx_scale = _mm512_set1_pd(scale);
+	for (size_t i=0; i<size; i+=8)
+	{
+		__mmask8 k = tail_mask8(size - i);
+		__m512d avx_data = load_pd_from_ps(data + i, k);
+		__m512d avx_mean = _mm512_maskz_loadu_pd(k, mean + i);
+		__m512d avx_mean_scale = _mm512_maskz_loadu_pd(k, mean_scale + i);
+
+		avx_mean = _mm512_add_pd(avx_data, avx_mean);
+		avx_mean_scale = _mm512_fmadd_pd(avx_data, avx_scale, avx_mean_scale);
+
+		_mm512_mask_storeu_pd(mean + i, k, avx_mean);
+		_mm512_mask_storeu_pd(mean_scale + i, k, avx_mean_scale);
+	}
+}
+
+static void accumulate_mean_var_avx512(double *mean, double *var, const float *data, size_t size)
+{
+	for (size_t i=0; i<size; i+=8)
+	{
+		__mmask8 k = tail_mask8(size - i);
+		__m512d avx_data = load_pd_from_ps(data + i, k);
+		__m512d avx_mean = _mm512_maskz_loadu_pd(k, mean + i);
+		__m512d avx_var = _mm512_maskz_loadu_pd(k, var + i);
+
+		avx_mean = _mm512_add_pd(avx_mean, avx_data);
+		avx_var = _mm512_fmadd_pd(avx_data, avx_data, avx_var);
+
+		_mm512_mask_storeu_pd(mean + i, k, avx_mean);
+		_mm512_mask_storeu_pd(var + i, k, avx_var);
+	}
+}
+
+static void accumulate_mean_var2_avx512(double &mean, double &var, const float *data, size_t size)
+{
+	__m512d avx_mean = _mm512_setzero_pd();
+	__m512d avx_var = _mm512_setzero_pd();
+	for (size_t i=0; i<size; i+=8)
+	{
+		__m512d avx_data = load_pd_from_ps(data + i, tail_mask8(size - i));
+		avx_mean = _mm512_add_pd(avx_data, avx_mean);
+		avx_var = _mm512_fmadd_pd(avx_data, avx_data, avx_var);
+	}
+
+	mean = _mm512_reduce_add_pd(avx_mean);
+	var = _mm512_reduce_add_pd(avx_var);
+}
+
+static void accumulate_mean_var3_avx512(float &mean, float &var, const float *data, size_t size)
+{
+	__m512 avx_mean = _mm512_setzero_ps();
+	__m512 avx_var = _mm512_setzero_ps();
+	for (size_t i=0; i<size; i+=16)
+	{
+		__m512 avx_data = _mm512_maskz_loadu_ps(tail_mask16(size - i), data + i);
+		avx_mean = _mm512_add_ps(avx_data, avx_mean);
+		avx_var = _mm512_fmadd_ps(avx_data, avx_data, avx_var);
+	}
+
+	mean = _mm512_reduce_add_ps(avx_mean);
+	var = _mm512_reduce_add_ps(avx_var);
+}
+
+static void normalize2_avx512(float *data_out, const float *data_in, const float *mean, const float *stddev_inv, size_t size)
+{
+	for (size_t i=0; i<size; i+=16)
+	{
+		__mmask16 k = tail_mask16(size - i);
+		__m512 avx_data_in = _mm512_maskz_loadu_ps(k, data_in + i);
+		__m512 avx_mean = _mm512_maskz_loadu_ps(k, mean + i);
+		__m512 avx_stddev_inv = _mm512_maskz_loadu_ps(k, stddev_inv + i);
+
+		__m512 avx_data_out = _mm512_mul_ps(_mm512_sub_ps(avx_data_in, avx_mean), avx_stddev_inv);
+		_mm512_mask_storeu_ps(data_out + i, k, avx_data_out);
+	}
+}
+
+static void remove_baseline_avx512(float *data_out, const float *data_in, const float *a, const float *b, float s, size_t size)
+{
+	__m512 avx_s = _mm512_set1_ps(s);
+	for (size_t i=0; i<size; i+=16)
+	{
+		__mmask16 k = tail_mask16(size - i);
+		__m512 avx_data_in = _mm512_maskz_loadu_ps(k, data_in + i);
+		__m512 avx_a = _mm512_maskz_loadu_ps(k, a + i);
+		__m512 avx_b = _mm512_maskz_loadu_ps(k, b + i);
+
+		__m512 avx_data_out = _mm512_sub_ps(avx_data_in, _mm512_add_ps(_mm512_mul_ps(avx_a, avx_s), avx_b));
+		_mm512_mask_storeu_ps(data_out + i, k, avx_data_out);
+	}
+}
+
+static float remove_baseline_reduce_avx512(float *data_out, const float *data_in, const float *a, const float *b, float s, size_t size)
+{
+	__m512 avx_acc = _mm512_setzero_ps();
+	__m512 avx_s = _mm512_set1_ps(s);
+	for (size_t i=0; i<size; i+=16)
+	{
+		__mmask16 k = tail_mask16(size - i);
+		__m512 avx_data_in = _mm512_maskz_loadu_ps(k, data_in + i);
+		__m512 avx_a = _mm512_maskz_loadu_ps(k, a + i);
+		__m512 avx_b = _mm512_maskz_loadu_ps(k, b + i);
+
+		__m512 avx_data_out = _mm512_sub_ps(avx_data_in, _mm512_add_ps(_mm512_mul_ps(avx_a, avx_s), avx_b));
+		_mm512_mask_storeu_ps(data_out + i, k, avx_data_out);
+
+		/* the masked lanes are zero */
+		avx_acc = _mm512_fmadd_ps(avx_data_out, avx_data_out, avx_acc);
+	}
+
+	return _mm512_reduce_add_ps(avx_acc);
+}
+
+/**
+ * @brief 16 samples per iteration, each lane is shifted to its bit position in the output byte
+ * and the lanes of one byte are merged with or
+ */
+static void scale_avx512(unsigned char *data_out, const float *data_in, float scl, float offs, unsigned int nbits, size_t size)
+{
+	if (nbits != 8 && nbits != 4 && nbits != 2 && nbits != 1)
+	{
+		std::cerr<<"Error: data type unsupported"<<std::endl;
+		exit(-1);
+	}
+
+	__m512 avx_scl = _mm512_set1_ps(scl);
+	__m512 avx_offs = _mm512_set1_ps(offs);
+	__m512 avx_min = _mm512_setzero_ps();
+	__m512 avx_max = _mm512_set1_ps(std::pow(2, nbits) - 1.);
+
+	size_t nsamp_per_byte = 8 / nbits;
+	__m512i avx_count = _mm512_setzero_si512();
+	switch (nbits)
+	{
+	case 4: avx_count = _mm512_set_epi32(4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0); break;
+	case 2: avx_count = _mm512_set_epi32(6, 4, 2, 0, 6, 4, 2, 0, 6, 4, 2, 0, 6, 4, 2, 0); break;
+	default: break;
+	}
+
+	for (size_t i=0; i<size; i+=16)
+	{
+		size_t nsamp = std::min((size_t)16, size - i);
+		__m512 avx_data = _mm512_maskz_loadu_ps(tail_mask16(nsamp), data_in + i);
+		avx_data = _mm512_fmadd_ps(avx_data, avx_scl, avx_offs);
+		avx_data = _mm512_roundscale_ps(avx_data, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		avx_data = _mm512_min_ps(_mm512_max_ps(avx_data, avx_min), avx_max);
+		__m512i avx_data_out = _mm512_cvtps_epi32(avx_data);
+
+		unsigned char *out = data_out + i / nsamp_per_byte;
+		size_t nbytes = nsamp / nsamp_per_byte;
+		switch (nbits)
+		{
+		case 8:
+			_mm512_mask_cvtepi32_storeu_epi8(out, tail_mask16(nbytes), avx_data_out);
+			break;
+		case 4:
+		{
+			avx_data_out = _mm512_sllv_epi32(avx_data_out, avx_count);
+			avx_data_out = _mm512_or_si512(avx_data_out, _mm512_srli_epi64(avx_data_out, 32));
+			__m128i bytes = _mm512_cvtepi64_epi8(avx_data_out);
+			memcpy(out, &bytes, nbytes);
+		};break;
+		case 2:
+		{
+			avx_data_out = _mm512_sllv_epi32(avx_data_out, avx_count);
+			avx_data_out = _mm512_or_si512(avx_data_out, _mm512_srli_epi64(avx_data_out, 32));
+			avx_data_out = _mm512_or_si512(avx_data_out, _mm512_shuffle_epi32(avx_data_out, _MM_PERM_BADC));
+			avx_data_out = _mm512_maskz_compress_epi64(0x55, avx_data_out);
+			__m128i bytes = _mm512_cvtepi64_epi8(avx_data_out);
+			memcpy(out, &bytes, nbytes);
+		};break;
+		case 1:
+		{
+			/* the values are 0 or 1, the mask is the packed bits */
+			__mmask16 bits = _mm512_test_epi32_mask(avx_data_out, avx_data_out);
+			memcpy(out, &bits, nbytes);
+		};break;
+		}
+	}
+}
+
+/**
+ * @brief same as PulsarX::kadane2D with 16 columns per vector, any number of columns
+ */
+static void kadane2D_avx512(float *maxSum, int *start, int *end, const float *arr, size_t nrow, size_t ncol)
+{
+	std::vector<float> sum(ncol, 0.);
+	std::vector<int> local_start(ncol, 0);
+	for (size_t j=0; j<ncol; j++)
+	{
+		maxSum[j] = -std::numeric_limits<float>::infinity();
+		start[j] = 0;
+		end[j] = -1;
+	}
+
+	__m512 avx_zero = _mm512_setzero_ps();
+
+	for (size_t i=0; i<nrow; i++)
+	{
+		__m512i avx_i = _mm512_set1_epi32(i);
+		__m512i avx_i1 = _mm512_set1_epi32(i + 1);
+
+		for (size_t j=0; j<ncol; j+=16)
+		{
+			__mmask16 k = tail_mask16(ncol - j);
+			__m512 avx_arr = _mm512_maskz_loadu_ps(k, arr + i * ncol + j);
+			__m512 avx_sum = _mm512_maskz_loadu_ps(k, sum.data() + j);
+			__m512 avx_maxSum = _mm512_maskz_loadu_ps(k, maxSum + j);
+			__m512i avx_local_start = _mm512_maskz_loadu_epi32(k, local_start.data() + j);
+			__m512i avx_start = _mm512_maskz_loadu_epi32(k, start + j);
+			__m512i avx_end = _mm512_maskz_loadu_epi32(k, end + j);
+
+			avx_sum = _mm512_add_ps(avx_arr, avx_sum);
+
+			__mmask16 mask1 = _mm512_cmp_ps_mask(avx_sum, avx_zero, _CMP_LT_OS);
+			__mmask16 mask2 = _mm512_cmp_ps_mask(avx_sum, avx_zero, _CMP_GE_OS);
+			__mmask16 mask3 = _mm512_cmp_ps_mask(avx_sum, avx_maxSum, _CMP_GT_OS);
+			__mmask16 mask4 = mask3 & mask2;
+
+			avx_sum = _mm512_mask_blend_ps(mask1, avx_sum, avx_zero);
+			avx_local_start = _mm512_mask_blend_epi32(mask1, avx_local_start, avx_i1);
+
+			avx_maxSum = _mm512_mask_blend_ps(mask4, avx_maxSum, avx_sum);
+			avx_start = _mm512_mask_blend_epi32(mask4, avx_start, avx_local_start);
+			avx_end = _mm512_mask_blend_epi32(mask4, avx_end, avx_i);
+
+			_mm512_mask_storeu_ps(sum.data() + j, k, avx_sum);
+			_mm512_mask_storeu_ps(maxSum + j, k, avx_maxSum);
+			_mm512_mask_storeu_epi32(local_start.data() + j, k, avx_local_start);
+			_mm512_mask_storeu_epi32(start + j, k, avx_start);
+			_mm512_mask_storeu_epi32(end + j, k, avx_end);
+		}
+	}
+
+	for (size_t j=0; j<ncol; j++)
+	{
+		if (end[j] == -1)
+		{
+			maxSum[j] = arr[j];
+			start[j] = 0;
+			end[j] = 0;
+		}
+	}
+}
+
+template <bool stream>
+static inline void transpose_kernel(float *out, long int ldo, const float *in, long int ldi)
+{
+	__m512 r[16], t[16];
+	for (int k=0; k<16; k++) r[k] = _mm512_loadu_ps(in + k * ldi);
+
+	for (int k=0; k<8; k++)
+	{
+		t[2 * k] = _mm512_unpacklo_ps(r[2 * k], r[2 * k + 1]);
+		t[2 * k + 1] = _mm512_unpackhi_ps(r[2 * k], r[2 * k + 1]);
+	}
+	for (int k=0; k<4; k++)
+	{
+		r[4 * k + 0] = _mm512_shuffle_ps(t[4 * k + 0], t[4 * k + 2], 0x44);
+		r[4 * k + 1] = _mm512_shuffle_ps(t[4 * k + 0], t[4 * k + 2], 0xEE);
+		r[4 * k + 2] = _mm512_shuffle_ps(t[4 * k + 1], t[4 * k + 3], 0x44);
+		r[4 * k + 3] = _mm512_shuffle_ps(t[4 * k + 1], t[4 * k + 3], 0xEE);
+	}
+	for (int k=0; k<4; k++)
+	{
+		t[k] = _mm512_shuffle_f32x4(r[k], r[k + 4], 0x88);
+		t[k + 4] = _mm512_shuffle_f32x4(r[k], r[k + 4], 0xDD);
+		t[k + 8] = _mm512_shuffle_f32x4(r[k + 8], r[k + 12], 0x88);
+		t[k + 12] = _mm512_shuffle_f32x4(r[k + 8], r[k + 12], 0xDD);
+	}
+	for (int k=0; k<8; k++)
+	{
+		r[k] = _mm512_shuffle_f32x4(t[k], t[k + 8], 0x88);
+		r[k + 8] = _mm512_shuffle_f32x4(t[k], t[k + 8], 0xDD);
+	}
+
+	for (int k=0; k<16; k++)
+	{
+		if (stream)
+			_mm512_stream_ps(out + k * ldo, r[k]);
+		else
+			_mm512_storeu_ps(out + k * ldo, r[k]);
+	}
+}
+
+/* strips of input rows are the outer loop, so that the input is read sequentially */
+template <bool stream>
+static inline void transpose16_tiles(float *out, long int ldo, const float *in, long int ldi, long int nrow, long int ncol)
+{
+	for (long int i=0; i<nrow; i+=16)
+	{
+		for (long int j=0; j<ncol; j+=16)
+		{
+			transpose_kernel<stream>(out + j * ldo + i, ldo, in + i * ldi + j, ldi);
+		}
+	}
+}
+
+static void transpose16_avx512(float *out, long int ldo, const float *in, long int ldi, long int nrow, long int ncol, bool stream)
+{
+	if (stream)
+	{
+		transpose16_tiles<true>(out, ldo, in, ldi, nrow, ncol);
+		_mm_sfence();
+	}
+	else
+	{
+		transpose16_tiles<false>(out, ldo, in, ldi, nrow, ncol);
+	}
+}
+
+/* the entries without an AVX-512 version keep the AVX2 kernels */
+static SIMDKernels make_avx512_kernels()
+{
+	SIMDKernels kernels = get_avx2_kernels();
+
+	kernels.reduce = reduce_avx512;
+	kernels.accumulate_mean = accumulate_mean_avx512;
+	kernels.accumulate_mean_var = accumulate_mean_var_avx512;
+	kernels.accumulate_mean_var2 = accumulate_mean_var2_avx512;
+	kernels.remove_baseline = remove_baseline_avx512;
+	kernels.remove_baseline_reduce = remove_baseline_reduce_avx512;
+	kernels.scale = scale_avx512;
+	kernels.accumulate_mean_var3 = accumulate_mean_var3_avx512;
+	kernels.normalize2 = normalize2_avx512;
+	kernels.kadane2D = kadane2D_avx512;
+	kernels.transpose16 = transpose16_avx512;
+
+	return kernels;
+}
+
+const SIMDKernels & PulsarX::get_avx512_kernels()
+{
+	static const SIMDKernels avx512_kernels = make_avx512_kernels();
+	return avx512_kernels;
+}
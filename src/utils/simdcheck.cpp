@@ -0,0 +1,267 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 19:06:12
+ * @modify date 2026-10-19 19:06:12
+ * @desc [compare the AVX2 and AVX-512 kernels with the scalar ones, run by make check]
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "simd.h"
+
+using namespace std;
+using namespace PulsarX;
+
+/* defined by the applications, libxutils needs it */
+unsigned int num_threads = 1;
+
+/* element offsets from a 64 byte boundary, so that every alignment is met */
+static const size_t offsets[] = {0, 1, 3, 4, 7};
+static const size_t maxsize = 1031;
+
+static long int nfail = 0;
+
+/* aligned storage with room for the offsets */
+template <typename T>
+struct Buffer
+{
+	Buffer(size_t size) : data(size + 16, T()) {}
+	T * at(size_t off) {return data.data() + off;}
+	aligned_vector<T> data;
+};
+
+static double frand()
+{
+	return rand() / (RAND_MAX + 1.);
+}
+
+static void report(const string &table, const string &kernel, size_t size, size_t off, const string &what)
+{
+	if (nfail < 50)
+		cerr<<table<<" "<<kernel<<" size="<<size<<" offset="<<off<<": "<<what<<endl;
+	nfail++;
+}
+
+template <typename T>
+static bool same(const T *a, const T *b, size_t size)
+{
+	for (size_t i=0; i<size; i++)
+	{
+		if (!(a[i] == b[i])) return false;
+	}
+	return true;
+}
+
+/* the vector reductions sum in another order */
+template <typename T>
+static bool close(const T *a, const T *b, size_t size, double tol)
+{
+	for (size_t i=0; i<size; i++)
+	{
+		if (!(abs(a[i] - b[i]) <= tol * max<double>(1., abs(a[i])))) return false;
+	}
+	return true;
+}
+
+static void check(const string &table, const SIMDKernels &ref, const SIMDKernels &k)
+{
+	size_t n = maxsize + 64;
+	Buffer<float> x(n), y(n), z(n), out0(n), out1(n);
+	Buffer<double> d0(n), d1(n), d2(n), d3(n), d4(n), d5(n), e0(n), e1(n), e2(n), e3(n), e4(n), e5(n);
+	Buffer<int> i0(n), i1(n), i2(n), i3(n), idx(n);
+	Buffer<unsigned char> b0(n), b1(n);
+
+	for (size_t size=1; size<=maxsize; size++)
+	{
+		for (auto off : offsets)
+		{
+			for (size_t i=0; i<n; i++)
+			{
+				x.data[i] = frand() * 2. - 1.;
+				y.data[i] = frand() + 0.5;
+				z.data[i] = frand() * 10.;
+			}
+			float *px = x.at(off), *py = y.at(off), *pz = z.at(off);
+
+			float r0 = ref.reduce(px, size), r1 = k.reduce(px, size);
+			if (!close(&r0, &r1, 1, 1e-4))
+				report(table, "reduce", size, off, "sum");
+
+			for (auto p : {&d0, &d1, &e0, &e1}) std::fill(p->data.begin(), p->data.end(), 1.);
+			ref.accumulate_mean(d0.at(off), d1.at(off), 0.5, px, size);
+			k.accumulate_mean(e0.at(off), e1.at(off), 0.5, px, size);
+			if (!close(d0.at(off), e0.at(off), size, 1e-12) or !close(d1.at(off), e1.at(off), size, 1e-12))
+				report(table, "accumulate_mean", size, off, "mean");
+
+			for (auto p : {&d0, &d1, &e0, &e1}) std::fill(p->data.begin(), p->data.end(), 1.);
+			ref.accumulate_mean_var(d0.at(off), d1.at(off), px, size);
+			k.accumulate_mean_var(e0.at(off), e1.at(off), px, size);
+			if (!close(d0.at(off), e0.at(off), size, 1e-12) or !close(d1.at(off), e1.at(off), size, 1e-12))
+				report(table, "accumulate_mean_var", size, off, "mean or var");
+
+			double m0, v0, m1, v1;
+			ref.accumulate_mean_var2(m0, v0, px, size);
+			k.accumulate_mean_var2(m1, v1, px, size);
+			if (!close(&m0, &m1, 1, 1e-5) or !close(&v0, &v1, 1, 1e-5))
+				report(table, "accumulate_mean_var2", size, off, "mean or var");
+
+			ref.remove_baseline(out0.at(off), px, py, pz, 0.3, size);
+			k.remove_baseline(out1.at(off), px, py, pz, 0.3, size);
+			if (!close(out0.at(off), out1.at(off), size, 1e-6))
+				report(table, "remove_baseline", size, off, "output");
+
+			float s0 = ref.remove_baseline_reduce(out0.at(off), px, py, pz, 0.3, size);
+			float s1 = k.remove_baseline_reduce(out1.at(off), px, py, pz, 0.3, size);
+			if (!close(out0.at(off), out1.at(off), size, 1e-6) or !close(&s0, &s1, 1, 1e-4))
+				report(table, "remove_baseline_reduce", size, off, "output or sum");
+
+			for (unsigned int nbits : {1, 2, 4, 8})
+			{
+				size_t nbytes = size / (8 / nbits);
+				ref.scale(b0.at(off), pz, 3.1, 1.7, nbits, size);
+				k.scale(b1.at(off), pz, 3.1, 1.7, nbits, size);
+				if (!same(b0.at(off), b1.at(off), nbytes))
+					report(table, "scale", size, off, "nbits=" + to_string(nbits));
+			}
+
+			float fm0, fv0, fm1, fv1;
+			ref.accumulate_mean_var3(fm0, fv0, px, size);
+			k.accumulate_mean_var3(fm1, fv1, px, size);
+			if (!close(&fm0, &fm1, 1, 1e-4) or !close(&fv0, &fv1, 1, 1e-4))
+				report(table, "accumulate_mean_var3", size, off, "mean or var");
+
+			ref.normalize2(out0.at(off), px, py, pz, size);
+			k.normalize2(out1.at(off), px, py, pz, size);
+			if (!close(out0.at(off), out1.at(off), size, 1e-6))
+				report(table, "normalize2", size, off, "output");
+
+			for (auto p : {&d0, &d1, &d2, &d3, &d4, &d5, &e0, &e1, &e2, &e3, &e4, &e5}) std::fill(p->data.begin(), p->data.end(), 0.5);
+			for (long int r=0; r<3; r++)
+			{
+				ref.accumulate_moments(d0.at(off), d1.at(off), d2.at(off), d3.at(off), d4.at(off), d5.at(off), px + r, size);
+				k.accumulate_moments(e0.at(off), e1.at(off), e2.at(off), e3.at(off), e4.at(off), e5.at(off), px + r, size);
+			}
+			if (!close(d0.at(off), e0.at(off), size, 1e-12) or !close(d1.at(off), e1.at(off), size, 1e-12) or
+				!close(d2.at(off), e2.at(off), size, 1e-12) or !close(d3.at(off), e3.at(off), size, 1e-12) or
+				!close(d4.at(off), e4.at(off), size, 1e-12) or !same(d5.at(off), e5.at(off), size))
+				report(table, "accumulate_moments", size, off, "moments");
+
+			/* columns of a few rows, the row stride of kadane2D_pn is padded to 8 */
+			size_t nrow = 1 + size % 13;
+			size_t ncol = min(size, (n - 16) / nrow / 2);
+			size_t ld = (ncol + 7) / 8 * 8;
+			ref.kadane2D(out0.at(off), i0.at(off), i1.at(off), px, nrow, ncol);
+			k.kadane2D(out1.at(off), i2.at(off), i3.at(off), px, nrow, ncol);
+			if (!same(out0.at(off), out1.at(off), ncol) or !same(i0.at(off), i2.at(off), ncol) or !same(i1.at(off), i3.at(off), ncol))
+				report(table, "kadane2D", size, off, "sum, start or end");
+
+			ncol = min(size, (n - 16) / nrow / 2 / 8 * 8);
+			ld = (ncol + 7) / 8 * 8;
+			float *pn0 = out0.at(off) + ld, *pn1 = out1.at(off) + ld;
+			int *sn0 = i0.at(off) + ld, *en0 = i1.at(off) + ld, *sn1 = i2.at(off) + ld, *en1 = i3.at(off) + ld;
+			ref.kadane2D_pn(out0.at(off), i0.at(off), i1.at(off), pn0, sn0, en0, px, nrow, ncol, ld);
+			k.kadane2D_pn(out1.at(off), i2.at(off), i3.at(off), pn1, sn1, en1, px, nrow, ncol, ld);
+			if (!same(out0.at(off), out1.at(off), ncol) or !same(i0.at(off), i2.at(off), ncol) or !same(i1.at(off), i3.at(off), ncol) or
+				!same(pn0, pn1, ncol) or !same(sn0, sn1, ncol) or !same(en0, en1, ncol))
+				report(table, "kadane2D_pn", size, off, "sum, start or end");
+
+			/* prefix sums, boxcar_max reads w samples before a */
+			int w = 1 + size % 16;
+			vector<float> prefix(size + w, 0.);
+			for (size_t i=1; i<prefix.size(); i++) prefix[i] = prefix[i - 1] + x.data[i];
+			for (auto p : {&out0, &out1}) std::fill(p->data.begin(), p->data.end(), 0.);
+			for (auto p : {&i0, &i1}) std::fill(p->data.begin(), p->data.end(), 0);
+			ref.boxcar_max(out0.at(off), i0.at(off), prefix.data() + w, size, w, 0.7);
+			k.boxcar_max(out1.at(off), i1.at(off), prefix.data() + w, size, w, 0.7);
+			if (!same(out0.at(off), out1.at(off), size) or !same(i0.at(off), i1.at(off), size))
+				report(table, "boxcar_max", size, off, "best or width");
+
+			for (int nh : {1, 2, 4, 8, 16, 32})
+			{
+				ref.harmonic_sum(out0.at(off), pz, size, nh);
+				k.harmonic_sum(out1.at(off), pz, size, nh);
+				if (!close(out0.at(off), out1.at(off), size, 1e-6))
+					report(table, "harmonic_sum", size, off, "nh=" + to_string(nh));
+			}
+
+			double phi0 = frand() * 100. - 50., dphi = frand() * 1e-2;
+			int nbin = 1 + size % 257;
+			ref.phase_bins(i0.at(off), phi0, dphi, size, nbin);
+			k.phase_bins(i1.at(off), phi0, dphi, size, nbin);
+			if (!same(i0.at(off), i1.at(off), size))
+				report(table, "phase_bins", size, off, "bins");
+
+			for (size_t i=0; i<size; i++) idx.at(off)[i] = rand() % n;
+			ref.gather(out0.at(off), x.data.data(), idx.at(off), size);
+			k.gather(out1.at(off), x.data.data(), idx.at(off), size);
+			if (!same(out0.at(off), out1.at(off), size))
+				report(table, "gather", size, off, "output");
+
+			if (off == 0)
+			{
+				uint64_t seed = rand(), counter = (uint64_t)rand() << 20;
+				ref.normal32(out0.data.data(), size, counter, size % 97, seed);
+				k.normal32(out1.data.data(), size, counter, size % 97, seed);
+				if (!same(out0.data.data(), out1.data.data(), 32))
+					report(table, "normal32", size, off, "noise");
+			}
+		}
+	}
+
+	/* tiles of 16, streaming needs the aligned output */
+	for (long int nrow=16; nrow<=64; nrow+=16)
+	{
+		for (long int ncol=16; ncol<=64; ncol+=16)
+		{
+			for (auto off : offsets)
+			{
+				long int ldi = ncol + off, ldo = nrow + off;
+				vector<float> in(nrow * ldi);
+				aligned_vector<float> t0(ncol * ldo), t1(ncol * ldo);
+				for (auto &v : in) v = frand();
+				for (bool stream : {false, true})
+				{
+					if (stream and off != 0) continue;
+					std::fill(t0.begin(), t0.end(), 0.);
+					std::fill(t1.begin(), t1.end(), 0.);
+					ref.transpose16(t0.data(), ldo, in.data(), ldi, nrow, ncol, stream);
+					k.transpose16(t1.data(), ldo, in.data(), ldi, nrow, ncol, stream);
+					if (!same(t0.data(), t1.data(), ncol * ldo))
+						report(table, "transpose16", nrow * ncol, off, stream ? "streamed" : "stored");
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	srand(1);
+
+	const SIMDKernels &ref = get_scalar_kernels();
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma"))
+		check("avx2", ref, get_avx2_kernels());
+	else
+		cerr<<"avx2 not supported, skipped"<<endl;
+
+	if (__builtin_cpu_supports("avx512f"))
+		check("avx512", ref, get_avx512_kernels());
+	else
+		cerr<<"avx512 not supported, skipped"<<endl;
+
+	if (nfail)
+	{
+		cerr<<nfail<<" mismatches"<<endl;
+		return 1;
+	}
+
+	return 0;
+}
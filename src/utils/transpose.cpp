@@ -0,0 +1,216 @@
+/**
+ * @author Yunpeng Men
+ * @email ypmen@mpifr-bonn.mpg.de
+ * @create date 2026-10-19 18:20:42
+ * @modify date 2026-10-19 18:20:42
+ * @desc [description]
+ */
+
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <complex>
+#include <algorithm>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+#include "transpose.h"
+#include "dedisperse.h"
+#include "simd.h"
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+/* edge of the register kernel for 4 byte types, 16 floats fill a cache line */
+#define TRANSPOSE_KERNEL 16
+
+/* read and written under config_mutex, a calibration runs outside of it */
+static TransposeConfig config = {32, 256, 32 * 1024 * 1024, false};
+static std::once_flag config_flag;
+static std::mutex config_mutex;
+
+struct TransposeBlock
+{
+	long int r0, r1, c0, c1;
+};
+
+/**
+ * @brief halve the edge with more leaves at a multiple of the leaf edge until the blocks fit in tiley x tilex
+ */
+static void split_blocks(std::vector<TransposeBlock> &blocks, long int r0, long int r1, long int c0, long int c1, long int tiley, long int tilex)
+{
+	long int ny = (r1 - r0 + tiley - 1) / tiley;
+	long int nx = (c1 - c0 + tilex - 1) / tilex;
+
+	if (ny == 1 && nx == 1)
+	{
+		blocks.push_back(TransposeBlock{r0, r1, c0, c1});
+		return;
+	}
+
+	if (ny >= nx)
+	{
+		long int rm = r0 + (ny + 1) / 2 * tiley;
+		split_blocks(blocks, r0, rm, c0, c1, tiley, tilex);
+		split_blocks(blocks, rm, r1, c0, c1, tiley, tilex);
+	}
+	else
+	{
+		long int cm = c0 + (nx + 1) / 2 * tilex;
+		split_blocks(blocks, r0, r1, c0, cm, tiley, tilex);
+		split_blocks(blocks, r0, r1, cm, c1, tiley, tilex);
+	}
+}
+
+/**
+ * @brief element by element, 8 output rows at a time so that both sides are written sequentially
+ */
+template <typename T>
+static inline void transpose_scalar(T *out, const T *in, long int m, long int n, long int r0, long int r1, long int c0, long int c1)
+{
+	for (long int j0=c0; j0<c1; j0+=8)
+	{
+		long int j1 = std::min(j0 + 8, c1);
+		for (long int i=r0; i<r1; i++)
+		{
+			for (long int j=j0; j<j1; j++)
+			{
+				out[j * m + i] = in[i * n + j];
+			}
+		}
+	}
+}
+
+/**
+ * @brief transpose a leaf block of a 4 byte type with the register kernel of the cpu, see
+ * SIMDKernels::transpose16, the edges element by element
+ */
+static inline void transpose_leaf(float *out, const float *in, long int m, long int n, long int r0, long int r1, long int c0, long int c1, bool stream)
+{
+	const long int K = TRANSPOSE_KERNEL;
+	long int rk = r0 + (r1 - r0) / K * K;
+	long int ck = c0 + (c1 - c0) / K * K;
+
+	PulsarX::simd_kernels().transpose16(out + c0 * m + r0, m, in + r0 * n + c0, n, rk - r0, ck - c0, stream);
+
+	transpose_scalar(out, in, m, n, rk, r1, c0, c1);
+	transpose_scalar(out, in, m, n, r0, rk, ck, c1);
+}
+
+template <typename T>
+static void transpose_run(T *out, const T *in, long int m, long int n, long int tiley, long int tilex, size_t stream_threshold)
+{
+	std::vector<TransposeBlock> blocks;
+	split_blocks(blocks, 0, m, 0, n, tiley, tilex);
+
+	bool vec = PulsarX::simd_enabled() && sizeof(T) == sizeof(float);
+	/* streaming stores need aligned output rows */
+	bool stream = vec && m * n * sizeof(T) > stream_threshold && m % TRANSPOSE_KERNEL == 0 && (uintptr_t)out % (TRANSPOSE_KERNEL * sizeof(float)) == 0;
+
+	float *outf = reinterpret_cast<float *>(out);
+	const float *inf = reinterpret_cast<const float *>(in);
+
+	/* consecutive blocks of the recursion are neighbours, each thread takes one contiguous range */
+#ifdef _OPENMP
+#pragma omp parallel num_threads(XLIBS::get_num_threads())
+#endif
+	{
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+		for (size_t b=0; b<blocks.size(); b++)
+		{
+			const TransposeBlock &blk = blocks[b];
+			if (vec)
+				transpose_leaf(outf, inf, m, n, blk.r0, blk.r1, blk.c0, blk.c1, stream);
+			else
+				transpose_scalar(out, in, m, n, blk.r0, blk.r1, blk.c0, blk.c1);
+		}
+	}
+}
+
+static void calibrate()
+{
+	TransposeConfig conf;
+	{
+		std::lock_guard<std::mutex> lock(config_mutex);
+		conf = config;
+	}
+
+	long int llc = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+	llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+	if (llc > 0) conf.stream_threshold = llc;
+
+	/* much larger than the L2 cache, inside the streaming threshold */
+	const long int m = 1024;
+	const long int n = 4096;
+	std::vector<float> in(m * n), out(m * n);
+	for (long int i=0; i<m*n; i++) in[i] = i;
+
+	const long int tileys[] = {16, 32, 64, 128};
+	const long int tilexs[] = {64, 256, 1024};
+
+	double best = 0.;
+	for (auto tiley : tileys)
+	{
+		for (auto tilex : tilexs)
+		{
+			double elapsed = 0.;
+			for (int k=0; k<4; k++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				transpose_run(out.data(), in.data(), m, n, tiley, tilex, (size_t)-1);
+				std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+				/* the first run warms up the pages and the threads */
+				if (k == 1 || (k > 1 && t.count() < elapsed)) elapsed = t.count();
+			}
+
+			if (best == 0. || elapsed < best)
+			{
+				best = elapsed;
+				conf.tiley = tiley;
+				conf.tilex = tilex;
+			}
+		}
+	}
+
+	conf.calibrated = true;
+
+	{
+		std::lock_guard<std::mutex> lock(config_mutex);
+		config = conf;
+	}
+
+	BOOST_LOG_TRIVIAL(debug)<<"transpose calibrated, tile "<<conf.tiley<<"x"<<conf.tilex<<", kernel "<<PulsarX::get_simd_name(PulsarX::get_simd_level())<<", streaming above "<<conf.stream_threshold<<" bytes";
+}
+
+TransposeConfig transpose_calibrate(bool force)
+{
+	std::call_once(config_flag, calibrate);
+	if (force) calibrate();
+
+	std::lock_guard<std::mutex> lock(config_mutex);
+	return config;
+}
+
+template <typename T>
+void transpose_fast(T *out, const T *in, long int m, long int n)
+{
+	if (m <= 0 || n <= 0) return;
+
+	/* a snapshot, a forced calibration may publish a new config meanwhile */
+	TransposeConfig conf = transpose_calibrate();
+	transpose_run(out, in, m, n, conf.tiley, conf.tilex, conf.stream_threshold);
+}
+
+template void transpose_fast<float>(float *out, const float *in, long int m, long int n);
+template void transpose_fast<int>(int *out, const int *in, long int m, long int n);
+template void transpose_fast<double>(double *out, const double *in, long int m, long int n);
+template void transpose_fast<short>(short *out, const short *in, long int m, long int n);
+template void transpose_fast<unsigned char>(unsigned char *out, const unsigned char *in, long int m, long int n);
+template void transpose_fast<std::complex<float>>(std::complex<float> *out, const std::complex<float> *in, long int m, long int n);
@@ -11,6 +11,7 @@
 #include "utils.h"
 #include "AVL.h"
 #include "dedisperse.h"
+#include "transpose.h"
 
 long double to_longdouble(double value1, double value2)
 {
@@ -86,9 +87,10 @@ void transpose(T *out, T *in, int m, int n)
 	int blockx = n / tilex;
 	int blocky = m / tiley;
 
-	T *temp = new T[num_threads * tiley * tilex];
+	unsigned int nthreads = XLIBS::get_num_threads();
+	T *temp = new T[nthreads * tiley * tilex];
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(nthreads)
 #endif
 	for (long int s = 0; s < blocky*blockx; s++)
 	{
@@ -121,99 +123,7 @@ void transpose(T *out, T *in, int m, int n)
 template <typename T>
 void transpose_pad(T *out, T *in, int m, int n)
 {
-	const int tilex = 16;
-	const int tiley = 64;
-
-	int npad = ceil(n*1./tilex)*tilex;
-	int mpad = ceil(m*1./tiley)*tiley;
-
-	int blockx = npad / tilex;
-	int blocky = mpad / tiley;
-
-	T *temp = new T[num_threads * tiley * tilex];
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
-#endif
-	for (long int s = 0; s < blocky*blockx; s++)
-	{
-		T *ptemp = temp;
-#ifdef _OPENMP
-		ptemp = temp + omp_get_thread_num()*tiley*tilex;
-#endif
-		long int l = s/blockx;
-		long int k = s%blockx;
-		
-		if ((l+1)*tiley <= m and (k+1)*tilex <= n)
-		{
-			for (long int i = 0; i < tiley; i++)
-			{
-				for (long int j = 0; j < tilex; j++)
-				{
-					ptemp[j * tiley + i] = in[(l * tiley + i) * n + k * tilex + j];
-				}
-			}
-			for (long int i = 0; i < tilex; i++)
-			{
-				for (long int j = 0; j < tiley; j++)
-				{
-					out[(k * tilex + i) * m + l * tiley + j] = ptemp[i * tiley + j];
-				}
-			}
-		}
-		else if ((l+1)*tiley > m and (k+1)*tilex <= n)
-		{
-			for (long int i = 0; i < m-l*tiley; i++)
-			{
-				for (long int j = 0; j < tilex; j++)
-				{
-					ptemp[j * tiley + i] = in[(l * tiley + i) * n + k * tilex + j];
-				}
-			}
-			for (long int i = 0; i < tilex; i++)
-			{
-				for (long int j = 0; j < m-l*tiley; j++)
-				{
-					out[(k * tilex + i) * m + l * tiley + j] = ptemp[i * tiley + j];
-				}
-			}
-		}
-		else if ((l+1)*tiley <= m and (k+1)*tilex > n)
-		{
-			for (long int i = 0; i < tiley; i++)
-			{
-				for (long int j = 0; j < n-k*tilex; j++)
-				{
-					ptemp[j * tiley + i] = in[(l * tiley + i) * n + k * tilex + j];
-				}
-			}
-			for (long int i = 0; i < n-k*tilex; i++)
-			{
-				for (long int j = 0; j < tiley; j++)
-				{
-					out[(k * tilex + i) * m + l * tiley + j] = ptemp[i * tiley + j];
-				}
-			}
-		}
-		else
-		{
-			for (long int i = 0; i < m-l*tiley; i++)
-			{
-				for (long int j = 0; j < n-k*tilex; j++)
-				{
-					ptemp[j * tiley + i] = in[(l * tiley + i) * n + k * tilex + j];
-				}
-			}
-			for (long int i = 0; i < n-k*tilex; i++)
-			{
-				for (long int j = 0; j < m-l*tiley; j++)
-				{
-					out[(k * tilex + i) * m + l * tiley + j] = ptemp[i * tiley + j];
-				}
-			}
-		}
-	}
-
-	delete[] temp;
+	transpose_fast<T>(out, in, m, n);
 }
 
 template <typename T>
@@ -225,9 +135,10 @@ void transpose_pad(T *out, T *in, int m, int n, int tiley, int tilex)
 	int blockx = npad / tilex;
 	int blocky = mpad / tiley;
 
-	T *temp = new T[num_threads * tiley * tilex];
+	unsigned int nthreads = XLIBS::get_num_threads();
+	T *temp = new T[nthreads * tiley * tilex];
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(nthreads)
 #endif
 	for (long int s = 0; s < blocky*blockx; s++)
 	{
@@ -319,7 +230,7 @@ void transpose_AVX2(float *out, float *in, int m, int n)
 	int blocky = m/tiley;
 
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(num_threads)
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
 #endif
 	for (int i=0; i<m; i+=tiley)
 	{
@@ -635,6 +546,158 @@ void runMedian3(T *data, T *datMedian, long int size, int w)
 	}
 }
 
+template <typename T>
+static void nth_element_copy(std::vector<T> &values, const T *data, size_t size, const std::vector<size_t> &ranks)
+{
+	std::vector<T> copy(data, data+size);
+	for (size_t k=0; k<ranks.size(); k++)
+	{
+		std::nth_element(copy.begin(), copy.begin()+ranks[k], copy.end(), std::less<T>());
+		values[k] = copy[ranks[k]];
+	}
+}
+
+template <typename T>
+void parallel_nth_element(std::vector<T> &values, const T *data, size_t size, const std::vector<size_t> &ranks)
+{
+	const size_t nsample = 16384;
+	const size_t nbins = 4096;
+
+	values.resize(ranks.size(), 0);
+
+	if (ranks.empty()) return;
+
+	if (size < 16 * nsample)
+	{
+		nth_element_copy(values, data, size, ranks);
+		return;
+	}
+
+	/* bracket the ranks with the quantiles of a scattered subsample */
+	std::vector<T> sample(nsample);
+	for (size_t i=0; i<nsample; i++)
+	{
+		sample[i] = data[(i * 2654435761ULL) % size];
+	}
+	std::sort(sample.begin(), sample.end());
+
+	double pmin = *std::min_element(ranks.begin(), ranks.end()) * 1. / size;
+	double pmax = *std::max_element(ranks.begin(), ranks.end()) * 1. / size;
+	double dpmin = 6. * std::sqrt(pmin * (1. - pmin) / nsample) + 1. / nsample;
+	double dpmax = 6. * std::sqrt(pmax * (1. - pmax) / nsample) + 1. / nsample;
+	long int ilo = std::floor((pmin - dpmin) * nsample);
+	long int ihi = std::ceil((pmax + dpmax) * nsample);
+	ilo = std::max(0L, ilo);
+	ihi = std::min((long int)nsample - 1, ihi);
+
+	const T lo = sample[ilo];
+	const T hi = sample[ihi];
+	const double scale = hi > lo ? nbins / ((double)hi - lo) : 0.;
+
+	/* bin 0 and nbins+1 collect the values out of the bracket */
+	auto getbin = [lo, hi, scale, nbins](T x) -> size_t
+	{
+		if (x < lo) return 0;
+		if (x > hi) return nbins + 1;
+		return 1 + std::min(nbins - 1, (size_t)(((double)x - lo) * scale));
+	};
+
+	long int nblock = XLIBS::get_num_threads();
+	size_t blocksize = (size + nblock - 1) / nblock;
+
+	std::vector<size_t> hist_t(nblock * (nbins + 2), 0);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+	for (long int b=0; b<nblock; b++)
+	{
+		size_t *phist = hist_t.data() + b * (nbins + 2);
+		size_t end = std::min(size, (b + 1) * blocksize);
+		for (size_t i=b*blocksize; i<end; i++)
+		{
+			phist[getbin(data[i])]++;
+		}
+	}
+
+	std::vector<size_t> hist(nbins + 2, 0);
+	for (long int b=0; b<nblock; b++)
+	{
+		for (size_t k=0; k<nbins+2; k++)
+		{
+			hist[k] += hist_t[b * (nbins + 2) + k];
+		}
+	}
+
+	/* locate the bin and the rank inside the bin */
+	std::vector<size_t> rankbin(ranks.size(), 0);
+	std::vector<size_t> rankoff(ranks.size(), 0);
+	std::vector<size_t> selbins;
+	for (size_t k=0; k<ranks.size(); k++)
+	{
+		size_t cum = 0;
+		size_t ib = 0;
+		while (cum + hist[ib] <= ranks[k])
+		{
+			cum += hist[ib++];
+		}
+
+		if (ib == 0 or ib == nbins + 1)
+		{
+			/* the subsample missed the bracket, very unlikely */
+			nth_element_copy(values, data, size, ranks);
+			return;
+		}
+
+		rankbin[k] = ib;
+		rankoff[k] = ranks[k] - cum;
+		if (std::find(selbins.begin(), selbins.end(), ib) == selbins.end())
+			selbins.push_back(ib);
+	}
+
+	/* gather the values in the selected bins */
+	size_t nsel = selbins.size();
+	std::vector<std::vector<T>> gather_t(nblock * nsel);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(XLIBS::get_num_threads())
+#endif
+	for (long int b=0; b<nblock; b++)
+	{
+		size_t end = std::min(size, (b + 1) * blocksize);
+		for (size_t i=b*blocksize; i<end; i++)
+		{
+			size_t ib = getbin(data[i]);
+			for (size_t s=0; s<nsel; s++)
+			{
+				if (ib == selbins[s])
+				{
+					gather_t[b * nsel + s].push_back(data[i]);
+					break;
+				}
+			}
+		}
+	}
+
+	for (size_t s=0; s<nsel; s++)
+	{
+		std::vector<T> gather;
+		gather.reserve(hist[selbins[s]]);
+		for (long int b=0; b<nblock; b++)
+		{
+			gather.insert(gather.end(), gather_t[b * nsel + s].begin(), gather_t[b * nsel + s].end());
+		}
+
+		for (size_t k=0; k<ranks.size(); k++)
+		{
+			if (rankbin[k] != selbins[s]) continue;
+
+			std::nth_element(gather.begin(), gather.begin()+rankoff[k], gather.end(), std::less<T>());
+			values[k] = gather[rankoff[k]];
+		}
+	}
+}
+
 void cmul(vector<complex<float>> &x, vector<complex<float>> &y)
 {
 	assert(x.size() == y.size());
@@ -1654,3 +1717,6 @@ template void runMedian2<float>(float *data, float *datMedian, long int size, in
 template void runMedian2<double>(double *data, double *datMedian, long int size, int w);
 
 template void runMedian3<float>(float *data, float *datMedian, long int size, int w);
+
+template void parallel_nth_element<float>(std::vector<float> &values, const float *data, size_t size, const std::vector<size_t> &ranks);
+template void parallel_nth_element<double>(std::vector<double> &values, const double *data, size_t size, const std::vector<size_t> &ranks);